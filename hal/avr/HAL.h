@@ -0,0 +1,253 @@
+#ifndef HAL_H
+#define HAL_H
+/*
+ * Hardware abstraction layer, AVR backend. The drivers in util/ only reach the
+ * ATMega328P through the functions and macros here, so the same drivers and 
+ * game logic can be built for another backend (see hal/linux/HAL.h, which 
+ * implements this interface on Linux). Everything here is a static inline 
+ * wrapper around the registers, so it costs nothing over accessing them directly.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include <stdio.h>
+
+/*
+ * Interrupts. HAL_ISR(name) defines the handler of one of the interrupts below,
+ * which run with interrupts disabled. Code in a HAL_ATOMIC_BLOCK runs with 
+ * interrupts disabled and restores the previous state when the block is left,
+ * including by return.
+ */
+#define HAL_ISR(v) ISR(HAL_VECT_##v)
+#define HAL_EMPTY_ISR(v) EMPTY_INTERRUPT(HAL_VECT_##v)
+#define HAL_VECT_UART_RX USART_RX_vect        // A byte was recieved
+#define HAL_VECT_UART_UDRE USART_UDRE_vect    // Ready for the next byte to send
+#define HAL_VECT_ADC ADC_vect                 // Conversion complete
+#define HAL_VECT_TIMER0_COMPA TIMER0_COMPA_vect
+#define HAL_VECT_TIMER1_COMPA TIMER1_COMPA_vect
+#define HAL_VECT_EE_READY EE_READY_vect       // Ready for the next byte to write
+
+#define HAL_ATOMIC_BLOCK ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+
+static inline void HAL_disableInterrupts(void) { cli(); }
+static inline void HAL_enableInterrupts(void) { sei(); }
+
+/*
+ * Called first thing on startup
+ */
+static inline void HAL_setup(void) {}
+
+/*
+ * Power. HAL_sleep must be called with interrupts disabled, it enables them 
+ * and sleeps until an interrupt has been serviced. The instruction after sei 
+ * is always executed before any interrupt, so a wakeup can't slip in before 
+ * the sleep. HAL_powerDown never returns.
+ */
+static inline void HAL_powerSetup(void) {
+    // Turn off the clocks to TWI, SPI and timer2, none of them are used
+    PRR |= (1 << PRTWI) | (1 << PRSPI) | (1 << PRTIM2);
+    // Turn off the analog comparator
+    ACSR |= (1 << ACD);
+    // Idle mode keeps the USART, timers and ADC running to wake the CPU up
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+static inline void HAL_sleep(void) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+static inline void HAL_powerDown(void) {
+    cli();
+    ADCSRA &= ~(1 << ADEN);
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    for (;;)
+        sleep_cpu();
+}
+
+/*
+ * Timer0 in CTC mode at F_CPU / 64, the compare interrupt fires every top + 1
+ * counts. HAL_timer0MatchPending is true when a compare match hasn't been
+ * serviced yet.
+ */
+#define HAL_TIMER0_PRESCALER 64
+
+static inline void HAL_timer0Start(uint8_t top) {
+    TCCR0A = (1 << WGM01);
+    OCR0A = top;
+    TCNT0 = 0;
+    TIMSK0 |= (1 << OCIE0A);
+    TCCR0B = (1 << CS01) | (1 << CS00);
+}
+
+static inline uint8_t HAL_timer0Count(void) { return TCNT0; }
+static inline uint8_t HAL_timer0MatchPending(void) { return TIFR0 & (1 << OCF0A); }
+
+/*
+ * Carries on from count with a new top, at F_CPU / HAL_TIMER0_SLOW_PRESCALER
+ * if slow is set and at F_CPU / 64 otherwise, dropping a compare match that
+ * is pending. The prescaler keeps running, so the first count can come up
+ * to one count early and the part of a count that had gone by is lost.
+ */
+#define HAL_TIMER0_SLOW_PRESCALER 1024
+
+static inline void HAL_timer0Restart(uint8_t top, uint8_t count, uint8_t slow) {
+    TCCR0B = 0;
+    OCR0A = top;
+    TCNT0 = count;
+    TIFR0 = (1 << OCF0A);
+    TCCR0B = slow ? (1 << CS02) | (1 << CS00) : (1 << CS01) | (1 << CS00);
+}
+
+/*
+ * Timer1 in CTC mode at F_CPU / 8, the compare interrupt fires every top + 1 counts
+ */
+#define HAL_TIMER1_PRESCALER 8
+
+static inline void HAL_timer1Start(uint16_t top) {
+    TCNT1 = 0;
+    OCR1A = top;
+    TCCR1A = 0;
+    TCCR1B = (1 << WGM12) | (1 << CS11);
+    TIMSK1 |= (1 << OCIE1A);
+}
+
+static inline void HAL_timer1Stop(void) {
+    TIMSK1 &= ~(1 << OCIE1A);
+    TCCR1B = 0;
+}
+
+/*
+ * LEDs on PC2-PC5. HAL_LED_BITS converts a 4 bit pattern to what HAL_ledWrite 
+ * takes, so it can be done ahead of time. HAL_ledWrite leaves the other pins alone.
+ */
+#define HAL_LED_MASK 0x3C
+#define HAL_LED_BITS(pattern) ((pattern) << 2)
+
+static inline void HAL_ledSetup(void) {
+    PORTC &= ~HAL_LED_MASK;
+    DDRC |= HAL_LED_MASK;
+}
+
+static inline void HAL_ledWrite(uint8_t bits) {
+    PORTC = (PORTC & ~HAL_LED_MASK) | bits;
+}
+
+/*
+ * UART, 8 data bits, 1 stop bit, no parity with the recieve interrupt enabled.
+ * HAL_uartWrite must only be called when ready for the next byte, e.g. from 
+ * the UART_UDRE interrupt. HAL_uartTxComplete is true when every byte written 
+ * has been shifted out.
+ */
+static inline void HAL_uartSetup(uint32_t baud) {
+    //Set the ubrr value to generate baud rate 
+    uint16_t ubrr = (F_CPU)/((uint32_t)16 * baud) - 1;         
+    UBRR0H = ubrr >> 8;                                        
+    UBRR0L = ubrr;                                             
+    //Enable receiver, transmitter and the recieve complete interrupt
+    UCSR0B = (1<<RXEN0)|(1<<TXEN0)|(1<<RXCIE0);
+    //Set 8 data bits, 1 stop bit, no parity                   
+    UCSR0C = (3<<UCSZ00);                                      
+}
+
+static inline uint8_t HAL_uartRead(void) { return UDR0; }
+
+static inline void HAL_uartWrite(uint8_t byte) {
+    // clear the transmit complete flag so it tells when this byte is out
+    UCSR0A |= (1 << TXC0);
+    UDR0 = byte;
+}
+
+static inline uint8_t HAL_uartTxComplete(void) { return UCSR0A & (1 << TXC0); }
+static inline void HAL_uartEnableTxInterrupt(void) { UCSR0B |= (1 << UDRIE0); }
+static inline void HAL_uartDisableTxInterrupt(void) { UCSR0B &= ~(1 << UDRIE0); }
+static inline uint8_t HAL_uartTxInterruptEnabled(void) { return UCSR0B & (1 << UDRIE0); }
+
+/*
+ * ADC with a prescaler of 64 and the conversion complete interrupt enabled
+ */
+static inline void HAL_adcSetup(void) {
+    ADCSRA |= (1 << ADPS2) | (1 << ADPS1) | (0 << ADPS0); //set prescaler to 64
+    ADCSRA |= (1 << ADIE); //Interrupt on conversion complete
+    ADCSRA |= (1 << ADEN); //Enable ADC 
+}
+
+static inline void HAL_adcStart(void) { ADCSRA |= (1 << ADSC); }
+static inline uint8_t HAL_adcBusy(void) { return ADCSRA & (1 << ADSC); }
+
+static inline uint16_t HAL_adcResult(void) {
+    uint16_t retVal = ADCL;
+    retVal |= ADCH << 8;
+    return retVal;
+}
+
+/*
+ * EEPROM. HAL_eepromRead and HAL_eepromWrite must only be called when the 
+ * EEPROM isn't busy, e.g. from the EE_READY interrupt. HAL_eepromWrite starts 
+ * an erase and write that takes about 3.3ms.
+ */
+#define HAL_EEPROM_SIZE (E2END + 1)
+
+static inline uint8_t HAL_eepromRead(uint16_t addr) {
+    EEAR = addr;
+    EECR |= (1 << EERE);
+    return EEDR;
+}
+
+static inline void HAL_eepromWrite(uint16_t addr, uint8_t byte) {
+    EEAR = addr;
+    EEDR = byte;
+    // EEPE must be set within four cycles of EEMPE
+    EECR |= (1 << EEMPE);
+    EECR |= (1 << EEPE);
+}
+
+static inline uint8_t HAL_eepromBusy(void) { return EECR & (1 << EEPE); }
+static inline void HAL_eepromEnableInterrupt(void) { EECR |= (1 << EERIE); }
+static inline void HAL_eepromDisableInterrupt(void) { EECR &= ~(1 << EERIE); }
+static inline uint8_t HAL_eepromInterruptEnabled(void) { return EECR & (1 << EERIE); }
+
+/*
+ * RAM, from the bottom: static data (.data and .bss), the heap, free space
+ * and the stack, which grows down from the top. HAL_ramStack is the lowest
+ * byte the stack is using. __brkval is only there when malloc is linked in,
+ * without it the heap is empty.
+ *
+ * HAL_EARLY_INIT(f) defines a function that runs from .init3, after the stack
+ * pointer is set up but before .data and .bss are, and falls through to the
+ * rest of the startup code. It must not return or rely on static variables.
+ */
+extern uint8_t __data_start;
+extern uint8_t __heap_start;
+extern char *__brkval __attribute__((weak));
+
+#define HAL_EARLY_INIT(f) \
+    void f(void) __attribute__((naked, used, section(".init3"))); \
+    void f(void)
+
+static inline uint8_t *HAL_ramStart(void) { return &__data_start; }
+static inline uint8_t *HAL_ramStaticEnd(void) { return &__heap_start; }
+static inline uint8_t *HAL_ramHeapEnd(void) {
+    return (&__brkval && __brkval) ? (uint8_t *) __brkval : &__heap_start;
+}
+static inline uint8_t *HAL_ramStack(void) { return (uint8_t *) SP + 1; }
+static inline uint8_t *HAL_ramEnd(void) { return (uint8_t *) RAMEND + 1; }
+
+/*
+ * Binds stdout and stdin to the given functions
+ */
+typedef void (*HAL_putFn)(uint8_t byte, FILE *stream);
+typedef uint8_t (*HAL_getFn)(FILE *stream);
+
+static inline void HAL_setupStdio(HAL_putFn put, HAL_getFn get) {
+    static FILE stream;
+    fdev_setup_stream(&stream, (int (*)(char, FILE *)) put, (int (*)(FILE *)) get, _FDEV_SETUP_RW);
+    stdout = &stream;
+    stdin = &stream;
+}
+#endif
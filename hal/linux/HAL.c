@@ -0,0 +1,528 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <HAL.h>
+
+// Interrupts that are raised by the firmware itself rather than by time or input
+#define SOFT_UART_UDRE 1
+#define SOFT_ADC 2
+#define SOFT_EE_READY 4
+
+#define SIG_UART SIGIO
+#define SIG_TIMER0 (SIGRTMIN)
+#define SIG_TIMER1 (SIGRTMIN + 1)
+#define SIG_SOFT (SIGRTMIN + 2)
+
+static sigset_t interrupts;
+static volatile sig_atomic_t softPending = 0;
+
+static int uartIn = -1;
+static int uartOut = -1;
+static int ptySlave = -1;
+static uint8_t inputEnded = 0;
+static uint8_t rxByte;
+static uint8_t txEnabled = 0;
+static uint8_t txBuffer[256];
+static size_t txLength = 0;
+static struct termios savedTerminal;
+static uint8_t terminalSaved = 0;
+
+static uint8_t adcBusy = 0;
+static uint16_t adcResult = 0;
+static int noise = -1;
+
+static uint8_t *eeprom = NULL;
+static uint8_t eeEnabled = 0;
+
+static timer_t timer0;
+static timer_t timer1;
+static struct timespec timer0Start;
+static uint8_t timer0Top;
+static uint16_t timer0Prescaler = HAL_TIMER0_PRESCALER;
+static uint64_t timer0Matches = 0;
+
+static uint8_t leds = 0;
+static uint8_t ledTrace = 0;
+
+static FILE *recording = NULL;
+static struct timespec recordStart;
+
+static HAL_putFn stdioPut;
+static HAL_getFn stdioGet;
+
+/*
+ * Weak handlers for interrupts the firmware doesn't use
+ */
+__attribute__((weak)) HAL_ISR(UART_RX) {}
+__attribute__((weak)) HAL_ISR(UART_UDRE) { HAL_uartDisableTxInterrupt(); }
+__attribute__((weak)) HAL_ISR(ADC) {}
+__attribute__((weak)) HAL_ISR(TIMER0_COMPA) {}
+__attribute__((weak)) HAL_ISR(TIMER1_COMPA) {}
+__attribute__((weak)) HAL_ISR(EE_READY) { HAL_eepromDisableInterrupt(); }
+
+static void fail(const char *what) {
+    perror(what);
+    exit(1);
+}
+
+/**
+ * Writes everything the UART_UDRE interrupt handed over, waiting for the
+ * other end to read when the pseudo-terminal is full
+ */
+static void flushTx(void) {
+    size_t sent = 0;
+    while (sent < txLength) {
+        ssize_t n = write(uartOut, txBuffer + sent, txLength - sent);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EAGAIN) {
+            struct pollfd out = {uartOut, POLLOUT, 0};
+            poll(&out, 1, -1);
+        } else if (n < 0 && errno != EINTR) {
+            fail("uart write");
+        }
+    }
+    txLength = 0;
+}
+
+/**
+ * Hands one input byte to the UART_RX interrupt, returns 0 if there is none.
+ * Input is only read while the firmware sleeps with nothing else pending,
+ * which keeps a fast script from overrunning the recieve buffer.
+ */
+static int receive(void) {
+    uint8_t byte;
+    ssize_t n = read(uartIn, &byte, 1);
+    if (n == 0)
+        inputEnded = 1;
+    if (n != 1)
+        return 0;
+    rxByte = byte;
+    if (recording) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t ms = (now.tv_sec - recordStart.tv_sec) * 1000ULL + (now.tv_nsec - recordStart.tv_nsec) / 1000000;
+        fprintf(recording, "rx %llu 0x%02x\n", (unsigned long long) ms, byte);
+    }
+    HAL_isr_UART_RX();
+    return 1;
+}
+
+static void sampleAdc(void) {
+    uint16_t sample = 0;
+    if (read(noise, &sample, sizeof sample) != sizeof sample)
+        fail("adc noise");
+    adcResult = sample & 0x3FF;
+    adcBusy = 0;
+    if (recording)
+        fprintf(recording, "adc %u\n", adcResult);
+    HAL_isr_ADC();
+}
+
+/**
+ * Signal handler for every interrupt, runs with all of them blocked
+ * like an AVR interrupt handler
+ */
+static void dispatch(int sig, siginfo_t *info, void *context) {
+    // SIG_UART only wakes up HAL_sleep, which reads the input
+    int savedErrno = errno;
+    if (sig == SIG_TIMER0) {
+        for (int i = timer_getoverrun(timer0); i >= 0; i--) {
+            timer0Matches++;
+            HAL_isr_TIMER0_COMPA();
+        }
+    } else if (sig == SIG_TIMER1) {
+        for (int i = timer_getoverrun(timer1); i >= 0; i--)
+            HAL_isr_TIMER1_COMPA();
+    }
+    while (softPending) {
+        int pending = softPending;
+        softPending = 0;
+        if (pending & SOFT_ADC)
+            sampleAdc();
+        if (pending & SOFT_EE_READY)
+            while (eeEnabled)
+                HAL_isr_EE_READY();
+        if (pending & SOFT_UART_UDRE) {
+            while (txEnabled) {
+                HAL_isr_UART_UDRE();
+                if (txLength == sizeof txBuffer)
+                    flushTx();
+            }
+            flushTx();
+        }
+    }
+    errno = savedErrno;
+}
+
+static void raiseSoft(int interrupt) {
+    HAL_ATOMIC_BLOCK {
+        softPending |= interrupt;
+    }
+    raise(SIG_SOFT);
+}
+
+/**
+ * Starts a recording for tools/simreplay with the EEPROM as it is now,
+ * leaving out the erased lines
+ */
+static void startRecording(const char *path) {
+    recording = fopen(path, "w");
+    if (!recording)
+        fail(path);
+    // Every line is written with interrupts blocked, and lost if the process is killed
+    setvbuf(recording, NULL, _IOLBF, 0);
+    fprintf(recording, "# Recorded by main_native, replay with tools/simreplay\n");
+    for (int line = 0; line < HAL_EEPROM_SIZE; line += 16) {
+        int erased = 1;
+        for (int i = 0; i < 16; i++)
+            erased &= eeprom[line + i] == 0xFF;
+        if (erased)
+            continue;
+        fprintf(recording, "eeprom 0x%03x", line);
+        for (int i = 0; i < 16; i++)
+            fprintf(recording, " %02x", eeprom[line + i]);
+        fprintf(recording, "\n");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &recordStart);
+}
+
+static void restoreTerminal(void) {
+    if (terminalSaved)
+        tcsetattr(uartIn, TCSANOW, &savedTerminal);
+}
+
+uint8_t HAL_interruptsSave(void) {
+    sigset_t old;
+    sigprocmask(SIG_BLOCK, &interrupts, &old);
+    return !sigismember(&old, SIG_UART);
+}
+
+void HAL_interruptsRestore(const uint8_t *enabled) {
+    if (*enabled)
+        sigprocmask(SIG_UNBLOCK, &interrupts, NULL);
+}
+
+void HAL_disableInterrupts(void) {
+    sigprocmask(SIG_BLOCK, &interrupts, NULL);
+}
+
+void HAL_enableInterrupts(void) {
+    sigprocmask(SIG_UNBLOCK, &interrupts, NULL);
+}
+
+void HAL_setup(void) {
+    // Interrupts start disabled, like on reset
+    sigemptyset(&interrupts);
+    sigaddset(&interrupts, SIG_UART);
+    sigaddset(&interrupts, SIG_TIMER0);
+    sigaddset(&interrupts, SIG_TIMER1);
+    sigaddset(&interrupts, SIG_SOFT);
+    HAL_disableInterrupts();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_sigaction = dispatch;
+    action.sa_mask = interrupts;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigaction(SIG_UART, &action, NULL);
+    sigaction(SIG_TIMER0, &action, NULL);
+    sigaction(SIG_TIMER1, &action, NULL);
+    sigaction(SIG_SOFT, &action, NULL);
+
+    const char *path = getenv("HAL_EEPROM");
+    if (!path)
+        path = "eeprom.bin";
+    int file = open(path, O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+        fail(path);
+    off_t size = lseek(file, 0, SEEK_END);
+    if (size < HAL_EEPROM_SIZE) {
+        // A new EEPROM reads as erased
+        uint8_t erased[HAL_EEPROM_SIZE];
+        memset(erased, 0xFF, sizeof erased);
+        if (pwrite(file, erased + size, HAL_EEPROM_SIZE - size, size) != HAL_EEPROM_SIZE - size)
+            fail(path);
+    }
+    eeprom = mmap(NULL, HAL_EEPROM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (eeprom == MAP_FAILED)
+        fail(path);
+    close(file);
+
+    const char *record = getenv("HAL_RECORD");
+    if (record)
+        startRecording(record);
+
+    noise = open("/dev/urandom", O_RDONLY);
+    if (noise < 0)
+        fail("/dev/urandom");
+
+    struct sigevent event;
+    memset(&event, 0, sizeof event);
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIG_TIMER0;
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer0) != 0)
+        fail("timer0");
+    event.sigev_signo = SIG_TIMER1;
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer1) != 0)
+        fail("timer1");
+
+    ledTrace = getenv("HAL_LEDS") != NULL;
+}
+
+void HAL_powerSetup(void) {}
+
+void HAL_sleep(void) {
+    sigset_t pending;
+    sigpending(&pending);
+    uint8_t interruptPending = sigismember(&pending, SIG_TIMER0) || sigismember(&pending, SIG_TIMER1)
+        || sigismember(&pending, SIG_SOFT);
+    if (!interruptPending && receive()) {
+        HAL_enableInterrupts();
+        return;
+    }
+    // Nothing left to do but wait for input that will never come
+    if (inputEnded && !interruptPending && !txEnabled && !eeEnabled && !adcBusy)
+        exit(0);
+
+    sigset_t waiting;
+    sigprocmask(SIG_BLOCK, NULL, &waiting);
+    sigdelset(&waiting, SIG_UART);
+    sigdelset(&waiting, SIG_TIMER0);
+    sigdelset(&waiting, SIG_TIMER1);
+    sigdelset(&waiting, SIG_SOFT);
+    sigsuspend(&waiting);
+    HAL_enableInterrupts();
+}
+
+void HAL_powerDown(void) {
+    exit(0);
+}
+
+static uint64_t elapsedTimer0Counts(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (now.tv_sec - timer0Start.tv_sec) * 1000000000ULL + now.tv_nsec - timer0Start.tv_nsec;
+    return ns / (1000000000ULL * timer0Prescaler / F_CPU);
+}
+
+void HAL_timer0Start(uint8_t top) {
+    HAL_timer0Restart(top, 0, 0);
+}
+
+void HAL_timer0Restart(uint8_t top, uint8_t count, uint8_t slow) {
+    // Stop the old setting and drop a compare match it left pending
+    struct itimerspec stop = {{0, 0}, {0, 0}};
+    timer_settime(timer0, 0, &stop, NULL);
+    sigset_t timer0Signal;
+    sigemptyset(&timer0Signal);
+    sigaddset(&timer0Signal, SIG_TIMER0);
+    struct timespec none = {0, 0};
+    sigtimedwait(&timer0Signal, NULL, &none);
+
+    timer0Prescaler = slow ? HAL_TIMER0_SLOW_PRESCALER : HAL_TIMER0_PRESCALER;
+    uint64_t countNs = 1000000000ULL * timer0Prescaler / F_CPU;
+    uint64_t period = (top + 1ULL) * countNs;
+    // Counting from count means having started count counts before the
+    // last one, the prescaler runs on from the monotonic clock's zero like
+    // the one of the ATmega328P runs on from reset
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+    uint64_t start = ns - ns % countNs - count * countNs;
+    uint64_t first = start + (top + 1ULL) * countNs - ns;
+    struct itimerspec spec = {
+        {period / 1000000000ULL, period % 1000000000ULL},
+        {first / 1000000000ULL, first % 1000000000ULL}
+    };
+    timer0Start.tv_sec = start / 1000000000ULL;
+    timer0Start.tv_nsec = start % 1000000000ULL;
+    timer0Top = top;
+    timer0Matches = 0;
+    timer_settime(timer0, 0, &spec, NULL);
+}
+
+uint8_t HAL_timer0Count(void) {
+    uint64_t counts = elapsedTimer0Counts();
+    uint64_t matches = counts / (timer0Top + 1);
+    // Keep the count consistent with the compare interrupts that have been
+    // delivered, which can lag behind the clock
+    if (matches > timer0Matches + 1)
+        return timer0Top;
+    if (matches < timer0Matches)
+        return 0;
+    return counts % (timer0Top + 1);
+}
+
+uint8_t HAL_timer0MatchPending(void) {
+    return elapsedTimer0Counts() / (timer0Top + 1) > timer0Matches;
+}
+
+void HAL_timer1Start(uint16_t top) {
+    uint64_t period = (top + 1ULL) * HAL_TIMER1_PRESCALER * 1000000000ULL / F_CPU;
+    struct itimerspec spec = {
+        {period / 1000000000ULL, period % 1000000000ULL},
+        {period / 1000000000ULL, period % 1000000000ULL}
+    };
+    timer_settime(timer1, 0, &spec, NULL);
+}
+
+void HAL_timer1Stop(void) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof spec);
+    timer_settime(timer1, 0, &spec, NULL);
+}
+
+void HAL_ledSetup(void) {
+    leds = 0;
+}
+
+void HAL_ledWrite(uint8_t bits) {
+    if (ledTrace && bits != leds) {
+        char line[] = "LEDs ....\n";
+        for (int i = 0; i < 4; i++)
+            if (bits & (1 << i))
+                line[5 + i] = '*';
+        if (write(STDERR_FILENO, line, sizeof line - 1) < 0) {}
+    }
+    leds = bits;
+}
+
+void HAL_uartSetup(uint32_t baud) {
+    const char *mode = getenv("HAL_UART");
+    if (mode && strcmp(mode, "stdio") == 0) {
+        uartIn = STDIN_FILENO;
+        uartOut = STDOUT_FILENO;
+        if (isatty(uartIn)) {
+            // Pass keys through as they are typed, like a serial terminal
+            struct termios raw;
+            tcgetattr(uartIn, &savedTerminal);
+            terminalSaved = 1;
+            atexit(restoreTerminal);
+            raw = savedTerminal;
+            cfmakeraw(&raw);
+            raw.c_oflag |= OPOST;
+            tcsetattr(uartIn, TCSANOW, &raw);
+        }
+    } else {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+            fail("pty");
+        // Keep the other end open so reads don't fail when nothing is connected
+        ptySlave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (ptySlave < 0)
+            fail("pty");
+        struct termios raw;
+        tcgetattr(ptySlave, &raw);
+        cfmakeraw(&raw);
+        tcsetattr(ptySlave, TCSANOW, &raw);
+        fprintf(stderr, "UART on %s\n", ptsname(master));
+        uartIn = master;
+        uartOut = master;
+    }
+    fcntl(uartIn, F_SETOWN, getpid());
+    fcntl(uartIn, F_SETFL, fcntl(uartIn, F_GETFL) | O_ASYNC | O_NONBLOCK);
+}
+
+uint8_t HAL_uartRead(void) {
+    return rxByte;
+}
+
+void HAL_uartWrite(uint8_t byte) {
+    txBuffer[txLength++] = byte;
+}
+
+uint8_t HAL_uartTxComplete(void) {
+    return 1;
+}
+
+void HAL_uartEnableTxInterrupt(void) {
+    txEnabled = 1;
+    raiseSoft(SOFT_UART_UDRE);
+}
+
+void HAL_uartDisableTxInterrupt(void) {
+    txEnabled = 0;
+}
+
+uint8_t HAL_uartTxInterruptEnabled(void) {
+    return txEnabled;
+}
+
+void HAL_adcSetup(void) {}
+
+void HAL_adcStart(void) {
+    adcBusy = 1;
+    raiseSoft(SOFT_ADC);
+}
+
+uint8_t HAL_adcBusy(void) {
+    return adcBusy;
+}
+
+uint16_t HAL_adcResult(void) {
+    return adcResult;
+}
+
+uint8_t HAL_eepromRead(uint16_t addr) {
+    return eeprom[addr % HAL_EEPROM_SIZE];
+}
+
+void HAL_eepromWrite(uint16_t addr, uint8_t byte) {
+    eeprom[addr % HAL_EEPROM_SIZE] = byte;
+}
+
+uint8_t HAL_eepromBusy(void) {
+    return 0;
+}
+
+void HAL_eepromEnableInterrupt(void) {
+    eeEnabled = 1;
+    raiseSoft(SOFT_EE_READY);
+}
+
+void HAL_eepromDisableInterrupt(void) {
+    eeEnabled = 0;
+}
+
+uint8_t HAL_eepromInterruptEnabled(void) {
+    return eeEnabled;
+}
+
+uint8_t *HAL_ramStart(void) { return NULL; }
+uint8_t *HAL_ramStaticEnd(void) { return NULL; }
+uint8_t *HAL_ramHeapEnd(void) { return NULL; }
+uint8_t *HAL_ramStack(void) { return NULL; }
+uint8_t *HAL_ramEnd(void) { return NULL; }
+
+static ssize_t stdioWrite(void *cookie, const char *bytes, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        stdioPut(bytes[i], stdout);
+    return length;
+}
+
+static ssize_t stdioRead(void *cookie, char *bytes, size_t length) {
+    if (!length)
+        return 0;
+    bytes[0] = stdioGet(stdin);
+    return 1;
+}
+
+void HAL_setupStdio(HAL_putFn put, HAL_getFn get) {
+    cookie_io_functions_t functions = {stdioRead, stdioWrite, NULL, NULL};
+    stdioPut = put;
+    stdioGet = get;
+    FILE *stream = fopencookie(NULL, "r+", functions);
+    // Unbuffered, so output stays in order with bytes sent through UART_send
+    setvbuf(stream, NULL, _IONBF, 0);
+    stdout = stream;
+    stdin = stream;
+}
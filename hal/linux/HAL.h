@@ -0,0 +1,105 @@
+#ifndef HAL_H
+#define HAL_H
+/*
+ * Hardware abstraction layer, Linux backend. Implements the interface of 
+ * hal/avr/HAL.h so the firmware can run as a native process:
+ *   - interrupts are signals, disabling interrupts blocks them and sleeping
+ *     waits for one with sigsuspend
+ *   - the UART is a pseudo-terminal, whose name is printed on startup, or 
+ *     stdin/stdout when HAL_UART=stdio is set in the environment. Input is
+ *     handed over a byte at a time while the firmware sleeps, and the process
+ *     exits once stdin has ended and the firmware is waiting for more
+ *   - the ADC returns noise from /dev/urandom
+ *   - the EEPROM is a file, eeprom.bin or the path in HAL_EEPROM
+ *   - timer0 and timer1 are POSIX timers
+ *   - the LEDs are printed to stderr when HAL_LEDS is set
+ *   - with HAL_RECORD=path, the EEPROM at startup, the ADC samples and each
+ *     input byte with the milliseconds until it was read are written to
+ *     path, for tools/simreplay to play back in the simulator
+ * There are no baud rate or EEPROM write delays, so the firmware runs as 
+ * fast as the host allows.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HAL_ISR(v) void HAL_isr_##v(void)
+#define HAL_EMPTY_ISR(v) void HAL_isr_##v(void) {}
+
+HAL_ISR(UART_RX);
+HAL_ISR(UART_UDRE);
+HAL_ISR(ADC);
+HAL_ISR(TIMER0_COMPA);
+HAL_ISR(TIMER1_COMPA);
+HAL_ISR(EE_READY);
+
+uint8_t HAL_interruptsSave(void);
+void HAL_interruptsRestore(const uint8_t *enabled);
+#define HAL_ATOMIC_BLOCK \
+    for (uint8_t hal_enabled __attribute__((cleanup(HAL_interruptsRestore))) = HAL_interruptsSave(), \
+         hal_once = 1; hal_once; hal_once = 0)
+
+void HAL_disableInterrupts(void);
+void HAL_enableInterrupts(void);
+
+void HAL_setup(void);
+
+void HAL_powerSetup(void);
+void HAL_sleep(void);
+void HAL_powerDown(void);
+
+#define HAL_TIMER0_PRESCALER 64
+void HAL_timer0Start(uint8_t top);
+uint8_t HAL_timer0Count(void);
+uint8_t HAL_timer0MatchPending(void);
+#define HAL_TIMER0_SLOW_PRESCALER 1024
+void HAL_timer0Restart(uint8_t top, uint8_t count, uint8_t slow);
+
+#define HAL_TIMER1_PRESCALER 8
+void HAL_timer1Start(uint16_t top);
+void HAL_timer1Stop(void);
+
+#define HAL_LED_MASK 0x0F
+#define HAL_LED_BITS(pattern) (pattern)
+void HAL_ledSetup(void);
+void HAL_ledWrite(uint8_t bits);
+
+void HAL_uartSetup(uint32_t baud);
+uint8_t HAL_uartRead(void);
+void HAL_uartWrite(uint8_t byte);
+uint8_t HAL_uartTxComplete(void);
+void HAL_uartEnableTxInterrupt(void);
+void HAL_uartDisableTxInterrupt(void);
+uint8_t HAL_uartTxInterruptEnabled(void);
+
+void HAL_adcSetup(void);
+void HAL_adcStart(void);
+uint8_t HAL_adcBusy(void);
+uint16_t HAL_adcResult(void);
+
+#define HAL_EEPROM_SIZE 1024
+uint8_t HAL_eepromRead(uint16_t addr);
+void HAL_eepromWrite(uint16_t addr, uint8_t byte);
+uint8_t HAL_eepromBusy(void);
+void HAL_eepromEnableInterrupt(void);
+void HAL_eepromDisableInterrupt(void);
+uint8_t HAL_eepromInterruptEnabled(void);
+
+/*
+ * A process has no fixed RAM map to report, all of these are NULL so the
+ * memory report comes out empty
+ */
+#define HAL_EARLY_INIT(f) \
+    static void f(void) __attribute__((constructor)); \
+    static void f(void)
+
+uint8_t *HAL_ramStart(void);
+uint8_t *HAL_ramStaticEnd(void);
+uint8_t *HAL_ramHeapEnd(void);
+uint8_t *HAL_ramStack(void);
+uint8_t *HAL_ramEnd(void);
+
+typedef void (*HAL_putFn)(uint8_t byte, FILE *stream);
+typedef uint8_t (*HAL_getFn)(FILE *stream);
+void HAL_setupStdio(HAL_putFn put, HAL_getFn get);
+#endif
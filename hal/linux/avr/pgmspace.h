@@ -0,0 +1,33 @@
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+/**
+ * Stand-in for avr-libc's <avr/pgmspace.h> in the host build.
+ *
+ * Program memory is ordinary memory on the host, so the read macros are plain
+ * dereferences. The printf family is wrapped to accept avr-libc's %S, which
+ * prints a string that lives in program memory.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+
+int printf_P(const char *format, ...);
+int sprintf_P(char *str, const char *format, ...);
+int snprintf_P(char *str, size_t size, const char *format, ...);
+
+#endif
@@ -0,0 +1,57 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+
+/**
+ * Copies format with every %S conversion turned into %s, the caller frees it
+ */
+static char *hostFormat(const char *format) {
+    char *copy = strdup(format);
+    for (char *c = copy; *c; c++) {
+        if (*c != '%')
+            continue;
+        if (c[1] == '%') {
+            c++;
+            continue;
+        }
+        // Skip flags, width and precision
+        c++;
+        while (*c && strchr("-+ #0123456789.", *c))
+            c++;
+        if (*c == 'S')
+            *c = 's';
+        if (!*c)
+            break;
+    }
+    return copy;
+}
+
+int printf_P(const char *format, ...) {
+    char *host = hostFormat(format);
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(host, args);
+    va_end(args);
+    free(host);
+    return n;
+}
+
+int sprintf_P(char *str, const char *format, ...) {
+    char *host = hostFormat(format);
+    va_list args;
+    va_start(args, format);
+    int n = vsprintf(str, host, args);
+    va_end(args);
+    free(host);
+    return n;
+}
+
+int snprintf_P(char *str, size_t size, const char *format, ...) {
+    char *host = hostFormat(format);
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(str, size, host, args);
+    va_end(args);
+    free(host);
+    return n;
+}
@@ -5,109 +5,127 @@
 #define F_CPU 8000000
 #define BAUD_RATE 9600
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
 #include <avr/pgmspace.h>
-#include <avr/eeprom.h>
-#include <util/delay.h>
-#include <util/atomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "HAL.h"
 #include "util/Board.h"
 #include "util/UART.h"
 #include "util/ADC.h"
+#include "util/Power.h"
+#include "util/Led.h"
+#include "util/Storage.h"
+#include "util/Memory.h"
+#include "util/Clock.h"
+#include "util/Latency.h"
+#include "util/Trace.h"
+#include "util/Protocol.h"
+#include "util/Hint.h"
+#include "util/Speculate.h"
+#include "util/Flow.h"
 #include "text.h"
 
-void EEPROM_Write(uint8_t *addr, uint8_t data);
-uint8_t EEPROM_Read(uint8_t *addr);
-void setupTimer1(void);
+void saveSettings(void);
 void setup(void);
 uint16_t getSeed(void);
-void messageSequence(const char ** messages, uint8_t size);
-void welcomeMessage(void);
+void getEnter(void);
+void getInput(char *str, size_t size);
+uint32_t nextRandom(void);
 Boolean spawnTwo(void);
-void printBoard(Board *board);
+void newGame(Board *board, uint32_t *score);
+void saveGame(Board *board, uint32_t score);
+Boolean loadGame(Board *board, uint32_t *score);
+void printBoard(Board *board, uint32_t score);
 void play2048(void);
 void ledPuzzle(void);
-void selectGame(void);
-void birthdayMessage(void); 
-
-uint8_t *accessLevelAddr = (uint8_t *) 0;  //Address of EEPROM variable beat2048
-uint8_t accessLevel = 0; 
-uint8_t *messageAuthAddr = (uint8_t *) 1;  //Address of EEPROM variable messageAuth
-uint8_t messageAuth = 0;
-
-const uint8_t secretMessage[][2] = {{4,2},{2,1},{6,2},{6,2},{2,1},
-                              {4,3},{7,4},
-                              {2,1},
-                              {2,2},{8,2},{8,1},{8,1},{3,2},{7,3},{3,3},{5,3},{9,3}};
-volatile uint8_t flashCount = 0;
-uint8_t secretDigit;
-
-void EEPROM_Write(uint8_t *addr, uint8_t data) {
-    while (!eeprom_is_ready()) {}
-    eeprom_write_byte(addr,data);
-}
+void halt(void);
+void debugMenu(void);
 
-uint8_t EEPROM_Read(uint8_t *addr) {
-    while (!eeprom_is_ready()) {}
-    return eeprom_read_byte(addr);
-}
+typedef struct {
+    uint8_t accessLevel;    // 1 after the welcome message, 2 after beating 2048
+    uint8_t messageAuth;    // 1 once the birthday message password is entered
+} Settings;
+_Static_assert(sizeof(Settings) == STORAGE_SETTINGS_SIZE, "Settings doesn't match its storage region");
 
-/**
- * Interrupt handler for LED puzzle
- */
-ISR (TIMER1_COMPA_vect)
-{
-    if (flashCount) {
-        //Toggle LEDs
-        if (!(flashCount % 2))
-            PORTC = secretDigit << 2; //Use PC2 - PC5
-        else
-            PORTC = 0;
-        flashCount --;
-    }
-}
+Settings settings;
 
-/**
- * Setup function for 16 bit timer1 running at 8 Mhz
- * for 0.25 second triggers
- */
-void setupTimer1(void) {
-    OCR1A = 0x7A0;
+typedef struct {
+    uint8_t board[8];   // Packed by Board_pack, all zeroes when there's no game to resume
+    uint32_t score;
+    uint32_t random;    // State of the random number generator
+} SavedGame;
+_Static_assert(sizeof(SavedGame) == STORAGE_GAME_SIZE, "SavedGame doesn't match its storage region");
 
-    // Mode 4, CTC on OCR1A
-    TCCR1B |= (1 << WGM12);
+uint32_t randomState = 1;
 
-    //Set interrupt on compare match
-    TIMSK1 |= (1 << OCIE1A);
+// A flash is on and then off for about a quarter of a second each 
+#define FLASH_TICKS (250 / LED_STEP_MS)
+#define FLASH(d) {(d), LED_FULL, FLASH_TICKS}, {0, 0, FLASH_TICKS}
+#define FLASH_1(d) FLASH(d)
+#define FLASH_2(d) FLASH(d), FLASH(d)
+#define FLASH_3(d) FLASH(d), FLASH(d), FLASH(d)
+#define FLASH_4(d) FLASH(d), FLASH(d), FLASH(d), FLASH(d)
+// A digit of the password flashes n times after a short pause
+#define SECRET_DIGIT(name, d, n) \
+    static const LedStep name[] PROGMEM = {{0, 0, FLASH_TICKS}, FLASH_##n(d), LED_END}
 
-    // set prescaler to 1024 and start the timer
-    TCCR1B |= (1 << CS12) | (1 << CS10);
+SECRET_DIGIT(digit2x1, 2, 1);
+SECRET_DIGIT(digit2x2, 2, 2);
+SECRET_DIGIT(digit3x2, 3, 2);
+SECRET_DIGIT(digit3x3, 3, 3);
+SECRET_DIGIT(digit4x2, 4, 2);
+SECRET_DIGIT(digit4x3, 4, 3);
+SECRET_DIGIT(digit5x3, 5, 3);
+SECRET_DIGIT(digit6x2, 6, 2);
+SECRET_DIGIT(digit7x3, 7, 3);
+SECRET_DIGIT(digit7x4, 7, 4);
+SECRET_DIGIT(digit8x1, 8, 1);
+SECRET_DIGIT(digit8x2, 8, 2);
+SECRET_DIGIT(digit9x3, 9, 3);
 
-    // enable interrupts
-    sei();
+static const LedStep * const secretMessage[] PROGMEM = {
+    digit4x2, digit2x1, digit6x2, digit6x2, digit2x1,
+    digit4x3, digit7x4,
+    digit2x1,
+    digit2x2, digit8x2, digit8x1, digit8x1, digit3x2, digit7x3, digit3x3, digit5x3, digit9x3};
 
+/**
+ * Queues the settings to be written to EEPROM in the background
+ */
+void saveSettings(void) {
+    Storage_write(STORAGE_SETTINGS, &settings);
 }
 
 /**
  * Setup function which is run once on startup 
  */
 void setup(void) {
-    DDRC = 0x3C; // Set up PC2-PC5 as output for LEDs
+    HAL_setup();
+    Led_setup();
 
+    Clock_setup();
+    Power_setup();
     //Set up UART
     UART_setup(BAUD_RATE);
-    // Set up stream to use to redirect stdout and stdin to UART 
-    static FILE uartSTD = FDEV_SETUP_STREAM(UART_sendByteSTD,UART_recieveByteSTD,_FDEV_SETUP_RW);
-    // Bind stdout and stdin 
-    stdout = &uartSTD;
-    stdin = &uartSTD;
+    // enable interrupts, input is interrupt driven so the CPU can sleep
+    HAL_enableInterrupts();
+    // Redirect stdout and stdin to UART 
+    HAL_setupStdio(UART_sendByteSTD,UART_recieveByteSTD);
     printf_P(PSTR("%c[2J%c[H"),27,27);  // Home cursor and clear screen
 
     ADC_setup();
-    srandom(getSeed());
-    accessLevel = EEPROM_Read(accessLevelAddr);
+    randomState = ((uint32_t) getSeed() << 16) | getSeed();
+    if (!randomState)
+        randomState = 1;
+    Storage_setup();
+    if (Storage_read(STORAGE_SETTINGS, &settings) != 0) {
+        // Nothing stored yet, older firmware kept the settings in EEPROM bytes 0 and 1
+        uint8_t accessLevel = HAL_eepromRead(0);
+        uint8_t messageAuth = HAL_eepromRead(1);
+        // Erased bytes read as 0xFF
+        settings.accessLevel = (accessLevel == 0xFF) ? 0 : accessLevel;
+        settings.messageAuth = (messageAuth == 0xFF) ? 0 : messageAuth;
+    }
 }
 
 /**
@@ -164,21 +182,15 @@ void getInput (char *str, size_t size) {
     str[index] = '\0'; 
 }
 
-void messageSequence(const char ** messages, uint8_t size) { 
-    for (int i =0; i < size; i++) {
-        printf_P(messages[i]);
-        getEnter();
-        printf_P(PSTR("\n\n"));
-    }
-}
-
 /**
- * Initiates the welcome message sequence
+ * Xorshift random number generator, its state is saved along with the 
+ * 2048 game so a resumed game carries on exactly where it left off
  */
-void welcomeMessage(void) {
-    const char* messages[] = {welcome1, welcome2, welcome3,cakeArt, welcome4, welcome5, welcome6, welcome7, welcome8, welcome9};
-    messageSequence(messages, 10);
-    EEPROM_Write(accessLevelAddr, 1);    
+uint32_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
 }
 
 /**
@@ -187,52 +199,228 @@ void welcomeMessage(void) {
  */
 Boolean spawnTwo(void) {
     //Spawn two 90% of the time
-    uint8_t prob = random() % 10;
+    uint8_t prob = nextRandom() % 10;
     return !(prob == 9);
 } 
 
+/**
+ * Puts a random 2 or 4 on the board, drawing the place before the value
+ */
+static void spawnTile(Board *board) {
+    uint32_t random = nextRandom();
+    Board_putRandom(board, random, spawnTwo());
+}
 
 /**
- * Helper method to print the board to UART
+ * Starts speculating on the next move with the random numbers spawnTile
+ * will draw for it, without drawing them yet
  */
-void printBoard(Board *board) {
-    //The following code will make heavy use of the printf_P function to save RAM space
+static void beginSpeculation(Speculation *speculation) {
+    uint32_t state = randomState;
+    uint32_t random = nextRandom();
+    Speculate_begin(speculation, random, spawnTwo());
+    randomState = state;
+}
+
+/**
+ * Starts a new 2048 game with two random tiles
+ */
+void newGame(Board *board, uint32_t *score) {
+    *board = Board_newBlankBoard();
+    spawnTile(board);
+    spawnTile(board);
+    *score = 0;
+}
+
+/**
+ * Queues the game to be saved to EEPROM, this doesn't wait for the write
+ */
+void saveGame(Board *board, uint32_t score) {
+    SavedGame saved;
+    Board_pack(board, saved.board);
+    saved.score = score;
+    saved.random = randomState;
+    Storage_write(STORAGE_GAME, &saved);
+}
+
+/**
+ * Restores a saved game, returns FALSE if there is no game to resume
+ */
+Boolean loadGame(Board *board, uint32_t *score) {
+    SavedGame saved;
+    if (Storage_read(STORAGE_GAME, &saved) != 0)
+        return FALSE;
+    uint8_t blocks = 0;
+    for (uint8_t i = 0; i < sizeof saved.board; i++)
+        blocks |= saved.board[i];
+    if (!blocks)
+        return FALSE;
+    *board = Board_unpack(saved.board);
+    *score = saved.score;
+    randomState = saved.random;
+    return TRUE;
+}
+
+
+// How printBoard draws each tile up to 8192, a lot quicker than sprintf
+#define CELL_TEXTS 14
+static const char cellText[CELL_TEXTS][5] PROGMEM = {
+    "    |", "   2|", "   4|", "   8|", "  16|", "  32|", "  64|",
+    " 128|", " 256|", " 512|", "1024|", "2048|", "4096|", "8192|"
+};
+
+/**
+ * Draws the board for printBoard. If abandon is TRUE it gives up between
+ * rows as soon as a key is waiting, moving the cursor to where a complete
+ * board would have left it, and returns FALSE.
+ */
+static Boolean drawBoard(Board *board, uint32_t score, Boolean abandon) {
+    //The padding and borders are printed straight from flash to save RAM space,
+    //each row of tiles is rendered into a line buffer and sent in one go
+    char line[24];
+    uint8_t length;
     uint16_t boardVal;
     //VT100 escape sequence to get cursor back to original position
     printf_P(PSTR("%c[9A"),27);
 
-    printf_P(PSTR("%S#-------------------#\n"),padding);
+    printf_P(PSTR("%S#--- Score %6lu --#\n"),padding,(unsigned long) score);
     for (uint8_t row = 0; row < 4; row++) {
-        printf_P(PSTR("%S|"),padding);
+        if (abandon && UART_available()) {
+            //Skip the lines of the rows left
+            printf_P(PSTR("%c[%uB"),27,(4 - row) * 2);
+            return FALSE;
+        }
+        printf_P(PSTR("%S"),padding);
+        line[0] = '|';
+        length = 1;
         for (uint8_t col = 0; col < 4; col++) {
             boardVal = board -> grid[row][col].value;
-            if (boardVal)
-                printf_P(PSTR("%4u|"),board -> grid[row][col].value); 
-            else
-                printf_P(PSTR("    |"));
+            uint8_t exponent = 0;
+            for (uint16_t v = boardVal; v > 1; v >>= 1)
+                exponent++;
+            if (exponent < CELL_TEXTS) {
+                memcpy_P(line + length, cellText[exponent], 5);
+                length += 5;
+            } else {
+                length += sprintf_P(line + length, PSTR("%4u|"), boardVal);
+            }
         }
-        printf_P(PSTR("\n"));
+        line[length++] = '\r';
+        line[length++] = '\n';
+        UART_send((uint8_t *) line, length);
         printf_P(PSTR("%S#-------------------#\n"),padding);
     }
+    return TRUE;
 }
 
 /**
- * 2048 Game 
+ * Helper method to print the board to UART
  */
-void play2048(void) { 
-    Board board = Board_newBlankBoard();  
-    //Put down two random tiles first
-    Board_putRandom(&board, random(),spawnTwo());
-    Board_putRandom(&board, random(),spawnTwo());
-    uint8_t recievedByte;
-    Direction dir;
+void printBoard(Board *board, uint32_t score) {
+    drawBoard(board, score, FALSE);
+}
+
+/**
+ * Records the time since start for phase, returns the time now
+ */
+static uint32_t lap(LatencyPhase phase, uint32_t start) {
+    uint32_t now = Clock_now();
+    Latency_record(phase, now - start);
+    return now;
+}
+
+/**
+ * Clears the screen and draws 2048 from scratch
+ */
+static void drawGame(Board *board, uint32_t score) {
     printf_P(PSTR("%c[2J%c[H"),27,27);  //Clears screen, home cursor
     printf_P(logo2048);
     //Move cursor down 9 times to offset for printBoard
     printf_P(PSTR("\n\n\n\n\n\n\n\n\n"));
-    printBoard(&board);
+    printBoard(board, score);
+}
+
+static const char directionLeft[] PROGMEM = "left";
+static const char directionRight[] PROGMEM = "right";
+static const char directionUp[] PROGMEM = "up";
+static const char directionDown[] PROGMEM = "down";
+static PGM_P const directionNames[] PROGMEM = {
+    directionLeft, directionRight, directionUp, directionDown
+};
+
+// Most frames in a row dropped when keys arrive faster than they can be drawn
+#define COALESCE_MAX 4
+
+// Frames dropped before being drawn and redraws given up on for a newer key
+static uint32_t framesSkipped = 0;
+static uint32_t framesAbandoned = 0;
+
+// Longest a hint may take before it settles for a shallower search
+#define HINT_MS 100
+
+static uint32_t hintStart;
+
+static Boolean hintExpired(void) {
+    return Clock_now() - hintStart > (uint32_t) HINT_MS * CLOCK_TICKS_PER_MS;
+}
+
+/**
+ * Draws the board over the last one, droppable as in drawBoard, and clears
+ * the hint under it which was for an older board. Returns FALSE if the
+ * drawing was given up on for a key that came in.
+ */
+static Boolean redraw(Board *board, uint32_t score, Boolean droppable, Boolean *hinted) {
+    if (!drawBoard(board, score, droppable)) {
+        framesAbandoned++;
+        return FALSE;
+    }
+    if (*hinted) {
+        printf_P(PSTR("%c[K"),27);
+        *hinted = FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Replies to a protocol command, see Protocol.h
+ */
+static void sendFrame(Board *board, uint8_t flags) {
+    uint8_t frame[PROTOCOL_FRAME_SIZE];
+    Protocol_frame(board, flags, frame);
+    UART_send(frame, sizeof frame);
+}
+
+/**
+ * 2048 Game 
+ */
+void play2048(void) { 
+    Board board;
+    uint32_t score;
+    //Carry on with the game from before the last power cycle if there is one
+    if (!loadGame(&board, &score) || Board_gameOver(&board)) {
+        newGame(&board, &score);
+        saveGame(&board, score);
+    }
+    uint8_t recievedByte;
+    Direction dir;
+    //Framed replies for a program instead of drawing the board
+    Boolean framed = FALSE;
+    //A hint is showing on the line below the board
+    Boolean hinted = FALSE;
+    //Frames dropped in a row because keys came in faster than they could be drawn
+    uint8_t behind = 0;
+    Speculation speculation;
+    beginSpeculation(&speculation);
+    drawGame(&board, score);
 
     while (!Board_gameWon(&board)) {
+        //The frames dropped for keys that came in together are drawn now,
+        //as the last of them may not have moved the board
+        if (behind && !framed && !UART_available())
+            behind = redraw(&board, score, behind < COALESCE_MAX, &hinted) ? 0 : behind + 1;
+        //Work out the moves ahead of time until a key arrives
+        while (!UART_available() && Speculate_step(&speculation, &board, score))
+            ;
         recievedByte = UART_recieveByte();
         if (recievedByte == 'j') 
             dir = LEFT;
@@ -242,40 +430,122 @@ void play2048(void) {
             dir = UP;
         else if (recievedByte == 'k')
             dir = DOWN;
+        else if (recievedByte == PROTOCOL_START || (framed && recievedByte == PROTOCOL_QUERY)) {
+            framed = TRUE;
+            sendFrame(&board, 0);
+            continue;
+        } else if (framed && recievedByte == PROTOCOL_STOP) {
+            framed = FALSE;
+            drawGame(&board, score);
+            behind = 0;
+            continue;
+        }
+        else if (!framed && recievedByte == 'h') {
+            //Show the board the hint is for
+            if (behind) {
+                redraw(&board, score, FALSE, &hinted);
+                behind = 0;
+            }
+            hintStart = Clock_now();
+            int8_t hint = Hint_suggest(&board, hintExpired);
+            if (hint >= 0)
+                printf_P(PSTR("Hint: %S%c[K\r"), (PGM_P) pgm_read_ptr(&directionNames[hint]), 27);
+            hinted = TRUE;
+            continue;
+        }
+#ifdef TRACE_ENABLE
+        else if (recievedByte == 't') {
+            //Binary dump for tools/trace_decode.py
+            Trace_dump();
+            continue;
+        }
+#endif
         else
             continue;
-        if (Board_shift(dir,&board)) {
-           Board_putRandom(&board, random(), spawnTwo());
-           printBoard(&board);
-           if(Board_gameOver(&board)) {
+        uint32_t time = Clock_now();
+        Latency_record(LATENCY_RECIEVE, time - UART_recievedAt());
+        Boolean moved;
+        Boolean over = FALSE;
+        const SpeculatedMove *ahead = Speculate_get(&speculation, dir);
+        if (ahead) {
+           //Worked out while waiting for the key, only needs copying in
+           moved = ahead -> moved;
+           if (moved) {
+               board = Board_unpack(ahead -> board);
+               score = ahead -> score;
+               over = ahead -> over;
+               //Draw the random numbers the spawn used
+               nextRandom();
+               spawnTwo();
+           }
+           time = lap(LATENCY_COMMIT, time);
+        } else {
+           moved = Board_shiftScore(dir,&board,&score);
+           time = lap(LATENCY_SHIFT, time);
+           if (moved) {
+               spawnTile(&board);
+               time = lap(LATENCY_SPAWN, time);
+               over = Board_gameOver(&board);
+               time = lap(LATENCY_GAME_OVER, time);
+           }
+        }
+        if (moved) {
+           //Frames may be dropped while keys are waiting, but never more
+           //than COALESCE_MAX in a row and never the one showing the game
+           //over or won, as nothing is drawn after it
+           Boolean droppable = (!over && !Board_gameWon(&board) && behind < COALESCE_MAX) ? TRUE : FALSE;
+           if (framed) {
+               sendFrame(&board, PROTOCOL_MOVED | (over ? PROTOCOL_OVER : 0)
+                       | (Board_gameWon(&board) ? PROTOCOL_WON : 0));
+           } else if (droppable && UART_available()) {
+               //The next key will be drawn instead
+               framesSkipped++;
+               behind++;
+           } else if (redraw(&board, score, droppable, &hinted)) {
+               behind = 0;
+           } else {
+               behind++;
+           }
+           time = lap(LATENCY_RENDER, time);
+           //Only moves that change the board are saved, in the background
+           saveGame(&board, score);
+           //Keys waiting are played straight away rather than after the drain
+           if (!behind) {
+               UART_flush();
+               lap(LATENCY_DRAIN, time);
+           }
+           if (over) {
                //start a new game if game over
-               printf_P(PSTR("Damn, game over. Try again?"));
-               getEnter();
-               printf_P(PSTR("\r%c[K"),27);
-               board = Board_newBlankBoard();
-               Board_putRandom(&board, random(),spawnTwo());
-               Board_putRandom(&board, random(),spawnTwo());
-               printBoard(&board);
+               if (!framed) {
+                   printf_P(PSTR("Damn, game over. Try again?"));
+                   getEnter();
+                   printf_P(PSTR("\r%c[K"),27);
+               }
+               newGame(&board, &score);
+               saveGame(&board, score);
+               if (!framed)
+                   printBoard(&board, score);
            } 
+           beginSpeculation(&speculation);
+        } else if (framed) {
+           sendFrame(&board, 0);
         }
     }
-    EEPROM_Write(accessLevelAddr, 2);   
+    //Nothing to resume once the game is won
+    SavedGame cleared = {{0}};
+    Storage_write(STORAGE_GAME, &cleared);
 }
 
 /**
- * Routine for LED puzzle
+ * Routine for LED puzzle, never returns
  */
 void ledPuzzle(void){
     uint8_t index = 0;
     uint8_t recievedByte;
-    const char * ledMessages[] = {led1, led2, led3, led4};
-    messageSequence(ledMessages,4);
     printf_P(PSTR("-----ENCRYPTED PASSWORD-----\n"));
     printf_P(PSTR("Password: *****************"));
     printf_P(PSTR("%c[17D"),27);
-    flashCount = 2 * secretMessage[index][1];
-    secretDigit = secretMessage[index][0]; 
-    setupTimer1();
+    Led_play(pgm_read_ptr(&secretMessage[index]));
     while(1) {
         recievedByte = UART_recieveByte();
         // Move left 
@@ -292,74 +562,93 @@ void ledPuzzle(void){
         } else {
             continue;
         }
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-            //Update the LED flash interrupt variables
-            flashCount = 2 * secretMessage[index][1] + 1;  //A flash will be on & off, hence the 2x multiplier, +1 is to give a short pause before the lights start flashing
-            secretDigit = secretMessage[index][0];
-        }
+        Led_play(pgm_read_ptr(&secretMessage[index]));
     }
 }
 
-void selectGame(void) {
-    char response[2]; 
-    if (accessLevel == 1) {
-        //Skip welcome message?
-        printf_P(PSTR("It seems like you've read through the welcome message before. Would you like to skip to 2048? [y/n]? "));
-        getInput(response,sizeof response); 
-        if (strcmp_P(response,PSTR("y")) == 0) {
-            play2048();
-            ledPuzzle();
-        } else {
-            return;
-        }
-    } else if (accessLevel == 2) {
-        //Skip welcome message or 2048? or input unlock code
-        printf_P(PSTR("It seems like you've beaten 2048, would you like to:\n  1.Play the entire game again?\n  2.Play 2048?\n  3.Look at the LED Puzzle?\n  4.Enter password/read birthday message copy?\n[1-4]:"));
-        getInput(response, sizeof response);
-        if (strcmp_P(response, PSTR("1")) == 0) {
-            return;
-        } else if (strcmp_P(response, PSTR("2")) == 0) {
-            play2048();
-            ledPuzzle();
-        } else if (strcmp_P(response, PSTR("3")) == 0) {
-            ledPuzzle(); 
-        } else if (strcmp_P(response, PSTR("4")) == 0) {
-            birthdayMessage();
-        } else {
-            return;
-        }
-    }
+/**
+ * Powers down for good once the output is out, only a reset wakes the
+ * capsule up again
+ */
+void halt(void) {
+    UART_flush();
+    Storage_flush();
+    Power_halt();
 }
 
-void birthdayMessage(void) {
-    if (!EEPROM_Read(messageAuthAddr)) {
-        char response[20];
-        Boolean unauthorized = TRUE;
-        while (unauthorized) {
-            printf_P(PSTR("Input password to get copy of birthday message: "));
-            getInput(response, sizeof response);
-            if (strcmp_P(response, MESSAGE_PASSWORD) == 0) {
-                EEPROM_Write(messageAuthAddr, 1);
-                unauthorized = FALSE;
-                printf_P(PSTR("\n"));
-            } else {
-                printf_P(PSTR("Invalid password, try again\n"));
-            }
+static const char latencyRecieve[] PROGMEM = "recieve";
+static const char latencyCommit[] PROGMEM = "commit";
+static const char latencyShift[] PROGMEM = "shift";
+static const char latencySpawn[] PROGMEM = "spawn";
+static const char latencyGameOver[] PROGMEM = "game over";
+static const char latencyRender[] PROGMEM = "render";
+static const char latencyDrain[] PROGMEM = "drain";
+static PGM_P const latencyNames[LATENCY_PHASES] PROGMEM = {
+    latencyRecieve, latencyCommit, latencyShift, latencySpawn, latencyGameOver, latencyRender, latencyDrain
+};
+
+/**
+ * Helper to convert power accounting ticks to milliseconds
+ * without overflowing
+ */
+static uint32_t ticksToMs(uint32_t ticks) {
+    return (ticks / 125) * POWER_TICK_US / 8 + (ticks % 125) * POWER_TICK_US / 1000;
+}
+
+/**
+ * Prints debugging statistics over UART
+ */
+void debugMenu(void) {
+    PowerStats power;
+    Power_getStats(&power);
+    uint32_t total = power.asleep + power.awake;
+    printf_P(PSTR("\n-----DEBUG-----\n"));
+    printf_P(PSTR("Asleep: %lu ms\nAwake: %lu ms\nWakeups: %lu\n"),
+            (unsigned long) ticksToMs(power.asleep), (unsigned long) ticksToMs(power.awake),
+            (unsigned long) power.wakeups);
+    if (total >= 100)
+        printf_P(PSTR("Time asleep: %lu%%\n"), (unsigned long) (power.asleep / (total / 100)));
+
+    MemoryStats memory;
+    Memory_getStats(&memory);
+    printf_P(PSTR("RAM: %u bytes, static %u, heap %u\n"), memory.total, memory.statics, memory.heap);
+    printf_P(PSTR("Stack: %u bytes now, peak %u\n"), memory.stack, memory.stackPeak);
+    printf_P(PSTR("Free: %u bytes now, least %u\n"), memory.free, memory.minFree);
+
+    //Each bucket is listed by its upper bound, the last one has none
+    printf_P(PSTR("\nKey press latency, count per bucket of us\n"));
+    for (uint8_t phase = 0; phase < LATENCY_PHASES; phase++) {
+        const LatencyHistogram *histogram = Latency_get(phase);
+        printf_P(PSTR("%-9S max %7lu:"), (PGM_P) pgm_read_ptr(&latencyNames[phase]),
+                (unsigned long) histogram -> max * CLOCK_TICK_US);
+        for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            if (!histogram -> counts[bucket])
+                continue;
+            if (bucket < LATENCY_BUCKETS - 1)
+                printf_P(PSTR(" <%lu:%u"), (unsigned long) CLOCK_TICK_US << (bucket + 1), histogram -> counts[bucket]);
+            else
+                printf_P(PSTR(" more:%u"), histogram -> counts[bucket]);
         }
-    }    
-    const char * messages[] = {birthday1,birthday2,birthday3,birthday4};    
-    messageSequence(messages,4);
-    while(1) {}
+        printf_P(PSTR("\n"));
+    }
+    printf_P(PSTR("Frames skipped: %lu, abandoned: %lu\n"),
+            (unsigned long) framesSkipped, (unsigned long) framesAbandoned);
+    printf_P(PSTR("\n"));
 }
 
+// The story and menus, compiled from story.flow by tools/flowgen.py
+#include "story.h"
+
+static const Flow story PROGMEM = {storyProgram, storyStrings, storyActions, saveSettings, getEnter, getInput};
+
+#ifndef BENCH
+//The benchmark firmware, tests/BenchFirmware.c, brings its own main
 int main(void)
 {
     setup();
-    for(;;){ 
-        selectGame();
-        welcomeMessage();
-        play2048();
-        ledPuzzle();
-    }
+    // The story never ends, the LED puzzle and the birthday message don't return
+    for(;;)
+        Flow_run(&story, (uint8_t *) &settings);
     return 0;   /* never reached */
 }
+#endif
@@ -0,0 +1,155 @@
+/*
+ * Benchmark firmware for the ATmega328P, run under simavr by tools/simbench
+ * with 'make bench' to get exact cycle counts for the hot paths.
+ *
+ * Each measurement writes its name to GPIOR2 a character at a time, then
+ * brackets the code under test with BENCH_START and BENCH_STOP written to
+ * GPIOR0. simbench watches those registers, counts the cycles in between and
+ * reports the minimum, mean and maximum for every name. The firmware is
+ * linked against main.c built with -DBENCH, so printBoard and getSeed are
+ * the real ones.
+ *
+ * The Clock tick and the UART transmitter interrupts are masked during a
+ * measurement, so the count is only the code under test. Printing can't
+ * do without the transmitter: its count includes the handler for the bytes
+ * sent while it waited for room in the buffer, and the buffer is drained
+ * before and after it so the next measurement starts with the UART idle.
+ */
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "HAL.h"
+#include "Board.h"
+#include "RingBuf.h"
+#include "UART.h"
+#include "Hint.h"
+
+#define BENCH_START 1
+#define BENCH_STOP 2
+#define BENCH_DONE 0xFF
+
+#define RUNS 16
+
+// From main.c
+extern uint32_t randomState;
+void setup(void);
+uint16_t getSeed(void);
+uint32_t nextRandom(void);
+void printBoard(Board *board, uint32_t score);
+
+static void benchName(PGM_P name) {
+    char c;
+    while ((c = pgm_read_byte(name++)))
+        GPIOR2 = c;
+}
+
+// The memory clobbers keep the compiler from moving work across the markers,
+// udre is the transmitter interrupt bit to mask as well as the Clock tick
+#define MEASURE_MASKING(name, code, udre) do { \
+        benchName(PSTR(name)); \
+        uint8_t timsk0 = TIMSK0; \
+        uint8_t ucsr0b = UCSR0B; \
+        TIMSK0 = timsk0 & ~(1 << OCIE0A); \
+        UCSR0B = ucsr0b & ~(udre); \
+        __asm__ __volatile__ ("" ::: "memory"); \
+        GPIOR0 = BENCH_START; \
+        code; \
+        GPIOR0 = BENCH_STOP; \
+        __asm__ __volatile__ ("" ::: "memory"); \
+        UCSR0B = (UCSR0B & ~(udre)) | (ucsr0b & (udre)); \
+        TIMSK0 = timsk0; \
+    } while (0)
+
+#define MEASURE(name, code) MEASURE_MASKING(name, code, 1 << UDRIE0)
+
+#define MEASURE_PRINT(name, code) do { \
+        UART_flush(); \
+        MEASURE_MASKING(name, code, 0); \
+        UART_flush(); \
+    } while (0)
+
+/**
+ * Plays random moves from a blank board so the board kernels see realistic
+ * positions, from nearly empty to crowded
+ */
+static void benchBoard(void) {
+    Board board = Board_newBlankBoard();
+    Board_putRandom(&board, nextRandom(), TRUE);
+    for (uint8_t run = 0; run < RUNS * 4; run++) {
+        Board shifted;
+        Boolean moved = FALSE;
+        for (uint8_t dir = 0; dir < 4 && !moved; dir++) {
+            shifted = board;
+            MEASURE("Board_shift", moved = Board_shift((Direction) dir, &shifted));
+        }
+        if (moved)
+            board = shifted;
+        MEASURE("Board_gameOver", Board_gameOver(&board));
+        if (Board_gameOver(&board)) {
+            board = Board_newBlankBoard();
+            Board_putRandom(&board, nextRandom(), TRUE);
+            continue;
+        }
+        uint32_t random = nextRandom();
+        MEASURE("Board_putRandom", Board_putRandom(&board, random, TRUE));
+    }
+    for (uint8_t run = 0; run < 4; run++)
+        MEASURE_PRINT("printBoard", printBoard(&board, 2048));
+}
+
+static Boolean never(void) {
+    return FALSE;
+}
+
+/**
+ * Searches both depths on boards from a random game, the two ply search is
+ * what has to fit in the time limit for a hint
+ */
+static void benchHint(void) {
+    Board board = Board_newBlankBoard();
+    Board_putRandom(&board, nextRandom(), TRUE);
+    for (uint8_t run = 0; run < RUNS; run++) {
+        int8_t best;
+        MEASURE("Hint_search 1", Hint_search(&board, 1, never));
+        MEASURE("Hint_search 2", best = Hint_search(&board, 2, never));
+        if (best < 0)
+            break;
+        Board_shift((Direction) best, &board);
+        Board_putRandom(&board, nextRandom(), TRUE);
+    }
+}
+
+static void benchRingBuf(void) {
+    uint8_t data[16];
+    RINGBUF_DEF(buf,17);
+    SPSC_RINGBUF_DEF(spsc,16);
+
+    for (uint8_t run = 0; run < RUNS; run++) {
+        MEASURE("ringBufPush", ringBufPush(&buf, run));
+        MEASURE("ringBufPop", ringBufPop(&buf, data));
+        MEASURE("spscRingBufPush", spscRingBufPush(&spsc, run));
+        MEASURE("spscRingBufPop", spscRingBufPop(&spsc, data));
+        MEASURE("spscRingBufWrite 16", spscRingBufWrite(&spsc, data, sizeof data));
+        MEASURE("spscRingBufRead 16", spscRingBufRead(&spsc, data, sizeof data));
+    }
+}
+
+int main(void)
+{
+    setup();
+    // The same positions on every run
+    randomState = 1;
+    // setup clears the screen
+    UART_flush();
+
+    // An empty measurement, simbench subtracts this from all the others
+    MEASURE("", );
+    benchBoard();
+    benchRingBuf();
+    benchHint();
+    for (uint8_t run = 0; run < 4; run++)
+        MEASURE("getSeed", getSeed());
+
+    GPIOR0 = BENCH_DONE;
+    for (;;)
+        ;
+}
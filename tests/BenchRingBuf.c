@@ -0,0 +1,68 @@
+/*
+ * Host throughput benchmark for the ring buffers. Bytes are pushed in
+ * bursts and popped again, the way the UART buffers are used, and the
+ * rate is reported in millions of bytes per second.
+ */
+#include <stdio.h>
+#include <time.h>
+#include "RingBuf.h"
+
+#define BYTES 100000000L
+#define BURST 16
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, uint32_t checksum) {
+    double elapsed = seconds() - start;
+    printf("%-12s %8.1f MB/s (checksum %u)\n", name, BYTES / elapsed / 1e6, checksum);
+}
+
+int main(void)
+{
+    uint8_t data;
+    uint32_t checksum = 0;
+    double start;
+
+    RINGBUF_DEF(buf,BURST + 1);
+    start = seconds();
+    for (long i = 0; i < BYTES; i += BURST) {
+        for (int j = 0; j < BURST; j++)
+            ringBufPush(&buf, (uint8_t) j);
+        for (int j = 0; j < BURST; j++) {
+            ringBufPop(&buf, &data);
+            checksum += data;
+        }
+    }
+    report("ringBuf", start, checksum);
+
+    checksum = 0;
+    SPSC_RINGBUF_DEF(spsc,BURST);
+    start = seconds();
+    for (long i = 0; i < BYTES; i += BURST) {
+        for (int j = 0; j < BURST; j++)
+            spscRingBufPush(&spsc, (uint8_t) j);
+        for (int j = 0; j < BURST; j++) {
+            spscRingBufPop(&spsc, &data);
+            checksum += data;
+        }
+    }
+    report("spscRingBuf", start, checksum);
+
+    uint8_t burst[BURST];
+    checksum = 0;
+    start = seconds();
+    for (long i = 0; i < BYTES; i += BURST) {
+        for (int j = 0; j < BURST; j++)
+            burst[j] = (uint8_t) j;
+        spscRingBufWrite(&spsc, burst, BURST);
+        spscRingBufRead(&spsc, burst, BURST);
+        for (int j = 0; j < BURST; j++)
+            checksum += burst[j];
+    }
+    report("spsc bulk", start, checksum);
+    return 0;
+}
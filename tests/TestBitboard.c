@@ -0,0 +1,138 @@
+#include "unity.h"
+#include "Bitboard.h"
+
+#define BOARDS 2000
+
+static uint64_t state = 88172645463325252ULL;
+
+/**
+ * Boards from random games, so they have realistic tiles
+ */
+static Bitboard randomBoard(void) {
+    Bitboard board = Bitboard_spawnRandom(0, &state);
+    uint8_t moves = Bitboard_random(&state) % 200;
+    for (uint8_t i = 0; i < moves && !Bitboard_gameOver(board); i++) {
+        Bitboard next;
+        do {
+            next = Bitboard_shift(board, Bitboard_random(&state) % 4, NULL);
+        } while (next == board);
+        board = Bitboard_spawnRandom(next, &state);
+    }
+    return board;
+}
+
+void test_bitboard_pack(void) {
+    uint16_t grid[4][4] = {
+        {0,2,4,8},
+        {16,32,64,128},
+        {256,512,1024,2048},
+        {4096,8192,16384,32768}
+    };
+    Board board = Board_newBoard(grid);
+    Bitboard bits = Bitboard_fromBoard(&board);
+    TEST_ASSERT_TRUE(bits == 0xFEDCBA9876543210ULL);
+    TEST_ASSERT_EQUAL_UINT8(11, Bitboard_cell(bits, 2, 3));
+    Board back = Bitboard_toBoard(bits);
+    TEST_ASSERT_TRUE(Board_equal(&board, &back));
+}
+
+void test_bitboard_shift_matches_board(void) {
+    for (uint16_t i = 0; i < BOARDS; i++) {
+        Bitboard bits = randomBoard();
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            Board board = Bitboard_toBoard(bits);
+            uint32_t score = 0;
+            uint32_t bitsScore = 0;
+            Board_shiftScore(dir, &board, &score);
+            TEST_ASSERT_TRUE(Bitboard_shift(bits, dir, &bitsScore) == Bitboard_fromBoard(&board));
+            TEST_ASSERT_EQUAL_UINT32(score, bitsScore);
+        }
+    }
+}
+
+void test_bitboard_moves(void) {
+    for (uint16_t i = 0; i < BOARDS; i++) {
+        Bitboard bits = randomBoard();
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(bits, results, scores);
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            uint32_t score = 0;
+            TEST_ASSERT_TRUE(Bitboard_shift(bits, dir, &score) == results[dir]);
+            TEST_ASSERT_EQUAL_UINT32(score, scores[dir]);
+            TEST_ASSERT_EQUAL(results[dir] != bits, (mask >> dir) & 1);
+        }
+        Board board = Bitboard_toBoard(bits);
+        TEST_ASSERT_EQUAL(Board_gameOver(&board), Bitboard_gameOver(bits));
+    }
+}
+
+void test_bitboard_spawn_matches_board(void) {
+    for (uint16_t i = 0; i < BOARDS; i++) {
+        Bitboard bits = randomBoard();
+        if (!Bitboard_empty(bits))
+            continue;
+        uint32_t random = Bitboard_random(&state);
+        Boolean two = random & 1 ? TRUE : FALSE;
+        Board board = Bitboard_toBoard(bits);
+        Board_putRandom(&board, random, two);
+        TEST_ASSERT_TRUE(Bitboard_spawn(bits, random, two) == Bitboard_fromBoard(&board));
+    }
+}
+
+void test_bitboard_counts(void) {
+    uint16_t grid[4][4] = {
+        {2,0,0,0},
+        {0,4,0,0},
+        {0,0,2048,0},
+        {0,0,0,0}
+    };
+    Board board = Board_newBoard(grid);
+    Bitboard bits = Bitboard_fromBoard(&board);
+    TEST_ASSERT_EQUAL_UINT8(13, Bitboard_empty(bits));
+    TEST_ASSERT_EQUAL_UINT8(11, Bitboard_maxExponent(bits));
+    TEST_ASSERT_EQUAL_UINT32(2054, Bitboard_tileSum(bits));
+}
+
+void test_bitboard_canonical(void) {
+    for (uint16_t i = 0; i < BOARDS; i++) {
+        Bitboard bits = randomBoard();
+        Bitboard all[8];
+        Bitboard_symmetries(bits, all);
+        TEST_ASSERT_TRUE(all[0] == bits);
+        Bitboard canonical = Bitboard_canonical(bits);
+        for (uint8_t s = 0; s < 8; s++) {
+            TEST_ASSERT_TRUE(Bitboard_canonical(all[s]) == canonical);
+            TEST_ASSERT_EQUAL_UINT32(Bitboard_tileSum(bits), Bitboard_tileSum(all[s]));
+        }
+    }
+}
+
+void test_bitboard_canonical_directions(void) {
+    for (uint16_t i = 0; i < BOARDS; i++) {
+        Bitboard bits = randomBoard();
+        uint8_t symmetry = Bitboard_canonicalIndex(bits);
+        Bitboard canonical = Bitboard_canonical(bits);
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            //Moving the original board the matching way gives the same boards
+            Bitboard moved = Bitboard_shift(bits, Bitboard_fromCanonical(symmetry, dir), NULL);
+            Bitboard all[8];
+            Bitboard_symmetries(moved, all);
+            TEST_ASSERT_TRUE(all[symmetry] == Bitboard_shift(canonical, dir, NULL));
+        }
+    }
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_bitboard_pack);
+RUN_TEST(test_bitboard_shift_matches_board);
+RUN_TEST(test_bitboard_moves);
+RUN_TEST(test_bitboard_spawn_matches_board);
+RUN_TEST(test_bitboard_counts);
+RUN_TEST(test_bitboard_canonical);
+RUN_TEST(test_bitboard_canonical_directions);
+return UNITY_END();
+}
@@ -442,6 +442,45 @@ void test_board_gameWon(void) {
     TEST_ASSERT_FALSE(Board_gameWon(&boardNotWon));
 };
 
+void test_board_shift_score(void) {
+    uint16_t startingGrid[4][4] = {
+        {2,2,4,4},
+        {8,0,0,8},
+        {2,4,8,16},
+        {0,0,0,0}
+    };
+    Board board = Board_newBoard(startingGrid);
+    uint32_t score = 10;
+    TEST_ASSERT_TRUE(Board_shiftScore(LEFT, &board, &score));
+    TEST_ASSERT_EQUAL_INT(10 + 4 + 8 + 16,score);
+    TEST_ASSERT_FALSE(Board_shiftScore(LEFT, &board, &score));
+    TEST_ASSERT_EQUAL_INT(38,score);
+}
+
+void test_board_pack(void) {
+    uint16_t grid[4][4] = {
+        {0,2,4,8},
+        {16,32,64,128},
+        {256,512,1024,2048},
+        {4096,8192,16384,32768}
+    };
+    Board board = Board_newBoard(grid);
+    uint8_t packed[8];
+    uint8_t expected[8] = {0x10,0x32,0x54,0x76,0x98,0xBA,0xDC,0xFE};
+    Board_pack(&board, packed);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected,packed,8);
+    Board unpacked = Board_unpack(packed);
+    TEST_ASSERT_TRUE(Board_equal(&board,&unpacked));
+}
+
+void test_board_pack_blank(void) {
+    Board board = Board_newBlankBoard();
+    uint8_t packed[8] = {1,1,1,1,1,1,1,1};
+    uint8_t expected[8] = {0};
+    Board_pack(&board, packed);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected,packed,8);
+}
+
 void printBoard(Board * board) {
     for (int row = 0; row < 4; row++){
         printf("{");
@@ -490,5 +529,9 @@ RUN_TEST(test_board_put_random);
 
 RUN_TEST(test_board_gameWon);
 
+RUN_TEST(test_board_shift_score);
+RUN_TEST(test_board_pack);
+RUN_TEST(test_board_pack_blank);
+
 return UNITY_END();
 }
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "Book.h"
+
+#define BOOK "TestBook.bin"
+
+static Book book;
+
+/**
+ * Writes a book of the given boards, each made canonical, with move UP
+ */
+static void writeBook(const Bitboard *boards, uint64_t count, uint32_t maxSum) {
+    BookHeader header = {{'2', '0', '4', '8', 'B', 'O', 'O', 'K'}, BOOK_VERSION, maxSum, count, sizeof(BookEntry), 0};
+    BookEntry entries[8];
+    memset(entries, 0, sizeof entries);
+    for (uint64_t i = 0; i < count; i++) {
+        entries[i].board = Bitboard_canonical(boards[i]);
+        entries[i].value = 100.0f * (i + 1);
+        entries[i].move = UP;
+    }
+    FILE *file = fopen(BOOK, "wb");
+    fwrite(&header, sizeof header, 1, file);
+    fwrite(entries, sizeof(BookEntry), count, file);
+    fclose(file);
+}
+
+void tearDown(void) {
+    Book_close(&book);
+    remove(BOOK);
+}
+
+void test_book_lookup(void) {
+    //Already sorted once canonical
+    Bitboard boards[3] = {0x1ULL, 0x11ULL, 0x21ULL};
+    writeBook(boards, 3, 8);
+    TEST_ASSERT_EQUAL(0, Book_open(&book, BOOK));
+    TEST_ASSERT_EQUAL_UINT32(3, book.count);
+    Direction move;
+    float value;
+    TEST_ASSERT_TRUE(Book_lookup(&book, 0x11ULL, &move, &value));
+    TEST_ASSERT_EQUAL(UP, move);
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, value);
+    TEST_ASSERT_FALSE(Book_lookup(&book, 0x111ULL, &move, &value));
+    //Past the largest tile sum in the book
+    TEST_ASSERT_FALSE(Book_lookup(&book, 0xAULL, &move, &value));
+}
+
+void test_book_symmetry(void) {
+    Bitboard boards[1] = {0x21ULL};
+    writeBook(boards, 1, 8);
+    TEST_ASSERT_EQUAL(0, Book_open(&book, BOOK));
+    //Every rotation and reflection of the position
+    Bitboard all[8];
+    Bitboard_symmetries(0x21ULL, all);
+    for (uint8_t s = 0; s < 8; s++) {
+        Direction move;
+        TEST_ASSERT_TRUE(Book_lookup(&book, all[s], &move, NULL));
+        //Moving the board the way the book says matches moving up on the canonical board
+        uint8_t symmetry = Bitboard_canonicalIndex(all[s]);
+        Bitboard moved[8];
+        Bitboard_symmetries(Bitboard_shift(all[s], move, NULL), moved);
+        TEST_ASSERT_TRUE(moved[symmetry] == Bitboard_shift(Bitboard_canonical(all[s]), UP, NULL));
+    }
+}
+
+void test_book_rejects(void) {
+    FILE *file = fopen(BOOK, "wb");
+    fputs("not a book, but long enough for a header", file);
+    fclose(file);
+    TEST_ASSERT_EQUAL(-1, Book_open(&book, BOOK));
+    TEST_ASSERT_EQUAL(-1, Book_open(&book, "missing.bin"));
+    TEST_ASSERT_FALSE(Book_lookup(&book, 0x1ULL, NULL, NULL));
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_book_lookup);
+RUN_TEST(test_book_symmetry);
+RUN_TEST(test_book_rejects);
+return UNITY_END();
+}
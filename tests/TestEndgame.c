@@ -0,0 +1,126 @@
+#include <errno.h>
+#include <stdio.h>
+#include "unity.h"
+#include "Endgame.h"
+
+#define TABLE "TestEndgame.bin"
+
+static Endgame table;
+
+/**
+ * The chance of making 2^goal from board by trying every line of play,
+ * without a table
+ */
+static double reference(Bitboard board, uint8_t goal, uint32_t maxSum);
+
+static double afterMove(Bitboard after, uint8_t goal, uint32_t maxSum) {
+    if (Bitboard_maxExponent(after) >= goal)
+        return 1;
+    uint32_t sum = Bitboard_tileSum(after);
+    double total = 0;
+    uint8_t empty = 0;
+    for (uint8_t cell = 0; cell < 16; cell++) {
+        if ((after >> (4 * cell)) & 0x0F)
+            continue;
+        for (uint8_t tile = 1; tile <= 2; tile++) {
+            Bitboard child = after | ((Bitboard) tile << (4 * cell));
+            double chance = tile == 1 ? 0.9 : 0.1;
+            if (Bitboard_maxExponent(child) >= goal)
+                total += chance;
+            else if (sum + 2 * tile <= maxSum)
+                total += chance * reference(child, goal, maxSum);
+        }
+        empty++;
+    }
+    return total / empty;
+}
+
+static double reference(Bitboard board, uint8_t goal, uint32_t maxSum) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    double best = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (mask & (1 << dir)) {
+            double probability = afterMove(results[dir], goal, maxSum);
+            if (probability > best)
+                best = probability;
+        }
+    }
+    return best;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+    Endgame_close(&table);
+    remove(TABLE);
+}
+
+void test_endgame_exact(void) {
+    //A 2 and a 4 in the corner, making an 8 before the tile sum passes 12
+    Bitboard root = 0x21ULL;
+    TEST_ASSERT_EQUAL(0, Endgame_build(TABLE, &root, 1, 3, 12, 2, NULL));
+    TEST_ASSERT_EQUAL(0, Endgame_open(&table, TABLE));
+    TEST_ASSERT_EQUAL_UINT32(6, table.minSum);
+    TEST_ASSERT_EQUAL_UINT32(12, table.maxSum);
+    double expected = reference(root, 3, 12);
+    TEST_ASSERT_TRUE(expected > 0 && expected < 1);
+    //Every symmetry, and a move that gets the chance it says
+    Bitboard all[8];
+    Bitboard_symmetries(root, all);
+    for (uint8_t s = 0; s < 8; s++) {
+        Direction move;
+        double probability;
+        TEST_ASSERT_TRUE(Endgame_lookup(&table, all[s], &move, &probability));
+        TEST_ASSERT_FLOAT_WITHIN(1e-12, expected, probability);
+        Bitboard after = Bitboard_shift(all[s], move, NULL);
+        TEST_ASSERT_TRUE(after != all[s]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-12, expected, afterMove(after, 3, 12));
+    }
+    //Positions further on are exact too
+    Bitboard later = 0x1021ULL;
+    double probability;
+    TEST_ASSERT_TRUE(Endgame_lookup(&table, later, NULL, &probability));
+    TEST_ASSERT_FLOAT_WITHIN(1e-12, reference(later, 3, 12), probability);
+    //Past maxSum, and without the 4 the root has
+    TEST_ASSERT_FALSE(Endgame_lookup(&table, 0x2221ULL, NULL, NULL));
+    TEST_ASSERT_FALSE(Endgame_lookup(&table, 0x1111ULL, NULL, NULL));
+}
+
+void test_endgame_won(void) {
+    //Two 2s make a 4 with the first move
+    Bitboard root = 0x11ULL;
+    TEST_ASSERT_EQUAL(0, Endgame_build(TABLE, &root, 1, 2, 8, 1, NULL));
+    TEST_ASSERT_EQUAL(0, Endgame_open(&table, TABLE));
+    Direction move;
+    double probability;
+    TEST_ASSERT_TRUE(Endgame_lookup(&table, root, &move, &probability));
+    TEST_ASSERT_FLOAT_WITHIN(1e-12, 1, probability);
+    TEST_ASSERT_EQUAL(2, Bitboard_maxExponent(Bitboard_shift(root, move, NULL)));
+}
+
+void test_endgame_rejects(void) {
+    //Already has the goal, and over maxSum
+    Bitboard won = 0x3ULL, big = 0x44ULL;
+    TEST_ASSERT_EQUAL(-1, Endgame_build(TABLE, &won, 1, 3, 16, 1, NULL));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    TEST_ASSERT_EQUAL(-1, Endgame_build(TABLE, &big, 1, 6, 16, 1, NULL));
+    FILE *file = fopen(TABLE, "wb");
+    fputs("not a table, but long enough for a header", file);
+    fclose(file);
+    TEST_ASSERT_EQUAL(-1, Endgame_open(&table, TABLE));
+    TEST_ASSERT_EQUAL(-1, Endgame_open(&table, "missing.bin"));
+    TEST_ASSERT_FALSE(Endgame_lookup(&table, 0x1ULL, NULL, NULL));
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_endgame_exact);
+RUN_TEST(test_endgame_won);
+RUN_TEST(test_endgame_rejects);
+return UNITY_END();
+}
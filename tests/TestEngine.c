@@ -0,0 +1,62 @@
+#include "unity.h"
+#include "Bitboard.h"
+#include "Engine.h"
+
+//2 2 4 . on the top row, game over, empty
+static const uint64_t start[3] = {0x0000000000000211ULL, 0x1212212112122121ULL, 0};
+
+void test_engine_move(void) {
+    TEST_ASSERT_EQUAL(ENGINE_ABI_VERSION, Engine_abiVersion());
+    uint64_t boards[3] = {start[0], start[1], start[2]};
+    uint32_t scores[3];
+    TEST_ASSERT_EQUAL(1, Engine_move(boards, 3, LEFT, boards, scores));
+    TEST_ASSERT_EQUAL_HEX64(0x0000000000000022ULL, boards[0]);
+    TEST_ASSERT_EQUAL_HEX64(start[1], boards[1]);
+    TEST_ASSERT_EQUAL_UINT32(4, scores[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, scores[1]);
+    //Into a separate array without scores
+    uint64_t results[3];
+    TEST_ASSERT_EQUAL(1, Engine_move(start, 3, RIGHT, results, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0x2200ULL, results[0]);
+}
+
+void test_engine_moves(void) {
+    uint64_t results[12];
+    uint32_t scores[12];
+    uint8_t masks[3];
+    Engine_moves(start, 3, results, scores, masks);
+    for (uint8_t i = 0; i < 3; i++)
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            uint32_t score = 0;
+            TEST_ASSERT_EQUAL_HEX64(Bitboard_shift(start[i], dir, &score), results[4 * i + dir]);
+            TEST_ASSERT_EQUAL_UINT32(score, scores[4 * i + dir]);
+        }
+    TEST_ASSERT_EQUAL_HEX8((1 << LEFT) | (1 << RIGHT) | (1 << DOWN), masks[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, masks[1]);
+    uint8_t legal[3];
+    Engine_legal(start, 3, legal);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(masks, legal, 3);
+}
+
+void test_engine_spawn(void) {
+    uint64_t boards[3] = {start[0], start[1], start[2]};
+    uint64_t again[3] = {start[0], start[1], start[2]};
+    uint64_t state = Engine_spawn(boards, 3, 42);
+    TEST_ASSERT_TRUE(state != 42);
+    //One new tile on the boards with room, none on the full one
+    TEST_ASSERT_EQUAL(Bitboard_empty(start[0]) - 1, Bitboard_empty(boards[0]));
+    TEST_ASSERT_EQUAL_HEX64(start[1], boards[1]);
+    TEST_ASSERT_EQUAL(15, Bitboard_empty(boards[2]));
+    //The same state gives the same tiles
+    TEST_ASSERT_EQUAL_UINT64(state, Engine_spawn(again, 3, 42));
+    TEST_ASSERT_EQUAL_MEMORY(boards, again, sizeof boards);
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_engine_move);
+RUN_TEST(test_engine_moves);
+RUN_TEST(test_engine_spawn);
+return UNITY_END();
+}
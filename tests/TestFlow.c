@@ -0,0 +1,107 @@
+#include <stdarg.h>
+#include <string.h>
+#include "unity.h"
+#include "Flow.h"
+
+//Everything printed, in place of the UART
+static char output[256];
+static uint8_t enters;
+static uint8_t saves;
+static uint8_t calls;
+//Lines the prompts read, in turn
+static const char *const *lines;
+
+int printf_P(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t used = strlen(output);
+    int length = vsnprintf(output + used, sizeof output - used, format, args);
+    va_end(args);
+    return length;
+}
+
+static void getEnter(void) { enters++; }
+static void save(void) { saves++; }
+static void action(void) { calls++; }
+
+static void getInput(char *str, size_t size) {
+    strncpy(str, *lines++, size - 1);
+    str[size - 1] = '\0';
+}
+
+static const char one[] = "one";
+static const char two[] = "two";
+static const char yes[] = "y";
+static const char password[] = "open";
+static PGM_P const strings[] = {one, two, yes, password};
+static const FlowAction actions[] = {action};
+static uint8_t settings[2];
+
+static void run(const uint8_t *program) {
+    const Flow flow = {program, strings, actions, save, getEnter, getInput};
+    Flow_run(&flow, settings);
+}
+
+void setUp(void) {
+    output[0] = '\0';
+    enters = saves = calls = 0;
+    memset(settings, 0, sizeof settings);
+}
+
+void test_flow_pages(void) {
+    static const uint8_t program[] = {FLOW_PAGE, 0, FLOW_PRINT, 1, FLOW_END};
+    run(program);
+    TEST_ASSERT_EQUAL_STRING("one\n\ntwo", output);
+    TEST_ASSERT_EQUAL(1, enters);
+}
+
+void test_flow_menu(void) {
+    static const uint8_t program[] = {
+        /* 0 */ FLOW_PROMPT, 0, 2,
+        /* 3 */ FLOW_MATCH, 2, 9,
+        /* 6 */ FLOW_SET, 0, 5,
+        /* 9 */ FLOW_IF, 0, 5, 15,
+        /* 13 */ FLOW_CALL, 0,
+        /* 15 */ FLOW_END
+    };
+    //Anything but y sets the first setting, which skips the call
+    const char *const no[] = {"no"};
+    lines = no;
+    run(program);
+    TEST_ASSERT_EQUAL(5, settings[0]);
+    TEST_ASSERT_EQUAL(1, saves);
+    TEST_ASSERT_EQUAL(0, calls);
+    //A prompt of size 2 only reads one character
+    const char *const y[] = {"yes"};
+    lines = y;
+    settings[0] = 0;
+    run(program);
+    TEST_ASSERT_EQUAL(0, settings[0]);
+    TEST_ASSERT_EQUAL(1, calls);
+}
+
+void test_flow_password(void) {
+    static const uint8_t program[] = {
+        /* 0 */ FLOW_PROMPT, 0, FLOW_LINE,
+        /* 3 */ FLOW_MATCH, 3, 10,
+        /* 6 */ FLOW_PRINT, 1,
+        /* 8 */ FLOW_JUMP, 0,
+        /* 10 */ FLOW_SET, 1, 1,
+        /* 13 */ FLOW_END
+    };
+    const char *const tries[] = {"shut", "opened", "open"};
+    lines = tries;
+    run(program);
+    TEST_ASSERT_EQUAL_STRING("onetwoonetwoone", output);
+    TEST_ASSERT_EQUAL(1, settings[1]);
+    TEST_ASSERT_TRUE(lines == tries + 3);
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_flow_pages);
+RUN_TEST(test_flow_menu);
+RUN_TEST(test_flow_password);
+return UNITY_END();
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include "unity.h"
+#include "Heuristic.h"
+
+#define WEIGHTS "TestHeuristic.txt"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+    remove(WEIGHTS);
+}
+
+void test_heuristic_features(void) {
+    int32_t features[HEURISTIC_FEATURES];
+    //Top row 2 2 4 8: in order, one merge, the 8 in a corner
+    Heuristic_features(0x3211ULL, features);
+    TEST_ASSERT_EQUAL(12, features[HEURISTIC_EMPTY]);
+    TEST_ASSERT_EQUAL(1, features[HEURISTIC_MERGES]);
+    TEST_ASSERT_EQUAL(0, features[HEURISTIC_MONOTONICITY]);
+    TEST_ASSERT_EQUAL(3, features[HEURISTIC_CORNER]);
+    const float weights[HEURISTIC_FEATURES] = {1, 2, 3, 4};
+    TEST_ASSERT_EQUAL_FLOAT(26, Heuristic_value(weights, 0x3211ULL));
+    //Top row 2 8 4 _: 2 out of order either way, the 8 off the corner
+    Heuristic_features(0x0231ULL, features);
+    TEST_ASSERT_EQUAL(13, features[HEURISTIC_EMPTY]);
+    TEST_ASSERT_EQUAL(0, features[HEURISTIC_MERGES]);
+    TEST_ASSERT_EQUAL(-2, features[HEURISTIC_MONOTONICITY]);
+    TEST_ASSERT_EQUAL(0, features[HEURISTIC_CORNER]);
+    //Columns count too
+    Heuristic_features(Bitboard_transpose(0x3211ULL), features);
+    TEST_ASSERT_EQUAL(1, features[HEURISTIC_MERGES]);
+}
+
+void test_heuristic_play(void) {
+    uint32_t moves, again;
+    uint32_t score = Heuristic_play(Heuristic_defaults, 12345, &moves);
+    TEST_ASSERT_TRUE(moves > 0);
+    TEST_ASSERT_TRUE(score > 0);
+    //The same seed is the same game
+    TEST_ASSERT_EQUAL_UINT32(score, Heuristic_play(Heuristic_defaults, 12345, &again));
+    TEST_ASSERT_EQUAL_UINT32(moves, again);
+    //A right column of 2 4 2 4 can only move left
+    TEST_ASSERT_EQUAL(LEFT, Heuristic_move(Heuristic_defaults, 0x2000100020001000ULL));
+}
+
+void test_heuristic_save(void) {
+    const float weights[HEURISTIC_FEATURES] = {1.5f, -2, 0.25f, 1e6f};
+    float loaded[HEURISTIC_FEATURES] = {0};
+    TEST_ASSERT_EQUAL(0, Heuristic_save(weights, WEIGHTS));
+    TEST_ASSERT_EQUAL(0, Heuristic_load(loaded, WEIGHTS));
+    TEST_ASSERT_EQUAL_MEMORY(weights, loaded, sizeof weights);
+    FILE *file = fopen(WEIGHTS, "w");
+    fputs("empty 1\nluck 2\n", file);
+    fclose(file);
+    TEST_ASSERT_EQUAL(-1, Heuristic_load(loaded, WEIGHTS));
+    TEST_ASSERT_EQUAL(-1, Heuristic_load(loaded, "missing.txt"));
+}
+
+int main(void)
+{
+Bitboard_setup();
+Heuristic_setup();
+UNITY_BEGIN();
+RUN_TEST(test_heuristic_features);
+RUN_TEST(test_heuristic_play);
+RUN_TEST(test_heuristic_save);
+return UNITY_END();
+}
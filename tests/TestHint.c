@@ -0,0 +1,86 @@
+#include "unity.h"
+#include "Hint.h"
+
+static Boolean never(void) {
+    return FALSE;
+}
+
+static Boolean always(void) {
+    return TRUE;
+}
+
+void test_hint_only_move(void) {
+    // Only down changes this board
+    uint16_t grid[4][4] = {
+        {2,4,2,4},
+        {4,2,4,2},
+        {2,4,2,4},
+        {0,0,0,0}
+    };
+    Board board = Board_newBoard(grid);
+    TEST_ASSERT_EQUAL_INT(DOWN,Hint_search(&board,1,never));
+    TEST_ASSERT_EQUAL_INT(DOWN,Hint_search(&board,2,never));
+    TEST_ASSERT_EQUAL_INT(DOWN,Hint_suggest(&board,never));
+}
+
+void test_hint_no_move(void) {
+    uint16_t grid[4][4] = {
+        {2,4,2,4},
+        {4,2,4,2},
+        {2,4,2,4},
+        {4,2,4,2}
+    };
+    Board board = Board_newBoard(grid);
+    TEST_ASSERT_EQUAL_INT(-1,Hint_search(&board,2,never));
+    TEST_ASSERT_EQUAL_INT(-1,Hint_suggest(&board,never));
+}
+
+void test_hint_merge_into_corner(void) {
+    // Merging the 1024s to the left puts 2048 in the corner
+    uint16_t grid[4][4] = {
+        {1024,1024,0,0},
+        {0,0,0,0},
+        {0,0,0,0},
+        {0,0,0,2}
+    };
+    Board board = Board_newBoard(grid);
+    TEST_ASSERT_EQUAL_INT(LEFT,Hint_search(&board,1,never));
+    TEST_ASSERT_EQUAL_INT(LEFT,Hint_suggest(&board,never));
+}
+
+void test_hint_expired(void) {
+    uint16_t grid[4][4] = {
+        {2,0,0,0},
+        {0,0,0,0},
+        {0,0,0,0},
+        {0,0,0,2}
+    };
+    Board board = Board_newBoard(grid);
+    TEST_ASSERT_EQUAL_INT(-1,Hint_search(&board,2,always));
+    // The one move search always finishes
+    TEST_ASSERT_EQUAL_INT(Hint_search(&board,1,never),Hint_suggest(&board,always));
+}
+
+void test_hint_leaves_board(void) {
+    uint16_t grid[4][4] = {
+        {2,2,0,0},
+        {0,4,0,0},
+        {0,0,8,0},
+        {0,0,0,16}
+    };
+    Board board = Board_newBoard(grid);
+    Board copy = board;
+    Hint_suggest(&board,never);
+    TEST_ASSERT_TRUE(Board_equal(&board,&copy));
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_hint_only_move);
+RUN_TEST(test_hint_no_move);
+RUN_TEST(test_hint_merge_into_corner);
+RUN_TEST(test_hint_expired);
+RUN_TEST(test_hint_leaves_board);
+return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "unity.h"
+#include "HintServer.h"
+
+#define SOCKET "TestHintServer.sock"
+
+static const char *const tuples[] = {"0123"};
+static NTuple net;
+static HintServer server;
+static pthread_t thread;
+static int fd;
+
+static void *serve(void *arg) {
+    HintServer_run(&server);
+    return NULL;
+}
+
+/**
+ * Starts a server with threads search threads and connects to it
+ */
+static void start(int threads) {
+    HintOptions options = {&net, NULL, NULL, threads, 1, 10, 3, NULL};
+    TEST_ASSERT_EQUAL(0, HintServer_create(&server, SOCKET, &options));
+    pthread_create(&thread, NULL, serve, NULL);
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SOCKET);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *) &address, sizeof address));
+}
+
+static void request(uint8_t type, uint32_t id, Bitboard board, uint16_t deadline) {
+    HintRequest request = {type, 0, deadline, id, board};
+    TEST_ASSERT_EQUAL(sizeof request, write(fd, &request, sizeof request));
+}
+
+static void receive(void *data, size_t length) {
+    size_t got = 0;
+    while (got < length) {
+        ssize_t n = read(fd, (uint8_t *) data + got, length - got);
+        TEST_ASSERT_TRUE(n > 0);
+        got += n;
+    }
+}
+
+static void stats(HintStats *stats) {
+    HintReply reply;
+    request(HINT_STATS, 99, 0, 0);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_EQUAL(HINT_STATS, reply.type);
+    TEST_ASSERT_EQUAL_UINT32(99, reply.id);
+    receive(stats, sizeof *stats);
+}
+
+void setUp(void) {
+    TEST_ASSERT_EQUAL(0, NTuple_create(&net, tuples, 1, 16));
+}
+
+void tearDown(void) {
+    close(fd);
+    HintServer_stop(&server);
+    pthread_join(thread, NULL);
+    HintServer_free(&server);
+    NTuple_free(&net);
+}
+
+void test_hint_greedy(void) {
+    start(0);
+    //With a network of zeros the move with the biggest merge wins
+    HintReply reply;
+    request(HINT_MOVE, 7, 0x1121ULL, 0);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_EQUAL(HINT_MOVE, reply.type);
+    TEST_ASSERT_EQUAL_UINT32(7, reply.id);
+    TEST_ASSERT_EQUAL(HINT_GREEDY, reply.source);
+    TEST_ASSERT_FALSE(reply.cached);
+    TEST_ASSERT_EQUAL_FLOAT(4, reply.value);
+    uint32_t score = 0;
+    Bitboard_shift(0x1121ULL, reply.move, &score);
+    TEST_ASSERT_EQUAL_UINT32(4, score);
+    //A mirror image comes from the cache, moved the same way
+    request(HINT_MOVE, 8, Bitboard_transpose(0x1121ULL), 0);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_TRUE(reply.cached);
+    score = 0;
+    Bitboard_shift(Bitboard_transpose(0x1121ULL), reply.move, &score);
+    TEST_ASSERT_EQUAL_UINT32(4, score);
+    //No moves left
+    request(HINT_MOVE, 9, 0x1212212112122121ULL, 0);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_EQUAL(-1, reply.move);
+    HintStats counts;
+    stats(&counts);
+    TEST_ASSERT_EQUAL_UINT32(3, counts.requests);
+    TEST_ASSERT_EQUAL_UINT32(1, counts.cacheHits);
+    TEST_ASSERT_EQUAL_UINT32(1, counts.clients);
+}
+
+void test_hint_batch(void) {
+    start(0);
+    //Sent together, so they are valued together
+    HintRequest requests[40];
+    for (uint32_t i = 0; i < 40; i++)
+        requests[i] = (HintRequest) {HINT_MOVE, 0, 0, i, 0x1ULL << (4 * (i % 16)) | (Bitboard) (1 + i / 16) << 60};
+    TEST_ASSERT_EQUAL(sizeof requests, write(fd, requests, sizeof requests));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < 40; i++) {
+        HintReply reply;
+        receive(&reply, sizeof reply);
+        TEST_ASSERT_TRUE(reply.id < 40);
+        seen |= 1ULL << reply.id;
+    }
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 40) - 1, seen);
+    HintStats counts;
+    stats(&counts);
+    TEST_ASSERT_EQUAL_UINT32(40, counts.requests);
+    TEST_ASSERT_EQUAL_UINT32(counts.requests - counts.cacheHits, counts.batched);
+    TEST_ASSERT_TRUE(counts.batches < counts.batched);
+}
+
+void test_hint_search(void) {
+    start(1);
+    HintReply reply;
+    request(HINT_MOVE, 1, 0x21000012ULL, 50);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_EQUAL(HINT_SEARCH, reply.source);
+    TEST_ASSERT_TRUE(reply.depth >= 1);
+    TEST_ASSERT_TRUE(reply.move >= 0);
+    //The searched answer is cached for requests without time to search
+    request(HINT_MOVE, 2, 0x21000012ULL, 0);
+    receive(&reply, sizeof reply);
+    TEST_ASSERT_EQUAL(HINT_SEARCH, reply.source);
+    TEST_ASSERT_TRUE(reply.cached);
+    HintStats counts;
+    stats(&counts);
+    TEST_ASSERT_EQUAL_UINT32(1, counts.searches);
+}
+
+void test_hint_rejects(void) {
+    start(0);
+    //An unknown request closes the connection
+    request(7, 1, 0x1ULL, 0);
+    uint8_t byte;
+    TEST_ASSERT_EQUAL(0, read(fd, &byte, 1));
+    HintOptions options = {NULL, NULL, NULL, 0, 1, 10, 3, NULL};
+    HintServer other;
+    TEST_ASSERT_EQUAL(-1, HintServer_create(&other, "other.sock", &options));
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_hint_greedy);
+RUN_TEST(test_hint_batch);
+RUN_TEST(test_hint_search);
+RUN_TEST(test_hint_rejects);
+return UNITY_END();
+}
@@ -0,0 +1,64 @@
+#include "unity.h"
+#include "Latency.h"
+
+void setUp(void) {
+    Latency_clear();
+}
+
+void tearDown(void) {
+}
+
+void test_latency_buckets(void) {
+    Latency_record(LATENCY_SHIFT, 0);
+    Latency_record(LATENCY_SHIFT, 1);
+    Latency_record(LATENCY_SHIFT, 2);
+    Latency_record(LATENCY_SHIFT, 3);
+    Latency_record(LATENCY_SHIFT, 4);
+    Latency_record(LATENCY_SHIFT, 1000);
+    const LatencyHistogram *histogram = Latency_get(LATENCY_SHIFT);
+    TEST_ASSERT_EQUAL_INT(2,histogram->counts[0]);
+    TEST_ASSERT_EQUAL_INT(2,histogram->counts[1]);
+    TEST_ASSERT_EQUAL_INT(1,histogram->counts[2]);
+    // 512 <= 1000 < 1024
+    TEST_ASSERT_EQUAL_INT(1,histogram->counts[9]);
+    TEST_ASSERT_EQUAL_INT(1000,histogram->max);
+}
+
+void test_latency_last_bucket(void) {
+    Latency_record(LATENCY_DRAIN, 1UL << (LATENCY_BUCKETS - 1));
+    Latency_record(LATENCY_DRAIN, 0xFFFFFFFF);
+    const LatencyHistogram *histogram = Latency_get(LATENCY_DRAIN);
+    TEST_ASSERT_EQUAL_INT(2,histogram->counts[LATENCY_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL_INT(0,histogram->counts[LATENCY_BUCKETS - 2]);
+}
+
+void test_latency_phases_apart(void) {
+    Latency_record(LATENCY_RENDER, 5);
+    TEST_ASSERT_EQUAL_INT(0,Latency_get(LATENCY_SPAWN)->counts[2]);
+    TEST_ASSERT_EQUAL_INT(0,Latency_get(LATENCY_SPAWN)->max);
+    TEST_ASSERT_EQUAL_INT(1,Latency_get(LATENCY_RENDER)->counts[2]);
+}
+
+void test_latency_saturates(void) {
+    for (uint32_t i = 0; i < 70000; i++)
+        Latency_record(LATENCY_RECIEVE, 0);
+    TEST_ASSERT_EQUAL_INT(65535,Latency_get(LATENCY_RECIEVE)->counts[0]);
+}
+
+void test_latency_clear(void) {
+    Latency_record(LATENCY_SPAWN, 7);
+    Latency_clear();
+    TEST_ASSERT_EQUAL_INT(0,Latency_get(LATENCY_SPAWN)->counts[2]);
+    TEST_ASSERT_EQUAL_INT(0,Latency_get(LATENCY_SPAWN)->max);
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_latency_buckets);
+RUN_TEST(test_latency_last_bucket);
+RUN_TEST(test_latency_phases_apart);
+RUN_TEST(test_latency_saturates);
+RUN_TEST(test_latency_clear);
+return UNITY_END();
+}
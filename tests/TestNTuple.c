@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "unity.h"
+#include "NTuple.h"
+
+#define WEIGHTS "TestNTuple.ntw"
+
+static const char *const tuples[] = {"0123", "048c5"};
+static NTuple net;
+
+void setUp(void) {
+    TEST_ASSERT_EQUAL(0, NTuple_create(&net, tuples, 2, 16));
+}
+
+void tearDown(void) {
+    NTuple_free(&net);
+    remove(WEIGHTS);
+}
+
+void test_ntuple_create(void) {
+    const char *const bad[] = {"01g"};
+    NTuple other;
+    TEST_ASSERT_EQUAL(-1, NTuple_create(&other, bad, 1, 16));
+    TEST_ASSERT_EQUAL_UINT32(65536, NTuple_tableSize(&net, 0));
+    TEST_ASSERT_EQUAL_UINT32(1048576, NTuple_tableSize(&net, 1));
+    TEST_ASSERT_EQUAL_FLOAT(0, NTuple_value(&net, 0x123456789ULL));
+}
+
+void test_ntuple_update(void) {
+    Bitboard board = 0x0000000000002121ULL;
+    uint32_t indices[8 * NTUPLE_MAX_TUPLES];
+    NTuple_indices(&net, board, indices);
+    NTuple_update(&net, board, 0.5f);
+    //Every lookup had 0.5 added once for each lookup sharing its weight
+    float expected = 0;
+    for (uint8_t i = 0; i < 16; i++)
+        for (uint8_t j = 0; j < 16; j++)
+            if (i % 2 == j % 2 && indices[i] == indices[j])
+                expected += 0.5f;
+    TEST_ASSERT_EQUAL_FLOAT(expected, NTuple_value(&net, board));
+    //Same weights in a mirror image
+    TEST_ASSERT_EQUAL_FLOAT(expected, NTuple_value(&net, 0x1212000000000000ULL));
+}
+
+void test_ntuple_save_load(void) {
+    NTuple_update(&net, 0x0000000000002121ULL, 0.5f);
+    NTuple_update(&net, 0x00000000000B0001ULL, -1.25f);
+    TEST_ASSERT_EQUAL(0, NTuple_save(&net, WEIGHTS, 16));
+    NTuple loaded;
+    TEST_ASSERT_EQUAL(0, NTuple_load(&loaded, WEIGHTS));
+    TEST_ASSERT_EQUAL_UINT8(2, loaded.count);
+    TEST_ASSERT_EQUAL_UINT8(5, loaded.size[1]);
+    TEST_ASSERT_EQUAL_UINT8(0xc, loaded.cells[1][3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, NTuple_value(&net, 0x2121ULL), NTuple_value(&loaded, 0x2121ULL));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, NTuple_value(&net, 0xB0001ULL), NTuple_value(&loaded, 0xB0001ULL));
+    NTuple_free(&loaded);
+}
+
+void test_ntuple_trim(void) {
+    //Cells 0 and 1 hold 256 and 512, which a base of 8 stores as 128
+    NTuple_update(&net, 0x98ULL, 1.0f);
+    NTuple trimmed;
+    TEST_ASSERT_EQUAL(0, NTuple_trim(&net, &trimmed, 4, 8));
+    TEST_ASSERT_EQUAL_UINT8(1, trimmed.count);
+    TEST_ASSERT_EQUAL_UINT32(4096, NTuple_tableSize(&trimmed, 0));
+    //The old weight is averaged with the other boards that now share its slot
+    float weight = trimmed.weights[0][7 + 7 * 8];
+    TEST_ASSERT_TRUE(weight > 0);
+    TEST_ASSERT_TRUE(weight < 1.0f);
+    NTuple_free(&trimmed);
+    TEST_ASSERT_EQUAL(-1, NTuple_trim(&net, &trimmed, 3, 8));
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_ntuple_create);
+RUN_TEST(test_ntuple_update);
+RUN_TEST(test_ntuple_save_load);
+RUN_TEST(test_ntuple_trim);
+return UNITY_END();
+}
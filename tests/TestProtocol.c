@@ -0,0 +1,42 @@
+#include "unity.h"
+#include "Protocol.h"
+
+void test_protocol_frame(void) {
+    uint16_t grid[4][4] = {
+        {0,2,4,8},
+        {16,32,64,128},
+        {256,512,1024,2048},
+        {4096,8192,16384,32768}
+    };
+    Board board = Board_newBoard(grid);
+    uint8_t frame[PROTOCOL_FRAME_SIZE];
+    uint8_t expected[PROTOCOL_FRAME_SIZE] = {0xA5,0x10,0x32,0x54,0x76,0x98,0xBA,0xDC,0xFE,0xF0};
+    Protocol_frame(&board, PROTOCOL_MOVED | PROTOCOL_WON, frame);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected,frame,PROTOCOL_FRAME_SIZE);
+}
+
+void test_protocol_frame_blank(void) {
+    Board board = Board_newBlankBoard();
+    uint8_t frame[PROTOCOL_FRAME_SIZE];
+    uint8_t expected[PROTOCOL_FRAME_SIZE] = {0xA0,0,0,0,0,0,0,0,0,0x36};
+    Protocol_frame(&board, 0, frame);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected,frame,PROTOCOL_FRAME_SIZE);
+}
+
+void test_protocol_checksum_covers_flags(void) {
+    Board board = Board_newBlankBoard();
+    uint8_t moved[PROTOCOL_FRAME_SIZE];
+    uint8_t over[PROTOCOL_FRAME_SIZE];
+    Protocol_frame(&board, PROTOCOL_MOVED, moved);
+    Protocol_frame(&board, PROTOCOL_OVER, over);
+    TEST_ASSERT_NOT_EQUAL(moved[PROTOCOL_FRAME_SIZE - 1],over[PROTOCOL_FRAME_SIZE - 1]);
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_protocol_frame);
+RUN_TEST(test_protocol_frame_blank);
+RUN_TEST(test_protocol_checksum_covers_flags);
+return UNITY_END();
+}
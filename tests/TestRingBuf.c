@@ -42,6 +42,131 @@ void test_buffer_pop(void) {
     TEST_ASSERT_EQUAL_INT(3,data);
 }
 
+void test_spsc_empty(void) {
+    uint8_t data;
+    SPSC_RINGBUF_DEF(buf,32);
+    TEST_ASSERT_EQUAL_INT(-1,spscRingBufPop(&buf,&data));
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufCount(&buf));
+    TEST_ASSERT_EQUAL_INT(32,spscRingBufFree(&buf));
+}
+
+void test_spsc_full(void) {
+    uint8_t data;
+    SPSC_RINGBUF_DEF(buf,4);
+    //Every slot is used
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(0,spscRingBufPush(&buf,i));
+    TEST_ASSERT_EQUAL_INT(-1,spscRingBufPush(&buf,4));
+    TEST_ASSERT_EQUAL_INT(4,spscRingBufCount(&buf));
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufFree(&buf));
+    spscRingBufPop(&buf,&data);
+    TEST_ASSERT_EQUAL_INT(0,data);
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufPush(&buf,4));
+}
+
+void test_spsc_pop(void) {
+    uint8_t data;
+    SPSC_RINGBUF_DEF(buf,2);
+    spscRingBufPush(&buf,1);
+    spscRingBufPush(&buf,2);
+    spscRingBufPop(&buf,&data);
+    TEST_ASSERT_EQUAL_INT(1,data);
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufPush(&buf,3));
+    spscRingBufPop(&buf,&data);
+    TEST_ASSERT_EQUAL_INT(2,data);
+    spscRingBufPop(&buf,&data);
+    TEST_ASSERT_EQUAL_INT(3,data);
+    TEST_ASSERT_EQUAL_INT(-1,spscRingBufPop(&buf,&data));
+}
+
+void test_spsc_index_wrap(void) {
+    uint8_t data;
+    SPSC_RINGBUF_DEF(buf,128);
+    //Run the 8 bit indices around several times with the buffer partly full
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_INT(0,spscRingBufPush(&buf,(uint8_t) i));
+        if (i >= 100) {
+            TEST_ASSERT_EQUAL_INT(0,spscRingBufPop(&buf,&data));
+            TEST_ASSERT_EQUAL_INT((uint8_t) (i - 100),data);
+            TEST_ASSERT_EQUAL_INT(100,spscRingBufCount(&buf));
+            TEST_ASSERT_EQUAL_INT(28,spscRingBufFree(&buf));
+        }
+    }
+}
+
+void test_spsc_bulk(void) {
+    uint8_t in[6] = {1,2,3,4,5,6};
+    uint8_t out[8] = {0};
+    SPSC_RINGBUF_DEF(buf,8);
+    TEST_ASSERT_EQUAL_INT(6,spscRingBufWrite(&buf,in,6));
+    TEST_ASSERT_EQUAL_INT(4,spscRingBufRead(&buf,out,4));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in,out,4);
+    //Wraps around the end of the storage, only 6 of the 6 + 2 fit
+    TEST_ASSERT_EQUAL_INT(6,spscRingBufWrite(&buf,in,6));
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufWrite(&buf,in,1));
+    TEST_ASSERT_EQUAL_INT(8,spscRingBufRead(&buf,out,8));
+    uint8_t expected[8] = {5,6,1,2,3,4,5,6};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected,out,8);
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufRead(&buf,out,1));
+}
+
+void test_spsc_spans(void) {
+    void *writeSpan;
+    const void *readSpan;
+    uint8_t data;
+    SPSC_RINGBUF_DEF(buf,4);
+    spscRingBufPush(&buf,1);
+    spscRingBufPush(&buf,2);
+    spscRingBufPush(&buf,3);
+    spscRingBufPop(&buf,&data);
+    spscRingBufPop(&buf,&data);
+    //One free slot at the end of the storage, then one at the start
+    TEST_ASSERT_EQUAL_INT(1,spscRingBufPeekWrite(&buf,&writeSpan));
+    TEST_ASSERT_EQUAL_PTR(buf.buffer + 3,writeSpan);
+    ((uint8_t *) writeSpan)[0] = 4;
+    //Nothing is visible until committed
+    TEST_ASSERT_EQUAL_INT(1,spscRingBufCount(&buf));
+    spscRingBufCommitWrite(&buf,1);
+    TEST_ASSERT_EQUAL_INT(2,spscRingBufCount(&buf));
+    TEST_ASSERT_EQUAL_INT(2,spscRingBufPeekWrite(&buf,&writeSpan));
+    TEST_ASSERT_EQUAL_PTR(buf.buffer,writeSpan);
+    ((uint8_t *) writeSpan)[0] = 5;
+    spscRingBufCommitWrite(&buf,1);
+
+    TEST_ASSERT_EQUAL_INT(2,spscRingBufPeekRead(&buf,&readSpan));
+    TEST_ASSERT_EQUAL_INT(3,((const uint8_t *) readSpan)[0]);
+    TEST_ASSERT_EQUAL_INT(4,((const uint8_t *) readSpan)[1]);
+    spscRingBufCommitRead(&buf,2);
+    TEST_ASSERT_EQUAL_INT(1,spscRingBufPeekRead(&buf,&readSpan));
+    TEST_ASSERT_EQUAL_INT(5,((const uint8_t *) readSpan)[0]);
+    spscRingBufCommitRead(&buf,1);
+    TEST_ASSERT_EQUAL_INT(0,spscRingBufPeekRead(&buf,&readSpan));
+}
+
+typedef struct {
+    uint8_t key;
+    uint16_t time;
+} event_t;
+
+void test_spsc_typed(void) {
+    event_t in[3] = {{'i',100},{'j',200},{'k',300}};
+    event_t out[3];
+    const void *span;
+    SPSC_RINGBUF_DEF_TYPED(events,event_t,4);
+    TEST_ASSERT_EQUAL_INT(4,spscRingBufFree(&events));
+    TEST_ASSERT_EQUAL_INT(3,spscRingBufWrite(&events,in,3));
+    TEST_ASSERT_EQUAL_INT(1,spscRingBufWrite(&events,in,3));
+    TEST_ASSERT_EQUAL_INT(4,spscRingBufCount(&events));
+    TEST_ASSERT_EQUAL_INT(4,spscRingBufPeekRead(&events,&span));
+    TEST_ASSERT_EQUAL_INT(200,((const event_t *) span)[1].time);
+    TEST_ASSERT_EQUAL_INT(3,spscRingBufRead(&events,out,3));
+    TEST_ASSERT_EQUAL_INT('k',out[2].key);
+    TEST_ASSERT_EQUAL_INT(300,out[2].time);
+    TEST_ASSERT_EQUAL_INT(1,spscRingBufRead(&events,out,3));
+    TEST_ASSERT_EQUAL_INT('i',out[0].key);
+    TEST_ASSERT_EQUAL_INT(100,out[0].time);
+}
+
 int main(void)
 {
 UNITY_BEGIN();
@@ -49,5 +174,12 @@ RUN_TEST(test_buffer_empty);
 RUN_TEST(test_buffer_push);
 RUN_TEST(test_buffer_full);
 RUN_TEST(test_buffer_pop);
+RUN_TEST(test_spsc_empty);
+RUN_TEST(test_spsc_full);
+RUN_TEST(test_spsc_pop);
+RUN_TEST(test_spsc_index_wrap);
+RUN_TEST(test_spsc_bulk);
+RUN_TEST(test_spsc_spans);
+RUN_TEST(test_spsc_typed);
 return UNITY_END();
 }
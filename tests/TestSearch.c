@@ -0,0 +1,79 @@
+#include "unity.h"
+#include "Search.h"
+
+//With all weights 0 a position is worth the score still to be made in it
+static const char *const tuples[] = {"0123"};
+static NTuple net;
+static Search search;
+
+void setUp(void) {
+    TEST_ASSERT_EQUAL(0, NTuple_create(&net, tuples, 1, 16));
+}
+
+void tearDown(void) {
+    Search_free(&search);
+    NTuple_free(&net);
+}
+
+void test_search_depth_one(void) {
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 1, FALSE, 1));
+    //4 4 . . on the top row, only left and right merge
+    SearchResult result = Search_best(&search, 0x22ULL, 0, 1);
+    TEST_ASSERT_EQUAL(1, result.depth);
+    TEST_ASSERT_TRUE(result.move == LEFT || result.move == RIGHT);
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, result.value);
+}
+
+void test_search_game_over(void) {
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 1, FALSE, 1));
+    SearchResult result = Search_best(&search, 0x1212212112122121ULL, 0, 3);
+    TEST_ASSERT_EQUAL(-1, result.move);
+}
+
+void test_search_threads_agree(void) {
+    Bitboard board = 0x0000012100230112ULL;
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 4, FALSE, 1));
+    SearchResult one = Search_best(&search, board, 0, 3);
+    Search_free(&search);
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 4, FALSE, 4));
+    SearchResult four = Search_best(&search, board, 0, 3);
+    TEST_ASSERT_EQUAL(3, four.depth);
+    TEST_ASSERT_EQUAL(one.move, four.move);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, one.value, four.value);
+}
+
+void test_search_table(void) {
+    Bitboard board = 0x0000012100230112ULL;
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 4, FALSE, 2));
+    SearchResult first = Search_best(&search, board, 0, 3);
+    //The same search again finds the chance nodes in the table
+    SearchResult again = Search_best(&search, board, 0, 3);
+    TEST_ASSERT_EQUAL(first.move, again.move);
+    TEST_ASSERT_EQUAL_FLOAT(first.value, again.value);
+    TEST_ASSERT_LESS_THAN(first.nodes, again.nodes);
+    //Threads racing to the same chance node both search it, so the count
+    //of nodes can change a little from one search to the next
+    Search_clear(&search);
+    SearchResult cleared = Search_best(&search, board, 0, 3);
+    TEST_ASSERT_LESS_THAN(cleared.nodes, again.nodes);
+}
+
+void test_search_deadline(void) {
+    TEST_ASSERT_EQUAL(0, Search_create(&search, &net, NULL, 4, FALSE, 2));
+    SearchResult result = Search_best(&search, 0x0000012100230112ULL, 0.02, SEARCH_MAX_DEPTH);
+    TEST_ASSERT_TRUE(result.depth >= 1 && result.depth < SEARCH_MAX_DEPTH);
+    TEST_ASSERT_TRUE(result.move >= 0);
+    TEST_ASSERT_LESS_THAN(0.5, result.seconds);
+}
+
+int main(void)
+{
+Bitboard_setup();
+UNITY_BEGIN();
+RUN_TEST(test_search_depth_one);
+RUN_TEST(test_search_game_over);
+RUN_TEST(test_search_threads_agree);
+RUN_TEST(test_search_table);
+RUN_TEST(test_search_deadline);
+return UNITY_END();
+}
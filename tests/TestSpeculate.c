@@ -0,0 +1,78 @@
+#include "unity.h"
+#include "Speculate.h"
+
+static Board board;
+static Speculation speculation;
+
+void setUp(void) {
+    uint16_t grid[4][4] = {
+        {2,2,4,0},
+        {0,4,8,0},
+        {0,0,16,0},
+        {0,0,0,2}
+    };
+    board = Board_newBoard(grid);
+    Speculate_begin(&speculation, 7, TRUE);
+}
+
+void test_speculate_nothing_ready(void) {
+    for (uint8_t dir = 0; dir < 4; dir++)
+        TEST_ASSERT_NULL(Speculate_get(&speculation, dir));
+}
+
+void test_speculate_one_step_at_a_time(void) {
+    TEST_ASSERT_TRUE(Speculate_step(&speculation, &board, 0));
+    TEST_ASSERT_NOT_NULL(Speculate_get(&speculation, LEFT));
+    TEST_ASSERT_NULL(Speculate_get(&speculation, RIGHT));
+    TEST_ASSERT_TRUE(Speculate_step(&speculation, &board, 0));
+    TEST_ASSERT_TRUE(Speculate_step(&speculation, &board, 0));
+    TEST_ASSERT_FALSE(Speculate_step(&speculation, &board, 0));
+    TEST_ASSERT_FALSE(Speculate_step(&speculation, &board, 0));
+    TEST_ASSERT_NOT_NULL(Speculate_get(&speculation, DOWN));
+}
+
+void test_speculate_matches_playing(void) {
+    while (Speculate_step(&speculation, &board, 100))
+        ;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        Board played = board;
+        uint32_t score = 100;
+        Boolean moved = Board_shiftScore(dir, &played, &score);
+        const SpeculatedMove *move = Speculate_get(&speculation, dir);
+        TEST_ASSERT_EQUAL(moved, move -> moved);
+        if (!moved)
+            continue;
+        Board_putRandom(&played, 7, TRUE);
+        Board ahead = Board_unpack(move -> board);
+        TEST_ASSERT_TRUE(Board_equal(&played, &ahead));
+        TEST_ASSERT_EQUAL_UINT32(score, move -> score);
+        TEST_ASSERT_EQUAL(Board_gameOver(&played), move -> over);
+    }
+}
+
+void test_speculate_game_over(void) {
+    uint16_t grid[4][4] = {
+        {2,4,2,4},
+        {4,2,4,2},
+        {2,4,2,4},
+        {8,16,8,0}
+    };
+    board = Board_newBoard(grid);
+    Speculate_begin(&speculation, 0, FALSE);
+    while (Speculate_step(&speculation, &board, 0))
+        ;
+    //Moving right fills the gap with a 4 and nothing can move after that
+    TEST_ASSERT_TRUE(Speculate_get(&speculation, RIGHT) -> moved);
+    TEST_ASSERT_TRUE(Speculate_get(&speculation, RIGHT) -> over);
+    TEST_ASSERT_FALSE(Speculate_get(&speculation, UP) -> moved);
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_speculate_nothing_ready);
+RUN_TEST(test_speculate_one_step_at_a_time);
+RUN_TEST(test_speculate_matches_playing);
+RUN_TEST(test_speculate_game_over);
+return UNITY_END();
+}
@@ -0,0 +1,136 @@
+#include <string.h>
+#include "unity.h"
+#include "Timer.h"
+
+// Stand-ins for the Clock and the HAL, the tests drive the tick themselves
+volatile uint32_t clockMillis;
+void Clock_speedUp(void) {}
+uint8_t HAL_interruptsSave(void) { return 1; }
+void HAL_interruptsRestore(const uint8_t *enabled) {}
+
+static uint8_t fired[8];
+static uint32_t firedAt[8];
+static Timer timers[8];
+
+static void count(Timer *timer) {
+    uint8_t i = timer - timers;
+    fired[i]++;
+    firedAt[i] = clockMillis;
+}
+
+/**
+ * Runs the clock forward one millisecond at a time
+ */
+static void advance(uint32_t ms) {
+    while (ms--) {
+        clockMillis++;
+        Timer_tick(clockMillis);
+    }
+}
+
+void setUp(void) {
+    clockMillis = 1000;
+    memset(timerWheel, 0, sizeof timerWheel);
+    memset(fired, 0, sizeof fired);
+    for (uint8_t i = 0; i < 8; i++)
+        Timer_init(&timers[i], count, 0);
+}
+
+void test_one_shot(void) {
+    Timer_arm(&timers[0], 5, 0);
+    TEST_ASSERT_TRUE(Timer_armed(&timers[0]));
+    advance(4);
+    TEST_ASSERT_EQUAL(0, fired[0]);
+    advance(1);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_FALSE(Timer_armed(&timers[0]));
+    advance(100);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+}
+
+void test_periodic(void) {
+    Timer_arm(&timers[0], 3, 10);
+    advance(53);
+    TEST_ASSERT_EQUAL(6, fired[0]);
+    TEST_ASSERT_EQUAL_UINT32(1053, firedAt[0]);
+    TEST_ASSERT_TRUE(Timer_armed(&timers[0]));
+}
+
+void test_past_wheel(void) {
+    //Same slot as a sooner timer, but further round the wheel
+    Timer_arm(&timers[0], 3 + 2 * TIMER_SLOTS, 0);
+    Timer_arm(&timers[1], 3, 0);
+    advance(3);
+    TEST_ASSERT_EQUAL(0, fired[0]);
+    TEST_ASSERT_EQUAL(1, fired[1]);
+    advance(2 * TIMER_SLOTS);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_EQUAL_UINT32(1003 + 2 * TIMER_SLOTS, firedAt[0]);
+}
+
+void test_cancel(void) {
+    //Cancelling from the middle, head and tail of a slot
+    for (uint8_t i = 0; i < 5; i++)
+        Timer_arm(&timers[i], 7, 0);
+    Timer_cancel(&timers[2]);
+    Timer_cancel(&timers[4]);
+    Timer_cancel(&timers[0]);
+    Timer_cancel(&timers[0]);
+    advance(7);
+    TEST_ASSERT_EQUAL(0, fired[0]);
+    TEST_ASSERT_EQUAL(1, fired[1]);
+    TEST_ASSERT_EQUAL(0, fired[2]);
+    TEST_ASSERT_EQUAL(1, fired[3]);
+    TEST_ASSERT_EQUAL(0, fired[4]);
+}
+
+void test_rearm(void) {
+    Timer_arm(&timers[0], 5, 0);
+    Timer_arm(&timers[0], 9, 0);
+    advance(20);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_EQUAL_UINT32(1009, firedAt[0]);
+}
+
+static void cancelBoth(Timer *timer) {
+    count(timer);
+    Timer_cancel(&timers[0]);
+    Timer_cancel(&timers[1]);
+}
+
+void test_cancel_from_callback(void) {
+    //Both periodic and due on the same tick, whichever goes first stops
+    //itself and takes the other off the due list
+    timers[0].callback = cancelBoth;
+    timers[1].callback = cancelBoth;
+    Timer_arm(&timers[0], 4, 4);
+    Timer_arm(&timers[1], 4, 4);
+    advance(20);
+    TEST_ASSERT_EQUAL(1, fired[0] + fired[1]);
+    TEST_ASSERT_FALSE(Timer_armed(&timers[0]));
+    TEST_ASSERT_FALSE(Timer_armed(&timers[1]));
+}
+
+void test_any_armed(void) {
+    TEST_ASSERT_FALSE(Timer_anyArmed());
+    Timer_arm(&timers[0], 3 + TIMER_SLOTS, 0);
+    Timer_arm(&timers[1], 2, 0);
+    TEST_ASSERT_TRUE(Timer_anyArmed());
+    Timer_cancel(&timers[1]);
+    TEST_ASSERT_TRUE(Timer_anyArmed());
+    advance(3 + TIMER_SLOTS);
+    TEST_ASSERT_FALSE(Timer_anyArmed());
+}
+
+int main(void)
+{
+UNITY_BEGIN();
+RUN_TEST(test_one_shot);
+RUN_TEST(test_periodic);
+RUN_TEST(test_past_wheel);
+RUN_TEST(test_cancel);
+RUN_TEST(test_rearm);
+RUN_TEST(test_cancel_from_callback);
+RUN_TEST(test_any_armed);
+return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include "Bitboard.h"
+
+#define ROWS 65536
+#define ROW_MASK 0xFFFFULL
+#define CELL_BITS 0x1111111111111111ULL
+
+// Every row shifted left and right, with the score the merges made
+static uint16_t leftRow[ROWS];
+static uint16_t rightRow[ROWS];
+static uint32_t leftScore[ROWS];
+static uint32_t rightScore[ROWS];
+
+/**
+ * Runs Board_shiftScore on row as the top row of an otherwise empty board
+ */
+static uint16_t shiftRow(uint16_t row, Direction dir, uint32_t *score) {
+    Board board = Board_newBlankBoard();
+    for (uint8_t col = 0; col < 4; col++) {
+        uint8_t exponent = (row >> (4 * col)) & 0x0F;
+        board.grid[0][col].value = exponent ? 1U << exponent : 0;
+    }
+    *score = 0;
+    Board_shiftScore(dir, &board, score);
+    return Bitboard_fromBoard(&board) & ROW_MASK;
+}
+
+void Bitboard_setup(void) {
+    for (uint32_t row = 0; row < ROWS; row++) {
+        leftRow[row] = shiftRow(row, LEFT, &leftScore[row]);
+        rightRow[row] = shiftRow(row, RIGHT, &rightScore[row]);
+    }
+}
+
+Bitboard Bitboard_fromBoard(Board *board) {
+    uint8_t packed[8];
+    Board_pack(board, packed);
+    Bitboard bits = 0;
+    for (uint8_t i = 0; i < 8; i++)
+        bits |= (Bitboard) packed[i] << (8 * i);
+    return bits;
+}
+
+Board Bitboard_toBoard(Bitboard board) {
+    uint8_t packed[8];
+    for (uint8_t i = 0; i < 8; i++)
+        packed[i] = board >> (8 * i);
+    return Board_unpack(packed);
+}
+
+Bitboard Bitboard_transpose(Bitboard x) {
+    Bitboard a1 = x & 0xF0F00F0FF0F00F0FULL;
+    Bitboard a2 = x & 0x0000F0F00000F0F0ULL;
+    Bitboard a3 = x & 0x0F0F00000F0F0000ULL;
+    Bitboard a = a1 | (a2 << 12) | (a3 >> 12);
+    Bitboard b1 = a & 0xFF00FF0000FF00FFULL;
+    Bitboard b2 = a & 0x00FF00FF00000000ULL;
+    Bitboard b3 = a & 0x00000000FF00FF00ULL;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+/**
+ * Shifts every row through one of the tables
+ */
+static Bitboard shiftRows(Bitboard board, const uint16_t rows[ROWS], const uint32_t scores[ROWS],
+        uint32_t *score) {
+    Bitboard result = 0;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        uint16_t row = board >> (16 * i);
+        result |= (Bitboard) rows[row] << (16 * i);
+        total += scores[row];
+    }
+    if (score)
+        *score += total;
+    return result;
+}
+
+Bitboard Bitboard_shift(Bitboard board, Direction dir, uint32_t *score) {
+    switch (dir) {
+        case LEFT:
+            return shiftRows(board, leftRow, leftScore, score);
+        case RIGHT:
+            return shiftRows(board, rightRow, rightScore, score);
+        // Columns are the rows of the transpose, with the top cell first
+        case UP:
+            return Bitboard_transpose(shiftRows(Bitboard_transpose(board), leftRow, leftScore, score));
+        default:
+            return Bitboard_transpose(shiftRows(Bitboard_transpose(board), rightRow, rightScore, score));
+    }
+}
+
+uint8_t Bitboard_moves(Bitboard board, Bitboard results[4], uint32_t scores[4]) {
+    Bitboard transposed = Bitboard_transpose(board);
+    uint8_t mask = 0;
+    for (uint8_t dir = 0; dir < 4; dir++)
+        scores[dir] = 0;
+    results[LEFT] = shiftRows(board, leftRow, leftScore, &scores[LEFT]);
+    results[RIGHT] = shiftRows(board, rightRow, rightScore, &scores[RIGHT]);
+    results[UP] = Bitboard_transpose(shiftRows(transposed, leftRow, leftScore, &scores[UP]));
+    results[DOWN] = Bitboard_transpose(shiftRows(transposed, rightRow, rightScore, &scores[DOWN]));
+    for (uint8_t dir = 0; dir < 4; dir++)
+        if (results[dir] != board)
+            mask |= 1 << dir;
+    return mask;
+}
+
+/**
+ * A 1 in the lowest bit of every empty cell
+ */
+static Bitboard emptyCells(Bitboard board) {
+    board |= board >> 2;
+    board |= board >> 1;
+    return ~board & CELL_BITS;
+}
+
+uint8_t Bitboard_empty(Bitboard board) {
+    return __builtin_popcountll(emptyCells(board));
+}
+
+Bitboard Bitboard_spawn(Bitboard board, uint32_t random, Boolean two) {
+    Bitboard empty = emptyCells(board);
+    uint8_t index = random % __builtin_popcountll(empty);
+    // Drop the lower empty cells to get to the one picked
+    while (index--)
+        empty &= empty - 1;
+    return board | (empty & -empty) * (two ? 1 : 2);
+}
+
+Boolean Bitboard_gameOver(Bitboard board) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    return Bitboard_moves(board, results, scores) ? FALSE : TRUE;
+}
+
+uint8_t Bitboard_maxExponent(Bitboard board) {
+    uint8_t max = 0;
+    for (; board; board >>= 4)
+        if ((board & 0x0F) > max)
+            max = board & 0x0F;
+    return max;
+}
+
+uint32_t Bitboard_tileSum(Bitboard board) {
+    uint32_t sum = 0;
+    for (; board; board >>= 4)
+        if (board & 0x0F)
+            sum += 1U << (board & 0x0F);
+    return sum;
+}
+
+/**
+ * Reverses the cells of every row
+ */
+static Bitboard flipColumns(Bitboard board) {
+    board = ((board & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((board & 0xF0F0F0F0F0F0F0F0ULL) >> 4);
+    return ((board & 0x00FF00FF00FF00FFULL) << 8) | ((board & 0xFF00FF00FF00FF00ULL) >> 8);
+}
+
+/**
+ * Reverses the order of the rows
+ */
+static Bitboard flipRows(Bitboard board) {
+    board = ((board & 0x0000FFFF0000FFFFULL) << 16) | ((board & 0xFFFF0000FFFF0000ULL) >> 16);
+    return (board << 32) | (board >> 32);
+}
+
+/*
+ * Symmetry i transposes if bit 2 is set, then reverses the rows of every
+ * column if bit 1 is and the cells of every row if bit 0 is
+ */
+void Bitboard_symmetries(Bitboard board, Bitboard out[8]) {
+    Bitboard transposed = Bitboard_transpose(board);
+    for (uint8_t i = 0; i < 8; i++) {
+        Bitboard b = i & 4 ? transposed : board;
+        if (i & 2)
+            b = flipRows(b);
+        if (i & 1)
+            b = flipColumns(b);
+        out[i] = b;
+    }
+}
+
+Bitboard Bitboard_canonical(Bitboard board) {
+    Bitboard all[8];
+    Bitboard_symmetries(board, all);
+    Bitboard min = all[0];
+    for (uint8_t i = 1; i < 8; i++)
+        if (all[i] < min)
+            min = all[i];
+    return min;
+}
+
+uint8_t Bitboard_canonicalIndex(Bitboard board) {
+    Bitboard all[8];
+    Bitboard_symmetries(board, all);
+    uint8_t min = 0;
+    for (uint8_t i = 1; i < 8; i++)
+        if (all[i] < all[min])
+            min = i;
+    return min;
+}
+
+Direction Bitboard_fromCanonical(uint8_t symmetry, Direction dir) {
+    // Undo the symmetry in reverse order
+    if (symmetry & 1) {
+        if (dir == LEFT || dir == RIGHT)
+            dir = dir == LEFT ? RIGHT : LEFT;
+    }
+    if (symmetry & 2) {
+        if (dir == UP || dir == DOWN)
+            dir = dir == UP ? DOWN : UP;
+    }
+    if (symmetry & 4) {
+        static const Direction transposed[4] = {UP, DOWN, LEFT, RIGHT};
+        dir = transposed[dir];
+    }
+    return dir;
+}
@@ -0,0 +1,116 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+/*
+ * A 2048 board packed into 64 bits for the host tools, which play millions
+ * of games and can't afford the 32 byte Board. The layout is the one
+ * Board_pack uses read as a little endian integer: 4 bits per cell holding
+ * the exponent of its value, cell (row, col) at bit 4 * (row * 4 + col).
+ *
+ * Shifts go through tables of every possible row, which Bitboard_setup
+ * builds by running Board_shiftScore on each one, so the rules are exactly
+ * the ones in util/Board.c.
+ */
+#include <stdint.h>
+#include "Board.h"
+
+typedef uint64_t Bitboard;
+
+/*
+ * Builds the row tables, call once before any other function
+ */
+void Bitboard_setup(void);
+
+/*
+ * Converts to and from a Board
+ */
+Bitboard Bitboard_fromBoard(Board *board);
+Board Bitboard_toBoard(Bitboard board);
+
+/*
+ * Exponent of the cell at row, col, 0 if it is empty
+ */
+static inline uint8_t Bitboard_cell(Bitboard board, uint8_t row, uint8_t col) {
+    return (board >> (4 * (row * 4 + col))) & 0x0F;
+}
+
+/*
+ * Board_shiftScore: returns the shifted board and adds the value of every
+ * merged block to score if it isn't NULL. The board didn't change if the
+ * result is equal to it.
+ */
+Bitboard Bitboard_shift(Bitboard board, Direction dir, uint32_t *score);
+
+/*
+ * Bitboard_shift for all four directions at once, a direction that doesn't
+ * change the board has its bit clear in the returned mask
+ */
+uint8_t Bitboard_moves(Bitboard board, Bitboard results[4], uint32_t scores[4]);
+
+/*
+ * Board_putRandom: puts a 2 or 4 in the empty cell picked by random, cells
+ * counted in row major order. There must be an empty cell.
+ */
+Bitboard Bitboard_spawn(Bitboard board, uint32_t random, Boolean two);
+
+/*
+ * Number of empty cells
+ */
+uint8_t Bitboard_empty(Bitboard board);
+
+Boolean Bitboard_gameOver(Bitboard board);
+
+/*
+ * The largest exponent on the board
+ */
+uint8_t Bitboard_maxExponent(Bitboard board);
+
+/*
+ * Sum of the values of all the tiles. Every move adds the 2 or 4 that spawns
+ * to it, so it counts how far into a game a board is.
+ */
+uint32_t Bitboard_tileSum(Bitboard board);
+
+/*
+ * Swaps rows and columns
+ */
+Bitboard Bitboard_transpose(Bitboard board);
+
+/*
+ * The 8 rotations and reflections of board, in a fixed order with the board
+ * itself first
+ */
+void Bitboard_symmetries(Bitboard board, Bitboard out[8]);
+
+/*
+ * The smallest of the 8 symmetries, the same for every board in the group
+ */
+Bitboard Bitboard_canonical(Bitboard board);
+
+/*
+ * Which symmetry Bitboard_canonical picked, and the direction on the
+ * original board that matches dir on the canonical one
+ */
+uint8_t Bitboard_canonicalIndex(Bitboard board);
+Direction Bitboard_fromCanonical(uint8_t symmetry, Direction dir);
+
+/*
+ * xorshift64* for the simulations, every thread keeps its own state which
+ * must not be 0
+ */
+static inline uint32_t Bitboard_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return (x * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+/*
+ * Spawns a tile the way the game does, a 2 nine times out of ten
+ */
+static inline Bitboard Bitboard_spawnRandom(Bitboard board, uint64_t *state) {
+    uint32_t random = Bitboard_random(state);
+    return Bitboard_spawn(board, random / 10, random % 10 ? TRUE : FALSE);
+}
+#endif
@@ -0,0 +1,80 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Book.h"
+
+static const uint8_t magic[8] = {'2', '0', '4', '8', 'B', 'O', 'O', 'K'};
+
+int Book_open(Book *book, const char *path) {
+    memset(book, 0, sizeof *book);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(BookHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid once the file is closed
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    const BookHeader *header = map;
+    if (memcmp(header -> magic, magic, sizeof magic) != 0 || header -> version != BOOK_VERSION
+            || header -> entrySize != sizeof(BookEntry)
+            || header -> count > (info.st_size - sizeof(BookHeader)) / sizeof(BookEntry)) {
+        munmap(map, info.st_size);
+        return -1;
+    }
+    book -> entries = (const BookEntry *) (header + 1);
+    book -> count = header -> count;
+    book -> maxSum = header -> maxSum;
+    book -> map = map;
+    book -> length = info.st_size;
+    return 0;
+}
+
+void Book_close(Book *book) {
+    if (book -> map)
+        munmap(book -> map, book -> length);
+    memset(book, 0, sizeof *book);
+}
+
+const BookEntry *Book_find(const Book *book, Bitboard canonical) {
+    uint64_t low = 0;
+    uint64_t high = book -> count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        Bitboard board = book -> entries[middle].board;
+        if (board == canonical)
+            return &book -> entries[middle];
+        if (board < canonical)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NULL;
+}
+
+Boolean Book_lookup(const Book *book, Bitboard board, Direction *move, float *value) {
+    // Cheaper than the search for positions past the end of the book
+    if (!book -> map || Bitboard_tileSum(board) > book -> maxSum)
+        return FALSE;
+    Bitboard all[8];
+    Bitboard_symmetries(board, all);
+    uint8_t symmetry = 0;
+    for (uint8_t i = 1; i < 8; i++)
+        if (all[i] < all[symmetry])
+            symmetry = i;
+    const BookEntry *entry = Book_find(book, all[symmetry]);
+    if (!entry)
+        return FALSE;
+    if (move)
+        *move = Bitboard_fromCanonical(symmetry, entry -> move);
+    if (value)
+        *value = entry -> value;
+    return TRUE;
+}
@@ -0,0 +1,70 @@
+#ifndef BOOK_H
+#define BOOK_H
+/*
+ * An opening book: the best move and its expected value for every position
+ * that can come up early in a game, written by tools/mkbook. Positions are
+ * stored once for all their symmetries, as the canonical board.
+ *
+ * The file is a 32 byte header followed by the entries sorted by board, all
+ * in the byte order of the machine that wrote it:
+ *
+ *     "2048BOOK"       magic
+ *     version          uint32, 1
+ *     maxSum           uint32, largest tile sum in the book
+ *     count            uint64, number of entries
+ *     entrySize        uint32, sizeof(BookEntry)
+ *     reserved         uint32
+ *
+ * Book_open maps the file instead of reading it, so opening a book of any
+ * size is instant and every process using it shares the same pages.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include "Bitboard.h"
+
+#define BOOK_VERSION 1
+
+typedef struct {
+    Bitboard board;
+    float value;        // expected score from here on
+    uint8_t move;       // Direction on the canonical board
+    uint8_t reserved[3];
+} BookEntry;
+
+typedef struct {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t maxSum;
+    uint64_t count;
+    uint32_t entrySize;
+    uint32_t reserved;
+} BookHeader;
+
+typedef struct {
+    const BookEntry *entries;
+    uint64_t count;
+    uint32_t maxSum;
+    void *map;
+    size_t length;
+} Book;
+
+/*
+ * Maps the book at path. Returns 0, or -1 if it can't be opened or isn't a
+ * book written on this kind of machine.
+ */
+int Book_open(Book *book, const char *path);
+
+void Book_close(Book *book);
+
+/*
+ * The entry for a canonical board by binary search, NULL if it isn't in the
+ * book
+ */
+const BookEntry *Book_find(const Book *book, Bitboard canonical);
+
+/*
+ * Looks up any board, returning TRUE with the best move for it and its
+ * value if the book has it
+ */
+Boolean Book_lookup(const Book *book, Bitboard board, Direction *move, float *value);
+#endif
@@ -0,0 +1,422 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Endgame.h"
+
+#define MIN_CAPACITY 4096
+// Layers aren't split into slices smaller than this
+#define MIN_SLICE 1024
+
+static const uint8_t magic[8] = {'2', '0', '4', '8', 'E', 'N', 'D', 'G'};
+
+// Positions of one tile sum while they are being found
+typedef struct {
+    Bitboard *boards;
+    size_t count;
+    size_t capacity;
+} Layer;
+
+typedef struct {
+    uint8_t goal;
+    uint32_t maxSum;
+    Endgame table;      // what has been written so far
+} Build;
+
+// The part of a layer one thread works on
+typedef struct {
+    pthread_t thread;
+    Boolean started;
+    const Build *build;
+    uint32_t sum;
+    size_t start;
+    size_t end;
+    // Finding positions
+    const Bitboard *boards;
+    Layer next[2];      // at sum + 2 and sum + 4
+    Boolean failed;
+    // Valuing them
+    EndgameEntry *entries;
+} Slice;
+
+static int compareBoards(const void *a, const void *b) {
+    Bitboard x = *(const Bitboard *) a;
+    Bitboard y = *(const Bitboard *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Sorts a layer and drops the duplicates
+ */
+static void compact(Layer *layer) {
+    if (!layer -> count)
+        return;
+    qsort(layer -> boards, layer -> count, sizeof(Bitboard), compareBoards);
+    size_t unique = 1;
+    for (size_t i = 1; i < layer -> count; i++)
+        if (layer -> boards[i] != layer -> boards[unique - 1])
+            layer -> boards[unique++] = layer -> boards[i];
+    layer -> count = unique;
+}
+
+static Boolean reserve(Layer *layer, size_t capacity) {
+    if (capacity <= layer -> capacity)
+        return TRUE;
+    Bitboard *boards = realloc(layer -> boards, capacity * sizeof(Bitboard));
+    if (!boards)
+        return FALSE;
+    layer -> boards = boards;
+    layer -> capacity = capacity;
+    return TRUE;
+}
+
+static Boolean push(Layer *layer, Bitboard canonical) {
+    if (layer -> count == layer -> capacity) {
+        // Most boards are found many times, try dropping those before growing
+        compact(layer);
+        if (layer -> count >= layer -> capacity / 2
+                && !reserve(layer, layer -> capacity ? layer -> capacity * 2 : MIN_CAPACITY))
+            return FALSE;
+    }
+    layer -> boards[layer -> count++] = canonical;
+    return TRUE;
+}
+
+/**
+ * Moves the boards of from to the end of to
+ */
+static Boolean append(Layer *to, Layer *from) {
+    if (!reserve(to, to -> count + from -> count))
+        return FALSE;
+    if (from -> count)
+        memcpy(to -> boards + to -> count, from -> boards, from -> count * sizeof(Bitboard));
+    to -> count += from -> count;
+    free(from -> boards);
+    memset(from, 0, sizeof *from);
+    return TRUE;
+}
+
+static inline Boolean won(const Build *build, Bitboard board) {
+    return Bitboard_maxExponent(board) >= build -> goal ? TRUE : FALSE;
+}
+
+static const EndgameEntry *findInLayer(const Endgame *table, Bitboard canonical, uint32_t sum) {
+    const EndgameLayer *layer = &table -> layers[(sum - table -> minSum) / 2];
+    uint64_t low = layer -> first;
+    uint64_t high = layer -> first + layer -> count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        Bitboard board = table -> entries[middle].board;
+        if (board == canonical)
+            return &table -> entries[middle];
+        if (board < canonical)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NULL;
+}
+
+/**
+ * Adds every position one move and spawn away from part of a layer to the
+ * slice's next layers
+ */
+static void *expand(void *arg) {
+    Slice *slice = arg;
+    const Build *build = slice -> build;
+    for (size_t i = slice -> start; i < slice -> end; i++) {
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(slice -> boards[i], results, scores);
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            if (!(mask & (1 << dir)) || won(build, results[dir]))
+                continue;
+            for (uint8_t cell = 0; cell < 16; cell++) {
+                if ((results[dir] >> (4 * cell)) & 0x0F)
+                    continue;
+                for (uint8_t tile = 1; tile <= 2; tile++) {
+                    Bitboard child = results[dir] | ((Bitboard) tile << (4 * cell));
+                    if (slice -> sum + 2 * tile > build -> maxSum || won(build, child))
+                        continue;
+                    if (!push(&slice -> next[tile - 1], Bitboard_canonical(child))) {
+                        slice -> failed = TRUE;
+                        return NULL;
+                    }
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Chance of making the goal from a position after a spawn
+ */
+static double childProbability(const Build *build, Bitboard child, uint32_t sum) {
+    if (won(build, child))
+        return 1;
+    if (sum > build -> maxSum)
+        return 0;
+    return findInLayer(&build -> table, Bitboard_canonical(child), sum) -> probability;
+}
+
+/**
+ * Best move and its chance for part of a layer, from the layers above
+ */
+static void *solve(void *arg) {
+    Slice *slice = arg;
+    const Build *build = slice -> build;
+    for (size_t i = slice -> start; i < slice -> end; i++) {
+        EndgameEntry *entry = &slice -> entries[i];
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(entry -> board, results, scores);
+        double best = 0;
+        int8_t bestMove = -1;
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            if (!(mask & (1 << dir)))
+                continue;
+            double probability = 1;
+            if (!won(build, results[dir])) {
+                // A move always leaves an empty cell
+                double total = 0;
+                uint8_t empty = 0;
+                for (uint8_t cell = 0; cell < 16; cell++) {
+                    if ((results[dir] >> (4 * cell)) & 0x0F)
+                        continue;
+                    total += 0.9 * childProbability(build, results[dir] | (1ULL << (4 * cell)), slice -> sum + 2);
+                    total += 0.1 * childProbability(build, results[dir] | (2ULL << (4 * cell)), slice -> sum + 4);
+                    empty++;
+                }
+                probability = total / empty;
+            }
+            if (bestMove < 0 || probability > best) {
+                best = probability;
+                bestMove = dir;
+            }
+        }
+        entry -> probability = best;
+        entry -> move = bestMove < 0 ? LEFT : bestMove;
+    }
+    return NULL;
+}
+
+/**
+ * Runs work on count items split between up to threads slices, the first
+ * on the calling thread. The slices must have their other fields set.
+ */
+static void run(Slice *slices, int threads, size_t count, void *(*work)(void *)) {
+    size_t wanted = (count + MIN_SLICE - 1) / MIN_SLICE;
+    int used = wanted < (size_t) threads ? (wanted ? wanted : 1) : threads;
+    size_t share = (count + used - 1) / used;
+    for (int i = 0; i < threads; i++) {
+        slices[i].start = i < used && i * share < count ? i * share : count;
+        slices[i].end = i < used && (i + 1) * share < count ? (i + 1) * share : count;
+        slices[i].started = FALSE;
+    }
+    for (int i = 1; i < used; i++)
+        if (pthread_create(&slices[i].thread, NULL, work, &slices[i]) == 0)
+            slices[i].started = TRUE;
+    work(&slices[0]);
+    // Slices without a thread of their own are run here too
+    for (int i = 1; i < used; i++) {
+        if (slices[i].started)
+            pthread_join(slices[i].thread, NULL);
+        else
+            work(&slices[i]);
+    }
+}
+
+int Endgame_build(const char *path, const Bitboard *roots, size_t count, uint8_t goal, uint32_t maxSum,
+        int threads, FILE *progress) {
+    maxSum -= maxSum % 2;
+    uint32_t minSum = UINT32_MAX;
+    Build build = {goal, maxSum};
+    for (size_t i = 0; i < count; i++) {
+        uint32_t sum = Bitboard_tileSum(roots[i]);
+        if (sum % 2 || sum > maxSum || won(&build, roots[i]))
+            minSum = 0;
+        else if (sum < minSum)
+            minSum = sum;
+    }
+    if (!count || minSum == 0 || goal < 2 || goal > 15 || threads < 1 || threads > ENDGAME_MAX_THREADS) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t layerCount = (maxSum - minSum) / 2 + 1;
+    Layer *layers = calloc(layerCount, sizeof(Layer));
+    Slice *slices = calloc(threads, sizeof(Slice));
+    int result = -1;
+    if (!layers || !slices)
+        goto freeLayers;
+    for (size_t i = 0; i < count; i++)
+        if (!push(&layers[(Bitboard_tileSum(roots[i]) - minSum) / 2], Bitboard_canonical(roots[i])))
+            goto freeLayers;
+
+    // Going forwards, every layer adds to the two above it
+    uint64_t total = 0;
+    for (size_t l = 0; l < layerCount; l++) {
+        compact(&layers[l]);
+        total += layers[l].count;
+        if (progress) {
+            fprintf(progress, "tile sum %5zu: %10zu positions\n", minSum + 2 * l, layers[l].count);
+            fflush(progress);
+        }
+        for (int i = 0; i < threads; i++) {
+            slices[i].build = &build;
+            slices[i].sum = minSum + 2 * l;
+            slices[i].boards = layers[l].boards;
+        }
+        run(slices, threads, layers[l].count, expand);
+        Boolean failed = FALSE;
+        for (int i = 0; i < threads; i++) {
+            failed |= slices[i].failed;
+            for (uint8_t t = 0; t < 2; t++)
+                if (l + 1 + t < layerCount && !failed)
+                    failed |= !append(&layers[l + 1 + t], &slices[i].next[t]);
+                else
+                    free(slices[i].next[t].boards), memset(&slices[i].next[t], 0, sizeof(Layer));
+        }
+        if (failed) {
+            errno = ENOMEM;
+            goto freeLayers;
+        }
+    }
+
+    size_t length = sizeof(EndgameHeader) + layerCount * sizeof(EndgameLayer) + total * sizeof(EndgameEntry);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        goto freeLayers;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, length) == 0)
+        map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        goto removeFile;
+    EndgameHeader *header = map;
+    memcpy(header -> magic, magic, sizeof magic);
+    header -> version = ENDGAME_VERSION;
+    header -> goal = goal;
+    header -> minSum = minSum;
+    header -> maxSum = maxSum;
+    header -> entrySize = sizeof(EndgameEntry);
+    header -> reserved = 0;
+    EndgameLayer *index = (EndgameLayer *) (header + 1);
+    EndgameEntry *entries = (EndgameEntry *) (index + layerCount);
+    uint64_t next = 0;
+    for (size_t l = 0; l < layerCount; l++) {
+        index[l].first = next;
+        index[l].count = layers[l].count;
+        for (size_t i = 0; i < layers[l].count; i++, next++)
+            entries[next].board = layers[l].boards[i];
+        // Only the mapping from here on
+        free(layers[l].boards);
+        memset(&layers[l], 0, sizeof(Layer));
+    }
+    build.table = (Endgame) {entries, index, goal, minSum, maxSum, total, map, length};
+
+    // Going backwards, every layer is valued from the two above it
+    for (size_t l = layerCount; l-- > 0;) {
+        for (int i = 0; i < threads; i++) {
+            slices[i].build = &build;
+            slices[i].sum = minSum + 2 * l;
+            slices[i].entries = entries + index[l].first;
+        }
+        run(slices, threads, index[l].count, solve);
+    }
+    result = msync(map, length, MS_SYNC);
+    munmap(map, length);
+removeFile:
+    if (result != 0) {
+        int error = errno;
+        unlink(path);
+        errno = error;
+    }
+freeLayers:
+    if (layers)
+        for (size_t l = 0; l < layerCount; l++)
+            free(layers[l].boards);
+    if (slices)
+        for (int i = 0; i < threads; i++)
+            free(slices[i].next[0].boards), free(slices[i].next[1].boards);
+    free(layers);
+    free(slices);
+    return result;
+}
+
+int Endgame_open(Endgame *table, const char *path) {
+    memset(table, 0, sizeof *table);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(EndgameHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    const EndgameHeader *header = map;
+    size_t length = info.st_size;
+    size_t layerCount = (header -> maxSum - header -> minSum) / 2 + 1;
+    if (memcmp(header -> magic, magic, sizeof magic) != 0 || header -> version != ENDGAME_VERSION
+            || header -> entrySize != sizeof(EndgameEntry) || header -> minSum % 2 || header -> maxSum % 2
+            || header -> minSum > header -> maxSum
+            || layerCount > (length - sizeof(EndgameHeader)) / sizeof(EndgameLayer)) {
+        munmap(map, length);
+        return -1;
+    }
+    const EndgameLayer *layers = (const EndgameLayer *) (header + 1);
+    uint64_t count = (length - sizeof(EndgameHeader) - layerCount * sizeof(EndgameLayer)) / sizeof(EndgameEntry);
+    for (size_t l = 0; l < layerCount; l++) {
+        if (layers[l].first > count || layers[l].count > count - layers[l].first) {
+            munmap(map, length);
+            return -1;
+        }
+    }
+    table -> entries = (const EndgameEntry *) (layers + layerCount);
+    table -> layers = layers;
+    table -> goal = header -> goal;
+    table -> minSum = header -> minSum;
+    table -> maxSum = header -> maxSum;
+    table -> count = count;
+    table -> map = map;
+    table -> length = length;
+    return 0;
+}
+
+void Endgame_close(Endgame *table) {
+    if (table -> map)
+        munmap(table -> map, table -> length);
+    memset(table, 0, sizeof *table);
+}
+
+const EndgameEntry *Endgame_find(const Endgame *table, Bitboard canonical) {
+    uint32_t sum = Bitboard_tileSum(canonical);
+    if (!table -> map || sum < table -> minSum || sum > table -> maxSum)
+        return NULL;
+    return findInLayer(table, canonical, sum);
+}
+
+Boolean Endgame_lookup(const Endgame *table, Bitboard board, Direction *move, double *probability) {
+    Bitboard all[8];
+    Bitboard_symmetries(board, all);
+    uint8_t symmetry = 0;
+    for (uint8_t i = 1; i < 8; i++)
+        if (all[i] < all[symmetry])
+            symmetry = i;
+    const EndgameEntry *entry = Endgame_find(table, all[symmetry]);
+    if (!entry)
+        return FALSE;
+    if (move)
+        *move = Bitboard_fromCanonical(symmetry, entry -> move);
+    if (probability)
+        *probability = entry -> probability;
+    return TRUE;
+}
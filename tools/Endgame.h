@@ -0,0 +1,104 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+/*
+ * Exact chances of making a goal tile: for every position reachable from a
+ * set of roots, the probability of making a tile of 2^goal with the best
+ * play, and the move that gets it. Built by retrograde analysis with
+ * tools/mkendgame.
+ *
+ * The game is bounded by tile sum, which every spawn raises by 2 or 4 and
+ * no move changes: a position is won once a move makes the goal tile, lost
+ * when there is no move, and lost as well when a spawn takes the tile sum
+ * past maxSum. The values are exact for that game, and a lower bound on
+ * the chance with no bound, which they equal once maxSum is high enough
+ * that it never comes into it. So the positions are split into layers by
+ * tile sum and each layer is valued from the two above it, going down from
+ * maxSum, with all the threads sharing each layer. Won positions aren't
+ * stored, and positions are stored once for all their symmetries, as the
+ * canonical board.
+ *
+ * The file is written through a shared mapping, so the values go to disk
+ * as they are worked out and only the layers being read have to be in
+ * memory. It is a 32 byte header, an EndgameLayer for every even tile sum
+ * from minSum to maxSum, then the entries, each layer sorted by board, all
+ * in the byte order of the machine that wrote it:
+ *
+ *     "2048ENDG"       magic
+ *     version          uint32, 1
+ *     goal             uint32, exponent of the goal tile
+ *     minSum           uint32, smallest tile sum
+ *     maxSum           uint32, largest tile sum
+ *     entrySize        uint32, sizeof(EndgameEntry)
+ *     reserved         uint32
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Bitboard.h"
+
+#define ENDGAME_VERSION 1
+#define ENDGAME_MAX_THREADS 256
+
+typedef struct {
+    Bitboard board;
+    double probability;
+    uint8_t move;       // Direction on the canonical board, LEFT if there is none
+    uint8_t reserved[7];
+} EndgameEntry;
+
+typedef struct {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t goal;
+    uint32_t minSum;
+    uint32_t maxSum;
+    uint32_t entrySize;
+    uint32_t reserved;
+} EndgameHeader;
+
+typedef struct {
+    uint64_t first;     // index of the layer's first entry
+    uint64_t count;
+} EndgameLayer;
+
+typedef struct {
+    const EndgameEntry *entries;
+    const EndgameLayer *layers;
+    uint32_t goal;
+    uint32_t minSum;
+    uint32_t maxSum;
+    uint64_t count;
+    void *map;
+    size_t length;
+} Endgame;
+
+/*
+ * Finds every position reachable from the roots up to maxSum and values
+ * them for the goal on threads threads, writing the table to path. Roots
+ * must have an even tile sum no more than maxSum and no goal tile. Progress
+ * goes to progress unless it is NULL. Returns 0, or -1 with errno set.
+ */
+int Endgame_build(const char *path, const Bitboard *roots, size_t count, uint8_t goal, uint32_t maxSum,
+        int threads, FILE *progress);
+
+/*
+ * Maps the table at path. Returns 0, or -1 if it can't be opened or isn't
+ * a table written on this kind of machine.
+ */
+int Endgame_open(Endgame *table, const char *path);
+
+void Endgame_close(Endgame *table);
+
+/*
+ * The entry for a canonical board by binary search in the layer of its
+ * tile sum, NULL if it isn't in the table
+ */
+const EndgameEntry *Endgame_find(const Endgame *table, Bitboard canonical);
+
+/*
+ * Looks up any board, returning TRUE with the best move for it and its
+ * chance of making the goal if the table has it. A board that already has
+ * the goal tile isn't in the table.
+ */
+Boolean Endgame_lookup(const Endgame *table, Bitboard board, Direction *move, double *probability);
+#endif
@@ -0,0 +1,58 @@
+#include "Bitboard.h"
+#include "Engine.h"
+
+/**
+ * Builds the row tables when the library is loaded, so callers never have
+ * to set anything up
+ */
+__attribute__((constructor)) static void setup(void) {
+    Bitboard_setup();
+}
+
+uint32_t Engine_abiVersion(void) {
+    return ENGINE_ABI_VERSION;
+}
+
+size_t Engine_move(const uint64_t *boards, size_t count, uint8_t dir, uint64_t *results, uint32_t *scores) {
+    size_t changed = 0;
+    dir &= 3;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t score = 0;
+        Bitboard board = boards[i];
+        Bitboard result = Bitboard_shift(board, dir, &score);
+        changed += result != board;
+        results[i] = result;
+        if (scores)
+            scores[i] = score;
+    }
+    return changed;
+}
+
+void Engine_moves(const uint64_t *boards, size_t count, uint64_t *results, uint32_t *scores, uint8_t *masks) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t moveScores[4];
+        uint8_t mask = Bitboard_moves(boards[i], &results[4 * i], moveScores);
+        if (scores)
+            for (uint8_t dir = 0; dir < 4; dir++)
+                scores[4 * i + dir] = moveScores[dir];
+        if (masks)
+            masks[i] = mask;
+    }
+}
+
+void Engine_legal(const uint64_t *boards, size_t count, uint8_t *masks) {
+    for (size_t i = 0; i < count; i++) {
+        Bitboard results[4];
+        uint32_t scores[4];
+        masks[i] = Bitboard_moves(boards[i], results, scores);
+    }
+}
+
+uint64_t Engine_spawn(uint64_t *boards, size_t count, uint64_t state) {
+    if (!state)
+        state = 1;
+    for (size_t i = 0; i < count; i++)
+        if (Bitboard_empty(boards[i]))
+            boards[i] = Bitboard_spawnRandom(boards[i], &state);
+    return state;
+}
@@ -0,0 +1,60 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+/*
+ * The board rules as a shared library, tools/lib2048.so, for programs that
+ * aren't written in C. The interface only uses fixed width integers and
+ * arrays of them, so it can be called through any foreign function
+ * interface, and it stays the same within an ENGINE_ABI_VERSION: new
+ * functions can be added, existing ones are never changed.
+ *
+ * Boards are 64 bit integers in the layout of tools/Bitboard.h: 4 bits per
+ * cell holding the exponent of its value, cell (row, col) at bit
+ * 4 * (row * 4 + col). Directions are 0 left, 1 right, 2 up and 3 down,
+ * legal move masks have bit d set if moving in direction d changes the
+ * board.
+ *
+ * Every function works on a batch of count boards in place in the caller's
+ * arrays, and is safe to call from several threads at once.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENGINE_ABI_VERSION 1
+
+#ifdef ENGINE_BUILD
+#define ENGINE_API __attribute__((visibility("default")))
+#else
+#define ENGINE_API
+#endif
+
+ENGINE_API uint32_t Engine_abiVersion(void);
+
+/*
+ * Moves every board in direction dir into results, which may be boards
+ * itself, and the score of each move into scores unless it is NULL.
+ * Returns the number of boards the move changed.
+ */
+ENGINE_API size_t Engine_move(const uint64_t *boards, size_t count, uint8_t dir, uint64_t *results,
+        uint32_t *scores);
+
+/*
+ * All four moves of every board: results[4 * i + d] is board i moved in
+ * direction d, likewise scores. masks gets the legal moves of each board.
+ * results can't overlap boards, scores and masks may be NULL.
+ */
+ENGINE_API void Engine_moves(const uint64_t *boards, size_t count, uint64_t *results, uint32_t *scores,
+        uint8_t *masks);
+
+/*
+ * The legal moves of every board, 0 once the game is over
+ */
+ENGINE_API void Engine_legal(const uint64_t *boards, size_t count, uint8_t *masks);
+
+/*
+ * Puts a random tile on every board with an empty cell, a 2 nine times out
+ * of ten and otherwise a 4, like the game does. The random numbers come
+ * from an xorshift64* generator whose state, which can't be 0, is passed
+ * in and the new state returned, so a batch can be replayed.
+ */
+ENGINE_API uint64_t Engine_spawn(uint64_t *boards, size_t count, uint64_t state);
+#endif
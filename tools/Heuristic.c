@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include "Heuristic.h"
+
+#define ROWS 65536
+#define ROW_MASK 0xFFFFULL
+
+const char *const Heuristic_names[HEURISTIC_FEATURES] = {"empty", "merges", "monotonicity", "corner"};
+const float Heuristic_defaults[HEURISTIC_FEATURES] = {10, 5, 2, 5};
+
+// Features of every row, the same for a column read top to bottom
+static uint8_t rowEmpty[ROWS];
+static uint8_t rowMerges[ROWS];
+static uint8_t rowDisorder[ROWS];
+
+void Heuristic_setup(void) {
+    for (uint32_t row = 0; row < ROWS; row++) {
+        uint8_t cells[4], tiles[4];
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+            cells[i] = (row >> (4 * i)) & 0x0F;
+            if (cells[i])
+                tiles[count++] = cells[i];
+        }
+        rowEmpty[row] = 4 - count;
+        // Pairs merge from the start of the row, like a shift
+        uint8_t merges = 0;
+        for (uint8_t i = 0; i + 1 < count; i++) {
+            if (tiles[i] == tiles[i + 1]) {
+                merges++;
+                i++;
+            }
+        }
+        rowMerges[row] = merges;
+        uint8_t rising = 0, falling = 0;
+        for (uint8_t i = 0; i < 3; i++) {
+            if (cells[i] > cells[i + 1])
+                falling += cells[i] - cells[i + 1];
+            else
+                rising += cells[i + 1] - cells[i];
+        }
+        rowDisorder[row] = rising < falling ? rising : falling;
+    }
+}
+
+void Heuristic_features(Bitboard board, int32_t features[HEURISTIC_FEATURES]) {
+    Bitboard transposed = Bitboard_transpose(board);
+    int32_t empty = 0, merges = 0, disorder = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        uint16_t row = (board >> (16 * i)) & ROW_MASK;
+        uint16_t col = (transposed >> (16 * i)) & ROW_MASK;
+        empty += rowEmpty[row];
+        merges += rowMerges[row] + rowMerges[col];
+        disorder += rowDisorder[row] + rowDisorder[col];
+    }
+    uint8_t max = Bitboard_maxExponent(board);
+    features[HEURISTIC_EMPTY] = empty;
+    features[HEURISTIC_MERGES] = merges;
+    features[HEURISTIC_MONOTONICITY] = -disorder;
+    features[HEURISTIC_CORNER] = Bitboard_cell(board, 0, 0) == max || Bitboard_cell(board, 0, 3) == max
+            || Bitboard_cell(board, 3, 0) == max || Bitboard_cell(board, 3, 3) == max ? max : 0;
+}
+
+float Heuristic_value(const float weights[HEURISTIC_FEATURES], Bitboard board) {
+    int32_t features[HEURISTIC_FEATURES];
+    Heuristic_features(board, features);
+    float value = 0;
+    for (uint8_t i = 0; i < HEURISTIC_FEATURES; i++)
+        value += weights[i] * features[i];
+    return value;
+}
+
+int8_t Heuristic_move(const float weights[HEURISTIC_FEATURES], Bitboard board) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    int8_t best = -1;
+    float bestValue = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + Heuristic_value(weights, results[dir]);
+        if (best < 0 || value > bestValue) {
+            best = dir;
+            bestValue = value;
+        }
+    }
+    return best;
+}
+
+uint32_t Heuristic_play(const float weights[HEURISTIC_FEATURES], uint64_t seed, uint32_t *moves) {
+    uint64_t random = seed;
+    Bitboard board = Bitboard_spawnRandom(Bitboard_spawnRandom(0, &random), &random);
+    uint32_t total = 0, count = 0;
+    int8_t move;
+    while ((move = Heuristic_move(weights, board)) >= 0) {
+        uint32_t score = 0;
+        board = Bitboard_spawnRandom(Bitboard_shift(board, move, &score), &random);
+        total += score;
+        count++;
+    }
+    if (moves)
+        *moves = count;
+    return total;
+}
+
+int Heuristic_save(const float weights[HEURISTIC_FEATURES], const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return -1;
+    for (uint8_t i = 0; i < HEURISTIC_FEATURES; i++)
+        fprintf(file, "%s %.9g\n", Heuristic_names[i], weights[i]);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int Heuristic_load(float weights[HEURISTIC_FEATURES], const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    char name[32];
+    float weight;
+    int read, result = 0;
+    while ((read = fscanf(file, "%31s %f", name, &weight)) == 2) {
+        uint8_t i = 0;
+        while (i < HEURISTIC_FEATURES && strcmp(name, Heuristic_names[i]) != 0)
+            i++;
+        if (i == HEURISTIC_FEATURES) {
+            result = -1;
+            break;
+        }
+        weights[i] = weight;
+    }
+    if (read != EOF && read != 2)
+        result = -1;
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+/*
+ * A hand written evaluation of 2048 boards, the weighted sum of a few
+ * features, and a greedy player that uses it. tools/tune finds the weights.
+ *
+ *     HEURISTIC_EMPTY          empty cells
+ *     HEURISTIC_MERGES         merges a left or up move would make, counted
+ *                              in every row and column
+ *     HEURISTIC_MONOTONICITY   minus how far each row and column is from
+ *                              being in order, in exponents, whichever way
+ *                              is closer
+ *     HEURISTIC_CORNER         exponent of the largest tile if one of them
+ *                              is in a corner, 0 otherwise
+ *
+ * Rows and columns are looked up in tables Heuristic_setup builds, so a
+ * value costs eight lookups and a dot product.
+ */
+#include <stdint.h>
+#include "Bitboard.h"
+
+enum {
+    HEURISTIC_EMPTY,
+    HEURISTIC_MERGES,
+    HEURISTIC_MONOTONICITY,
+    HEURISTIC_CORNER,
+    HEURISTIC_FEATURES
+};
+
+/*
+ * Names of the features, as used in weight files
+ */
+extern const char *const Heuristic_names[HEURISTIC_FEATURES];
+
+/*
+ * Hand picked weights to start from
+ */
+extern const float Heuristic_defaults[HEURISTIC_FEATURES];
+
+/*
+ * Builds the row tables, call once after Bitboard_setup
+ */
+void Heuristic_setup(void);
+
+void Heuristic_features(Bitboard board, int32_t features[HEURISTIC_FEATURES]);
+
+float Heuristic_value(const float weights[HEURISTIC_FEATURES], Bitboard board);
+
+/*
+ * The move with the best score plus value of the board it leaves, -1 if
+ * there is none
+ */
+int8_t Heuristic_move(const float weights[HEURISTIC_FEATURES], Bitboard board);
+
+/*
+ * Plays a game with Heuristic_move from the two starting tiles to the end
+ * and returns its score. The tiles that spawn come only from seed, which
+ * can't be 0, so every set of weights played on the same seed meets the
+ * same random numbers. moves gets the number of moves unless it is NULL.
+ */
+uint32_t Heuristic_play(const float weights[HEURISTIC_FEATURES], uint64_t seed, uint32_t *moves);
+
+/*
+ * Writes the weights as lines of a feature name and its weight. Returns 0
+ * or -1 with errno set.
+ */
+int Heuristic_save(const float weights[HEURISTIC_FEATURES], const char *path);
+
+/*
+ * Reads weights written by Heuristic_save, features it doesn't have keep
+ * the value in weights. Returns 0, or -1 if the file can't be read or has a
+ * line that isn't a known feature and a number.
+ */
+int Heuristic_load(float weights[HEURISTIC_FEATURES], const char *path);
+#endif
@@ -0,0 +1,535 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "HintServer.h"
+
+// A search has to have at least this long before the deadline to be worth
+// starting, and stops this long before it so the reply gets out in time
+#define MIN_SEARCH 0.005
+#define MARGIN 0.002
+// Clients that don't read their replies are dropped once this much is waiting
+#define MAX_OUTPUT (1 << 20)
+#define REPORT_SECONDS 10
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void wakeUp(HintServer *server) {
+    char byte = 0;
+    // A full pipe wakes the loop just as well
+    ssize_t written = write(server -> wake[1], &byte, 1);
+    (void) written;
+}
+
+/**
+ * How good an answer is, a better one isn't replaced in the cache
+ */
+static uint16_t quality(uint8_t source, uint8_t depth) {
+    return source == HINT_ENDGAME ? 0xFFFF : source == HINT_SEARCH ? 1 + depth : 0;
+}
+
+static HintCacheEntry *cacheSlot(const HintServer *server, Bitboard canonical) {
+    return &server -> cache[(canonical * 0x9E3779B97F4A7C15ULL) >> (64 - server -> options.cacheBits)];
+}
+
+static void cacheStore(HintServer *server, Bitboard canonical, const HintReply *reply) {
+    // An empty slot has board 0, which isn't worth caching anyway
+    if (!canonical)
+        return;
+    HintCacheEntry *entry = cacheSlot(server, canonical);
+    if (entry -> board == canonical && quality(entry -> source, entry -> depth) > quality(reply -> source, reply -> depth))
+        return;
+    entry -> board = canonical;
+    entry -> value = reply -> value;
+    entry -> move = reply -> move;
+    entry -> source = reply -> source;
+    entry -> depth = reply -> depth;
+}
+
+static void closeClient(HintServer *server, uint8_t index) {
+    HintClient *client = &server -> clients[index];
+    close(client -> fd);
+    client -> fd = -1;
+    client -> generation++;
+    client -> inUsed = 0;
+    client -> outUsed = 0;
+    server -> stats.clients--;
+}
+
+/**
+ * Queues bytes for a client, unless it has gone since the request
+ */
+static void sendTo(HintServer *server, uint8_t index, uint32_t generation, const void *data, size_t length) {
+    HintClient *client = &server -> clients[index];
+    if (client -> fd < 0 || client -> generation != generation)
+        return;
+    if (client -> outUsed + length > client -> outCapacity) {
+        size_t capacity = client -> outCapacity ? client -> outCapacity * 2 : HINT_BUFFER;
+        uint8_t *out = capacity <= MAX_OUTPUT ? realloc(client -> out, capacity) : NULL;
+        if (!out) {
+            closeClient(server, index);
+            return;
+        }
+        client -> out = out;
+        client -> outCapacity = capacity;
+    }
+    memcpy(client -> out + client -> outUsed, data, length);
+    client -> outUsed += length;
+}
+
+static void flush(HintServer *server, uint8_t index) {
+    HintClient *client = &server -> clients[index];
+    size_t sent = 0;
+    while (sent < client -> outUsed) {
+        ssize_t n = send(client -> fd, client -> out + sent, client -> outUsed - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n < 0) {
+            closeClient(server, index);
+            return;
+        }
+        sent += n;
+    }
+    memmove(client -> out, client -> out + sent, client -> outUsed - sent);
+    client -> outUsed -= sent;
+}
+
+static void deliver(HintServer *server, const HintJob *job, Boolean cached) {
+    HintReply reply = job -> reply;
+    reply.type = HINT_MOVE;
+    reply.id = job -> id;
+    reply.cached = cached;
+    if (reply.move >= 0)
+        reply.move = Bitboard_fromCanonical(job -> symmetry, reply.move);
+    if (job -> deadline > 0 && Search_now() > job -> deadline)
+        server -> stats.late++;
+    sendTo(server, job -> client, job -> generation, &reply, sizeof reply);
+}
+
+/**
+ * The search queue is a binary heap on the deadline
+ */
+static void queuePush(HintServer *server, const HintJob *job) {
+    uint32_t i = server -> queued++;
+    while (i > 0 && server -> queue[(i - 1) / 2].deadline > job -> deadline) {
+        server -> queue[i] = server -> queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    server -> queue[i] = *job;
+}
+
+static HintJob queuePop(HintServer *server) {
+    HintJob first = server -> queue[0];
+    HintJob *last = &server -> queue[--server -> queued];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= server -> queued)
+            break;
+        if (child + 1 < server -> queued && server -> queue[child + 1].deadline < server -> queue[child].deadline)
+            child++;
+        if (last -> deadline <= server -> queue[child].deadline)
+            break;
+        server -> queue[i] = server -> queue[child];
+        i = child;
+    }
+    server -> queue[i] = *last;
+    return first;
+}
+
+static void *searchLoop(void *arg) {
+    HintServer *server = arg;
+    pthread_mutex_lock(&server -> lock);
+    for (;;) {
+        while (!server -> queued && !server -> quit)
+            pthread_cond_wait(&server -> ready, &server -> lock);
+        if (server -> quit)
+            break;
+        HintJob job = queuePop(server);
+        pthread_mutex_unlock(&server -> lock);
+        // Otherwise the batch's answer goes back as it is
+        double left = job.deadline - Search_now() - MARGIN;
+        if (left >= MIN_SEARCH) {
+            SearchResult result = Search_best(&server -> search, job.canonical, left, server -> options.maxDepth);
+            if (result.move >= 0) {
+                job.reply.source = HINT_SEARCH;
+                job.reply.depth = result.depth;
+                job.reply.move = result.move;
+                job.reply.value = result.value;
+            }
+        }
+        pthread_mutex_lock(&server -> lock);
+        server -> done[server -> doneCount++] = job;
+        wakeUp(server);
+    }
+    pthread_mutex_unlock(&server -> lock);
+    return NULL;
+}
+
+/**
+ * Answers the requests the search thread has finished
+ */
+static void collectDone(HintServer *server) {
+    pthread_mutex_lock(&server -> lock);
+    for (uint32_t i = 0; i < server -> doneCount; i++) {
+        HintJob *job = &server -> done[i];
+        if (job -> reply.source == HINT_SEARCH)
+            server -> stats.searches++;
+        cacheStore(server, job -> canonical, &job -> reply);
+        deliver(server, job, FALSE);
+    }
+    server -> inFlight -= server -> doneCount;
+    server -> doneCount = 0;
+    pthread_mutex_unlock(&server -> lock);
+}
+
+/**
+ * Answers queued requests that can't be searched in time any more with the
+ * batch's move, returning the milliseconds until the next one can't, -1 if
+ * none is waiting
+ */
+static int expireQueue(HintServer *server) {
+    int wait = -1;
+    pthread_mutex_lock(&server -> lock);
+    double now = Search_now();
+    while (server -> queued && server -> queue[0].deadline - now < MIN_SEARCH + MARGIN) {
+        HintJob job = queuePop(server);
+        cacheStore(server, job.canonical, &job.reply);
+        deliver(server, &job, FALSE);
+        server -> inFlight--;
+    }
+    if (server -> queued)
+        wait = 1 + (int) ((server -> queue[0].deadline - now - MIN_SEARCH - MARGIN) * 1000);
+    pthread_mutex_unlock(&server -> lock);
+    return wait;
+}
+
+static void processBatch(HintServer *server) {
+    if (!server -> batchCount)
+        return;
+    double now = Search_now();
+    HintJob *misses[HINT_MAX_BATCH];
+    Boolean searchable[HINT_MAX_BATCH];
+    uint32_t missCount = 0;
+    for (uint32_t i = 0; i < server -> batchCount; i++) {
+        HintJob *job = &server -> batch[i];
+        Boolean canSearch = server -> searching && job -> deadline > 0 && job -> deadline - now >= MIN_SEARCH + MARGIN
+                ? TRUE : FALSE;
+        HintCacheEntry *entry = cacheSlot(server, job -> canonical);
+        // A greedy answer only does if there isn't time for better
+        if (job -> canonical && entry -> board == job -> canonical
+                && (quality(entry -> source, entry -> depth) > 0 || !canSearch)) {
+            job -> reply.source = entry -> source;
+            job -> reply.depth = entry -> depth;
+            job -> reply.move = entry -> move;
+            job -> reply.value = entry -> value;
+            server -> stats.cacheHits++;
+            deliver(server, job, TRUE);
+            continue;
+        }
+        Direction move;
+        double probability;
+        if (server -> options.endgame && Endgame_lookup(server -> options.endgame, job -> canonical, &move, &probability)) {
+            job -> reply.source = HINT_ENDGAME;
+            job -> reply.depth = 0;
+            job -> reply.move = move;
+            job -> reply.value = probability;
+            server -> stats.endgameHits++;
+            cacheStore(server, job -> canonical, &job -> reply);
+            deliver(server, job, FALSE);
+            continue;
+        }
+        searchable[missCount] = canSearch;
+        misses[missCount++] = job;
+    }
+    server -> batchCount = 0;
+    if (!missCount)
+        return;
+
+    // Every move of every board left, then the network on all of them
+    static Bitboard results[HINT_MAX_BATCH][4];
+    static uint32_t scores[HINT_MAX_BATCH][4];
+    static float values[HINT_MAX_BATCH][4];
+    uint8_t masks[HINT_MAX_BATCH];
+    for (uint32_t i = 0; i < missCount; i++)
+        masks[i] = Bitboard_moves(misses[i] -> canonical, results[i], scores[i]);
+    for (uint32_t i = 0; i < missCount; i++)
+        for (uint8_t dir = 0; dir < 4; dir++)
+            values[i][dir] = masks[i] & (1 << dir)
+                    ? scores[i][dir] + NTuple_value(server -> options.net, results[i][dir]) : 0;
+    server -> stats.batches++;
+    server -> stats.batched += missCount;
+
+    Boolean queued = FALSE;
+    pthread_mutex_lock(&server -> lock);
+    for (uint32_t i = 0; i < missCount; i++) {
+        HintJob *job = misses[i];
+        int8_t best = -1;
+        for (uint8_t dir = 0; dir < 4; dir++)
+            if ((masks[i] & (1 << dir)) && (best < 0 || values[i][dir] > values[i][best]))
+                best = dir;
+        job -> reply.source = HINT_GREEDY;
+        job -> reply.depth = 1;
+        job -> reply.move = best;
+        job -> reply.value = best < 0 ? 0 : values[i][best];
+        if (searchable[i] && best >= 0 && server -> inFlight < HINT_QUEUE) {
+            queuePush(server, job);
+            server -> inFlight++;
+            queued = TRUE;
+        } else {
+            cacheStore(server, job -> canonical, &job -> reply);
+            deliver(server, job, FALSE);
+        }
+    }
+    if (queued)
+        pthread_cond_signal(&server -> ready);
+    pthread_mutex_unlock(&server -> lock);
+}
+
+/**
+ * Takes a request from a client, FALSE if it isn't one
+ */
+static Boolean handleRequest(HintServer *server, uint8_t index, const HintRequest *request) {
+    if (request -> type == HINT_STATS) {
+        HintReply reply = {HINT_STATS};
+        reply.id = request -> id;
+        reply.move = -1;
+        HintStats stats = server -> stats;
+        stats.microseconds = (Search_now() - server -> started) * 1e6;
+        sendTo(server, index, server -> clients[index].generation, &reply, sizeof reply);
+        sendTo(server, index, server -> clients[index].generation, &stats, sizeof stats);
+        return TRUE;
+    }
+    if (request -> type != HINT_MOVE)
+        return FALSE;
+    server -> stats.requests++;
+    if (server -> batchCount == HINT_MAX_BATCH)
+        processBatch(server);
+    HintJob *job = &server -> batch[server -> batchCount++];
+    memset(job, 0, sizeof *job);
+    Bitboard all[8];
+    Bitboard_symmetries(request -> board, all);
+    for (uint8_t i = 1; i < 8; i++)
+        if (all[i] < all[job -> symmetry])
+            job -> symmetry = i;
+    job -> canonical = all[job -> symmetry];
+    job -> client = index;
+    job -> generation = server -> clients[index].generation;
+    job -> id = request -> id;
+    job -> deadline = request -> deadline ? Search_now() + request -> deadline / 1000.0 : 0;
+    return TRUE;
+}
+
+/**
+ * Reads what a client has sent, at most a buffer at a time so a busy
+ * client can't hold up the others
+ */
+static void readClient(HintServer *server, uint8_t index) {
+    HintClient *client = &server -> clients[index];
+    ssize_t n = read(client -> fd, client -> in + client -> inUsed, HINT_BUFFER - client -> inUsed);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if (n <= 0) {
+        closeClient(server, index);
+        return;
+    }
+    client -> inUsed += n;
+    size_t used = 0;
+    while (client -> inUsed - used >= sizeof(HintRequest)) {
+        HintRequest request;
+        memcpy(&request, client -> in + used, sizeof request);
+        used += sizeof request;
+        if (!handleRequest(server, index, &request)) {
+            closeClient(server, index);
+            return;
+        }
+    }
+    memmove(client -> in, client -> in + used, client -> inUsed - used);
+    client -> inUsed -= used;
+}
+
+static void acceptClient(HintServer *server) {
+    int fd = accept(server -> listener, NULL, NULL);
+    if (fd < 0)
+        return;
+    for (uint8_t i = 0; i < HINT_MAX_CLIENTS; i++) {
+        if (server -> clients[i].fd < 0) {
+            setNonBlocking(fd);
+            server -> clients[i].fd = fd;
+            server -> stats.clients++;
+            return;
+        }
+    }
+    close(fd);
+}
+
+static void report(HintServer *server, HintStats *last, double *lastTime) {
+    double now = Search_now();
+    if (now - *lastTime < REPORT_SECONDS)
+        return;
+    const HintStats *stats = &server -> stats;
+    uint64_t requests = stats -> requests - last -> requests;
+    uint64_t batches = stats -> batches - last -> batches;
+    if (requests) {
+        fprintf(server -> options.report, "%10.0f requests/s  cache hits %5.1f%%  %6.1f boards per batch  "
+                "%llu searched  %llu late  %u client(s)\n", requests / (now - *lastTime),
+                100.0 * (stats -> cacheHits - last -> cacheHits) / requests,
+                batches ? (double) (stats -> batched - last -> batched) / batches : 0,
+                (unsigned long long) (stats -> searches - last -> searches),
+                (unsigned long long) (stats -> late - last -> late), stats -> clients);
+        fflush(server -> options.report);
+    }
+    *last = *stats;
+    *lastTime = now;
+}
+
+int HintServer_run(HintServer *server) {
+    struct pollfd polls[HINT_MAX_CLIENTS + 2];
+    uint8_t slots[HINT_MAX_CLIENTS];
+    HintStats last = server -> stats;
+    double lastTime = Search_now();
+    int wait = -1;
+    while (!server -> quit) {
+        polls[0] = (struct pollfd) {server -> wake[0], POLLIN, 0};
+        polls[1] = (struct pollfd) {server -> listener, POLLIN, 0};
+        nfds_t count = 2;
+        for (uint8_t i = 0; i < HINT_MAX_CLIENTS; i++) {
+            if (server -> clients[i].fd < 0)
+                continue;
+            slots[count - 2] = i;
+            polls[count++] = (struct pollfd) {server -> clients[i].fd,
+                    POLLIN | (server -> clients[i].outUsed ? POLLOUT : 0), 0};
+        }
+        if (server -> options.report && (wait < 0 || wait > 1000))
+            wait = 1000;
+        if (poll(polls, count, wait) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (polls[0].revents & POLLIN) {
+            char bytes[64];
+            while (read(server -> wake[0], bytes, sizeof bytes) > 0)
+                ;
+        }
+        if (server -> searching)
+            collectDone(server);
+        if (polls[1].revents & POLLIN)
+            acceptClient(server);
+        for (nfds_t p = 2; p < count; p++) {
+            uint8_t i = slots[p - 2];
+            if (polls[p].revents & (POLLIN | POLLHUP | POLLERR))
+                readClient(server, i);
+        }
+        processBatch(server);
+        wait = server -> searching ? expireQueue(server) : -1;
+        for (uint8_t i = 0; i < HINT_MAX_CLIENTS; i++)
+            if (server -> clients[i].fd >= 0 && server -> clients[i].outUsed)
+                flush(server, i);
+        if (server -> options.report)
+            report(server, &last, &lastTime);
+    }
+    return 0;
+}
+
+void HintServer_stop(HintServer *server) {
+    server -> quit = TRUE;
+    wakeUp(server);
+}
+
+int HintServer_create(HintServer *server, const char *path, const HintOptions *options) {
+    memset(server, 0, sizeof *server);
+    server -> options = *options;
+    server -> listener = -1;
+    server -> wake[0] = server -> wake[1] = -1;
+    for (uint8_t i = 0; i < HINT_MAX_CLIENTS; i++)
+        server -> clients[i].fd = -1;
+    if (!options -> net || options -> cacheBits < 1 || options -> cacheBits > 30 || options -> threads < 0
+            || options -> threads > SEARCH_MAX_THREADS || strlen(path) >= sizeof server -> path) {
+        errno = EINVAL;
+        return -1;
+    }
+    strcpy(server -> path, path);
+    server -> cache = calloc((size_t) 1 << options -> cacheBits, sizeof(HintCacheEntry));
+    if (!server -> cache || pipe(server -> wake) != 0)
+        goto fail;
+    setNonBlocking(server -> wake[0]);
+    setNonBlocking(server -> wake[1]);
+
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    server -> listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server -> listener < 0)
+        goto fail;
+    unlink(path);
+    if (bind(server -> listener, (struct sockaddr *) &address, sizeof address) != 0
+            || listen(server -> listener, HINT_MAX_CLIENTS) != 0)
+        goto fail;
+    setNonBlocking(server -> listener);
+
+    if (options -> threads > 0) {
+        if (Search_create(&server -> search, options -> net, options -> book, options -> tableMB, FALSE,
+                options -> threads) != 0) {
+            errno = ENOMEM;
+            goto fail;
+        }
+        pthread_mutex_init(&server -> lock, NULL);
+        pthread_cond_init(&server -> ready, NULL);
+        if (pthread_create(&server -> thread, NULL, searchLoop, server) != 0) {
+            Search_free(&server -> search);
+            pthread_mutex_destroy(&server -> lock);
+            pthread_cond_destroy(&server -> ready);
+            errno = EAGAIN;
+            goto fail;
+        }
+        server -> searching = TRUE;
+    }
+    server -> started = Search_now();
+    return 0;
+fail:;
+    int error = errno;
+    HintServer_free(server);
+    errno = error;
+    return -1;
+}
+
+void HintServer_free(HintServer *server) {
+    if (server -> searching) {
+        pthread_mutex_lock(&server -> lock);
+        server -> quit = TRUE;
+        pthread_cond_broadcast(&server -> ready);
+        pthread_mutex_unlock(&server -> lock);
+        pthread_join(server -> thread, NULL);
+        Search_free(&server -> search);
+        pthread_mutex_destroy(&server -> lock);
+        pthread_cond_destroy(&server -> ready);
+        server -> searching = FALSE;
+    }
+    for (uint8_t i = 0; i < HINT_MAX_CLIENTS; i++) {
+        if (server -> clients[i].fd >= 0)
+            close(server -> clients[i].fd);
+        server -> clients[i].fd = -1;
+        free(server -> clients[i].out);
+        server -> clients[i].out = NULL;
+    }
+    if (server -> listener >= 0) {
+        close(server -> listener);
+        unlink(server -> path);
+        server -> listener = -1;
+    }
+    for (uint8_t i = 0; i < 2; i++)
+        if (server -> wake[i] >= 0)
+            close(server -> wake[i]);
+    server -> wake[0] = server -> wake[1] = -1;
+    free(server -> cache);
+    server -> cache = NULL;
+}
@@ -0,0 +1,170 @@
+#ifndef HINT_SERVER_H
+#define HINT_SERVER_H
+/*
+ * A hint server on a Unix domain socket, so every local tool can ask one
+ * warm solver for moves instead of loading its own. tools/hintd runs it,
+ * tools/hintclient.py is a client.
+ *
+ * Clients send HintRequests and get a HintReply for each, with a HintStats
+ * after it for HINT_STATS, in the byte order of the machine. A connection
+ * can have any number of requests outstanding; replies come in the order
+ * they are ready, with the request's id.
+ *
+ * Each pass of the server's loop takes every request that has arrived on
+ * any connection as one batch. Boards are made canonical and looked up in
+ * a cache of earlier answers, then in the endgame table if there is one.
+ * The rest are valued together, all four moves of every board by the
+ * N-tuple network, which answers them straight away if their deadline is
+ * too close to search. Otherwise they go to a search thread (see Search.h),
+ * earliest deadline first, which searches each until just before its
+ * deadline, or answers with the batch's move if the deadline has gone by
+ * the time it gets to it.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Bitboard.h"
+#include "Book.h"
+#include "Endgame.h"
+#include "NTuple.h"
+#include "Search.h"
+
+#define HINT_MAX_CLIENTS 64
+#define HINT_MAX_BATCH 256
+// Requests being searched or waiting to be
+#define HINT_QUEUE 1024
+#define HINT_BUFFER 4096
+
+// Request types
+enum {
+    HINT_MOVE,
+    HINT_STATS
+};
+
+// Where an answer came from
+enum {
+    HINT_GREEDY,        // the network, one move ahead
+    HINT_SEARCH,        // Search_best, or the opening book at depth 0
+    HINT_ENDGAME        // the endgame table, value is the chance of the goal
+};
+
+typedef struct {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t deadline;  // milliseconds, 0 for the fastest answer
+    uint32_t id;        // returned in the reply
+    Bitboard board;     // layout of Bitboard.h
+} HintRequest;
+
+typedef struct {
+    uint8_t type;       // of the request
+    uint8_t source;
+    uint8_t depth;      // moves searched
+    int8_t move;        // Direction, -1 if the game is over
+    uint32_t id;
+    float value;        // expected score from here on
+    uint8_t cached;     // TRUE if it came from the cache
+    uint8_t reserved[3];
+} HintReply;
+
+typedef struct {
+    uint64_t requests;      // for moves
+    uint64_t cacheHits;
+    uint64_t endgameHits;
+    uint64_t batches;       // valued by the network
+    uint64_t batched;       // boards in them
+    uint64_t searches;
+    uint64_t late;          // answered after their deadline
+    uint64_t microseconds;  // since the server started
+    uint32_t clients;       // connected now
+    uint32_t reserved;
+} HintStats;
+
+typedef struct {
+    const NTuple *net;
+    const Book *book;       // may be NULL
+    const Endgame *endgame; // may be NULL
+    int threads;            // for searching, 0 to only answer from the batches
+    uint32_t tableMB;       // for the search
+    uint8_t cacheBits;      // the cache has 2^cacheBits entries
+    uint8_t maxDepth;       // of a search
+    FILE *report;           // gets the statistics every few seconds unless NULL
+} HintOptions;
+
+typedef struct {
+    Bitboard board;         // canonical
+    float value;
+    int8_t move;            // on the canonical board
+    uint8_t source;
+    uint8_t depth;
+    uint8_t reserved;
+} HintCacheEntry;
+
+typedef struct {
+    int fd;                 // -1 when the slot is free
+    uint32_t generation;    // changes when the slot is reused
+    uint8_t in[HINT_BUFFER];
+    size_t inUsed;
+    uint8_t *out;
+    size_t outUsed;
+    size_t outCapacity;
+} HintClient;
+
+typedef struct {
+    Bitboard canonical;
+    uint8_t symmetry;
+    uint8_t client;
+    uint32_t generation;
+    uint32_t id;
+    double deadline;        // 0 for none
+    HintReply reply;        // the batch's answer, on the canonical board
+} HintJob;
+
+typedef struct {
+    HintOptions options;
+    int listener;
+    char path[108];
+    HintClient clients[HINT_MAX_CLIENTS];
+    HintCacheEntry *cache;
+    HintJob batch[HINT_MAX_BATCH];
+    uint32_t batchCount;
+    // The search thread, its queue is a heap by deadline
+    Boolean searching;
+    Search search;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    HintJob queue[HINT_QUEUE];
+    uint32_t queued;
+    HintJob done[HINT_QUEUE];
+    uint32_t doneCount;
+    uint32_t inFlight;
+    // Written to wake the loop
+    int wake[2];
+    volatile Boolean quit;
+    HintStats stats;
+    double started;
+} HintServer;
+
+/*
+ * Listens on path, replacing a socket left there, and starts the search
+ * thread. Returns 0, or -1 with errno set.
+ */
+int HintServer_create(HintServer *server, const char *path, const HintOptions *options);
+
+/*
+ * Answers requests until HintServer_stop. Returns 0, or -1 with errno set
+ * if the loop fails.
+ */
+int HintServer_run(HintServer *server);
+
+/*
+ * Makes HintServer_run return, from any thread or a signal handler
+ */
+void HintServer_stop(HintServer *server);
+
+/*
+ * Stops the search thread, closes every connection and removes the socket
+ */
+void HintServer_free(HintServer *server);
+#endif
@@ -0,0 +1,308 @@
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NTuple.h"
+
+#define MAGIC "NTW"
+#define VERSION 1
+#define NO_CELL 0xFF
+
+/**
+ * Allocates zeroed tables for the tuples already in net
+ */
+static int allocate(NTuple *net) {
+    for (uint8_t t = 0; t < net -> count; t++) {
+        net -> weights[t] = calloc(NTuple_tableSize(net, t), sizeof(float));
+        if (!net -> weights[t]) {
+            NTuple_free(net);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int NTuple_create(NTuple *net, const char *const tuples[], uint8_t count, uint8_t base) {
+    memset(net, 0, sizeof *net);
+    if (count == 0 || count > NTUPLE_MAX_TUPLES || base < 2 || base > NTUPLE_BASE)
+        return -1;
+    net -> count = count;
+    net -> base = base;
+    for (uint8_t t = 0; t < count; t++) {
+        uint8_t size = strlen(tuples[t]);
+        if (size == 0 || size > NTUPLE_MAX_CELLS)
+            return -1;
+        for (uint8_t i = 0; i < size; i++) {
+            char c = tuples[t][i];
+            if (c >= '0' && c <= '9')
+                net -> cells[t][i] = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                net -> cells[t][i] = c - 'a' + 10;
+            else
+                return -1;
+        }
+        net -> size[t] = size;
+    }
+    return allocate(net);
+}
+
+void NTuple_free(NTuple *net) {
+    for (uint8_t t = 0; t < NTUPLE_MAX_TUPLES; t++) {
+        free(net -> weights[t]);
+        net -> weights[t] = NULL;
+    }
+}
+
+uint32_t NTuple_tableSize(const NTuple *net, uint8_t tuple) {
+    uint32_t size = 1;
+    for (uint8_t i = 0; i < net -> size[tuple]; i++)
+        size *= net -> base;
+    return size;
+}
+
+void NTuple_indices(const NTuple *net, Bitboard board,
+        uint32_t indices[8 * NTUPLE_MAX_TUPLES]) {
+    Bitboard all[8];
+    Bitboard_symmetries(board, all);
+    uint8_t top = net -> base - 1;
+    for (uint8_t s = 0; s < 8; s++) {
+        uint8_t exponents[16];
+        for (uint8_t cell = 0; cell < 16; cell++) {
+            uint8_t exponent = (all[s] >> (4 * cell)) & 0x0F;
+            exponents[cell] = exponent < top ? exponent : top;
+        }
+        for (uint8_t t = 0; t < net -> count; t++) {
+            uint32_t index = 0;
+            for (int8_t i = net -> size[t] - 1; i >= 0; i--)
+                index = index * net -> base + exponents[net -> cells[t][i]];
+            *indices++ = index;
+        }
+    }
+}
+
+float NTuple_value(const NTuple *net, Bitboard board) {
+    uint32_t indices[8 * NTUPLE_MAX_TUPLES];
+    NTuple_indices(net, board, indices);
+    float value = 0;
+    for (uint8_t s = 0; s < 8; s++)
+        for (uint8_t t = 0; t < net -> count; t++)
+            value += net -> weights[t][indices[s * net -> count + t]];
+    return value;
+}
+
+void NTuple_update(NTuple *net, Bitboard board, float delta) {
+    uint32_t indices[8 * NTUPLE_MAX_TUPLES];
+    NTuple_indices(net, board, indices);
+    // Hogwild: plain loads and stores, a lost update costs less than a lock
+    for (uint8_t s = 0; s < 8; s++)
+        for (uint8_t t = 0; t < net -> count; t++)
+            net -> weights[t][indices[s * net -> count + t]] += delta;
+}
+
+/**
+ * Largest weight, to scale the rest by when quantizing
+ */
+static float largest(const NTuple *net) {
+    float max = 0;
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint32_t size = NTuple_tableSize(net, t);
+        for (uint32_t i = 0; i < size; i++)
+            if (fabsf(net -> weights[t][i]) > max)
+                max = fabsf(net -> weights[t][i]);
+    }
+    return max;
+}
+
+static int32_t quantize(float weight, float scale, int32_t limit) {
+    long q = lroundf(weight / scale);
+    return q > limit ? limit : q < -limit ? -limit : q;
+}
+
+static void putLittle(uint8_t *out, uint32_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++)
+        out[i] = value >> (8 * i);
+}
+
+static uint32_t getLittle(const uint8_t *in, uint8_t bytes) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+        value |= (uint32_t) in[i] << (8 * i);
+    return value;
+}
+
+int NTuple_save(const NTuple *net, const char *path, uint8_t bits) {
+    if (bits != 8 && bits != 16) {
+        errno = EINVAL;
+        return -1;
+    }
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return -1;
+    int32_t limit = bits == 8 ? INT8_MAX : INT16_MAX;
+    float max = largest(net);
+    float scale = max > 0 ? max / limit : 1;
+    uint8_t header[12] = {'N', 'T', 'W', VERSION, net -> count, net -> base, bits, 0};
+    uint32_t scaleBits;
+    memcpy(&scaleBits, &scale, sizeof scaleBits);
+    putLittle(header + 8, scaleBits, 4);
+    fwrite(header, 1, sizeof header, file);
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint8_t tuple[1 + NTUPLE_MAX_CELLS + 1];
+        memset(tuple, NO_CELL, sizeof tuple);
+        tuple[0] = net -> size[t];
+        memcpy(tuple + 1, net -> cells[t], net -> size[t]);
+        fwrite(tuple, 1, sizeof tuple, file);
+    }
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint32_t size = NTuple_tableSize(net, t);
+        for (uint32_t i = 0; i < size; i++) {
+            uint8_t out[2];
+            putLittle(out, quantize(net -> weights[t][i], scale, limit), bits / 8);
+            fwrite(out, 1, bits / 8, file);
+        }
+    }
+    if (fclose(file) != 0)
+        return -1;
+    return 0;
+}
+
+int NTuple_saveHeader(const NTuple *net, const char *path, const char *name) {
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return -1;
+    float max = largest(net);
+    float scale = max > 0 ? max / INT8_MAX : 1;
+    char upper[32];
+    uint8_t length = 0;
+    for (; name[length] && length < sizeof upper - 1; length++)
+        upper[length] = toupper((unsigned char) name[length]);
+    upper[length] = '\0';
+    fprintf(file, "/* Generated by tools/ntrain, a value is the sum of the weights times %g */\n", scale);
+    fprintf(file, "#include <avr/pgmspace.h>\n\n");
+    fprintf(file, "#define %s_TABLE_TUPLES %u\n", upper, net -> count);
+    fprintf(file, "#define %s_TABLE_BASE %u\n\n", upper, net -> base);
+    fprintf(file, "static const uint8_t %sCells[%u][%u] PROGMEM = {\n", name, net -> count, NTUPLE_MAX_CELLS);
+    for (uint8_t t = 0; t < net -> count; t++) {
+        fprintf(file, "    {");
+        for (uint8_t i = 0; i < NTUPLE_MAX_CELLS; i++)
+            fprintf(file, "%s%u", i ? ", " : "", i < net -> size[t] ? net -> cells[t][i] : NO_CELL);
+        fprintf(file, "}%s\n", t + 1 < net -> count ? "," : "");
+    }
+    fprintf(file, "};\n\n");
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint32_t size = NTuple_tableSize(net, t);
+        fprintf(file, "static const int8_t %sWeights%u[%lu] PROGMEM = {", name, t, (unsigned long) size);
+        for (uint32_t i = 0; i < size; i++)
+            fprintf(file, "%s%d", i % 16 ? ", " : (i ? ",\n    " : "\n    "),
+                    (int) quantize(net -> weights[t][i], scale, INT8_MAX));
+        fprintf(file, "\n};\n\n");
+    }
+    if (fclose(file) != 0)
+        return -1;
+    return 0;
+}
+
+int NTuple_load(NTuple *net, const char *path) {
+    memset(net, 0, sizeof *net);
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return -1;
+    uint8_t header[12];
+    if (fread(header, 1, sizeof header, file) != sizeof header
+            || memcmp(header, MAGIC, 3) != 0 || header[3] != VERSION
+            || header[4] == 0 || header[4] > NTUPLE_MAX_TUPLES
+            || header[5] < 2 || header[5] > NTUPLE_BASE
+            || (header[6] != 8 && header[6] != 16)) {
+        fclose(file);
+        return -1;
+    }
+    net -> count = header[4];
+    net -> base = header[5];
+    uint8_t bytes = header[6] / 8;
+    uint32_t scaleBits = getLittle(header + 8, 4);
+    float scale;
+    memcpy(&scale, &scaleBits, sizeof scale);
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint8_t tuple[1 + NTUPLE_MAX_CELLS + 1];
+        if (fread(tuple, 1, sizeof tuple, file) != sizeof tuple
+                || tuple[0] == 0 || tuple[0] > NTUPLE_MAX_CELLS) {
+            fclose(file);
+            return -1;
+        }
+        net -> size[t] = tuple[0];
+        for (uint8_t i = 0; i < tuple[0]; i++) {
+            if (tuple[1 + i] > 15) {
+                fclose(file);
+                return -1;
+            }
+            net -> cells[t][i] = tuple[1 + i];
+        }
+    }
+    if (allocate(net) != 0) {
+        fclose(file);
+        return -1;
+    }
+    for (uint8_t t = 0; t < net -> count; t++) {
+        uint32_t size = NTuple_tableSize(net, t);
+        for (uint32_t i = 0; i < size; i++) {
+            uint8_t in[2];
+            if (fread(in, 1, bytes, file) != bytes) {
+                NTuple_free(net);
+                fclose(file);
+                return -1;
+            }
+            int32_t q = bytes == 1 ? (int8_t) in[0] : (int16_t) getLittle(in, 2);
+            net -> weights[t][i] = q * scale;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+int NTuple_trim(const NTuple *net, NTuple *trimmed, uint8_t maxSize, uint8_t base) {
+    memset(trimmed, 0, sizeof *trimmed);
+    if (base < 2 || base > net -> base)
+        return -1;
+    trimmed -> base = base;
+    uint8_t keep[NTUPLE_MAX_TUPLES];
+    for (uint8_t t = 0; t < net -> count; t++) {
+        if (net -> size[t] > maxSize)
+            continue;
+        keep[trimmed -> count] = t;
+        trimmed -> size[trimmed -> count] = net -> size[t];
+        memcpy(trimmed -> cells[trimmed -> count], net -> cells[t], net -> size[t]);
+        trimmed -> count++;
+    }
+    if (trimmed -> count == 0 || allocate(trimmed) != 0)
+        return -1;
+    for (uint8_t t = 0; t < trimmed -> count; t++) {
+        const float *from = net -> weights[keep[t]];
+        float *to = trimmed -> weights[t];
+        uint32_t *counts = calloc(NTuple_tableSize(trimmed, t), sizeof *counts);
+        if (!counts) {
+            NTuple_free(trimmed);
+            return -1;
+        }
+        uint32_t size = NTuple_tableSize(net, keep[t]);
+        for (uint32_t i = 0; i < size; i++) {
+            // Clamp every digit of the index to the smaller base
+            uint32_t index = 0;
+            uint32_t rest = i;
+            uint32_t place = 1;
+            for (uint8_t digit = 0; digit < trimmed -> size[t]; digit++) {
+                uint8_t exponent = rest % net -> base;
+                rest /= net -> base;
+                index += (exponent < base - 1 ? exponent : base - 1) * place;
+                place *= base;
+            }
+            to[index] += from[i];
+            counts[index]++;
+        }
+        for (uint32_t i = 0; i < NTuple_tableSize(trimmed, t); i++)
+            to[i] /= counts[i];
+        free(counts);
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef NTUPLE_H
+#define NTUPLE_H
+/*
+ * N-tuple networks: a board is valued as the sum of one table lookup per
+ * tuple of cells, indexed by the exponents in those cells, over all 8
+ * symmetries of the board. tools/ntrain learns the tables by self play.
+ *
+ * Weight files (.ntw) are little endian:
+ *
+ *     "NTW" 1          magic and version
+ *     count base bits  tuples, exponents per cell, 8 or 16 bit weights
+ *     0                reserved
+ *     scale            float, a weight is its stored value times scale
+ *     count x 8 bytes  size of the tuple then its cells, padded with 0xFF
+ *     tables           base^size weights for every tuple in turn
+ *
+ * Exponents of base or more are stored as base - 1, which is what lets a
+ * trimmed network with a small base fit in flash.
+ */
+#include <stdint.h>
+#include "Bitboard.h"
+
+#define NTUPLE_MAX_TUPLES 8
+#define NTUPLE_MAX_CELLS 6
+#define NTUPLE_BASE 16
+
+typedef struct {
+    uint8_t count;
+    uint8_t base;
+    uint8_t size[NTUPLE_MAX_TUPLES];
+    uint8_t cells[NTUPLE_MAX_TUPLES][NTUPLE_MAX_CELLS];
+    float *weights[NTUPLE_MAX_TUPLES];
+} NTuple;
+
+/*
+ * Allocates zeroed tables for the tuples given as strings of hex cell
+ * numbers, "0123" for the top row. Returns 0, or -1 if a tuple is invalid or
+ * there isn't enough memory.
+ */
+int NTuple_create(NTuple *net, const char *const tuples[], uint8_t count, uint8_t base);
+
+void NTuple_free(NTuple *net);
+
+/*
+ * Number of weights in the table of tuple
+ */
+uint32_t NTuple_tableSize(const NTuple *net, uint8_t tuple);
+
+/*
+ * Table index of every tuple in every symmetry of board, in the order
+ * NTuple_value and NTuple_update use them
+ */
+void NTuple_indices(const NTuple *net, Bitboard board,
+        uint32_t indices[8 * NTUPLE_MAX_TUPLES]);
+
+float NTuple_value(const NTuple *net, Bitboard board);
+
+/*
+ * Adds delta to every weight that makes up the value of board. Safe to call
+ * from several threads without locking: updates can be lost when two
+ * threads hit the same weight, which training shrugs off.
+ */
+void NTuple_update(NTuple *net, Bitboard board, float delta);
+
+/*
+ * Writes the network to path quantized to bits (8 or 16) per weight.
+ * Returns 0 or -1 with errno set.
+ */
+int NTuple_save(const NTuple *net, const char *path, uint8_t bits);
+
+/*
+ * Writes the network as a C header for the firmware: the tuples and 8 bit
+ * weights in PROGMEM arrays whose names start with name, and their count
+ * and base as NAME_TABLE_TUPLES and NAME_TABLE_BASE, which can't clash
+ * with the macros here. Returns 0 or -1 with errno set.
+ */
+int NTuple_saveHeader(const NTuple *net, const char *path, const char *name);
+
+/*
+ * Reads a weight file written by NTuple_save. Returns 0, or -1 if it can't
+ * be read or isn't a weight file.
+ */
+int NTuple_load(NTuple *net, const char *path);
+
+/*
+ * Makes a smaller copy of net for the capsule, keeping only the tuples of
+ * at most maxSize cells and storing exponents up to base - 1. Each trimmed
+ * weight is the mean of the weights it replaces. Returns -1 if no tuple is
+ * small enough.
+ */
+int NTuple_trim(const NTuple *net, NTuple *trimmed, uint8_t maxSize, uint8_t base);
+#endif
@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "Search.h"
+
+#define HUGE_PAGE (2UL << 20)
+// At most 15 empty cells after a move, each spawn can be a 2 or a 4, and
+// the split goes down two chance nodes
+#define MAX_TASKS (4 * 30 * 4 * 30)
+// Splitting goes down another chance node when there are fewer tasks than
+// this for each thread
+#define TASKS_PER_THREAD 4
+// How often each thread looks at the clock, in nodes, a power of two
+#define CLOCK_NODES 4096
+// Each move deeper takes at least this many times longer to search
+#define DEEPEN_FACTOR 4
+
+typedef struct {
+    Search *search;
+    uint64_t nodes;
+} Worker;
+
+double Search_now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static inline SearchEntry *bucketOf(const Search *search, Bitboard board) {
+    return search -> buckets[(board * 0x9E3779B97F4A7C15ULL) >> (64 - search -> bucketBits)];
+}
+
+/**
+ * The value of the chance node after a move, if the table has it from a
+ * search at least depth deep
+ */
+static Boolean lookup(const Search *search, Bitboard after, uint8_t depth, float *value) {
+    SearchEntry *bucket = bucketOf(search, after);
+    for (uint8_t i = 0; i < SEARCH_BUCKET; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        if (data && (check ^ data) == after && (uint8_t) (data >> 32) >= depth) {
+            uint32_t bits = (uint32_t) data;
+            memcpy(value, &bits, sizeof bits);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Stores a value over the entry for the same board if it isn't deeper,
+ * otherwise over the shallowest entry in the bucket
+ */
+static void store(Search *search, Bitboard after, uint8_t depth, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    uint64_t data = ((uint64_t) depth << 32) | bits;
+    SearchEntry *bucket = bucketOf(search, after);
+    uint8_t victim = 0;
+    uint8_t victimDepth = 0xFF;
+    for (uint8_t i = 0; i < SEARCH_BUCKET; i++) {
+        uint64_t old = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        uint8_t oldDepth = old ? (uint8_t) (old >> 32) : 0;
+        if (old && (check ^ old) == after) {
+            if (oldDepth > depth)
+                return;
+            victim = i;
+            break;
+        }
+        if (oldDepth < victimDepth) {
+            victim = i;
+            victimDepth = oldDepth;
+        }
+    }
+    __atomic_store_n(&bucket[victim].check, after ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&bucket[victim].data, data, __ATOMIC_RELAXED);
+}
+
+static float chance(Worker *worker, Bitboard after, uint8_t depth, float probability);
+
+/**
+ * Value of the best move from a position, whose moves lead to chance nodes
+ * depth - 1 deep. Worth nothing once the time is up.
+ */
+static float maxNode(Worker *worker, Bitboard board, uint8_t depth, float probability) {
+    Search *search = worker -> search;
+    if ((++worker -> nodes & (CLOCK_NODES - 1)) == 0 && search -> deadline > 0
+            && Search_now() > search -> deadline)
+        __atomic_store_n(&search -> aborted, TRUE, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&search -> aborted, __ATOMIC_RELAXED))
+        return 0;
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    Boolean any = FALSE;
+    float best = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + chance(worker, results[dir], depth - 1, probability);
+        if (!any || value > best) {
+            best = value;
+            any = TRUE;
+        }
+    }
+    return best;
+}
+
+/**
+ * Average value over the spawns after a move, from the network at depth 0
+ */
+static float chance(Worker *worker, Bitboard after, uint8_t depth, float probability) {
+    Search *search = worker -> search;
+    uint8_t empty = Bitboard_empty(after);
+    if (!depth || !empty || probability < SEARCH_MIN_PROBABILITY)
+        return NTuple_value(search -> net, after);
+    float value;
+    if (lookup(search, after, depth, &value))
+        return value;
+    float sum = 0;
+    for (uint8_t cell = 0; cell < 16; cell++) {
+        if ((after >> (4 * cell)) & 0x0F)
+            continue;
+        sum += 0.9f * maxNode(worker, after | (1ULL << (4 * cell)), depth, probability * 0.9f / empty);
+        sum += 0.1f * maxNode(worker, after | (2ULL << (4 * cell)), depth, probability * 0.1f / empty);
+    }
+    value = sum / empty;
+    // Values worked out after the time ran out are wrong
+    if (!__atomic_load_n(&search -> aborted, __ATOMIC_RELAXED))
+        store(search, after, depth, value);
+    return value;
+}
+
+/*
+ * The top of the tree is walked twice by the main thread with the same
+ * recursion: first to add a task for every max node levels chance nodes
+ * down, then to combine the values of the tasks in the same order.
+ */
+static float splitMax(Search *search, Bitboard board, uint8_t depth, float probability, uint8_t levels,
+        Boolean combine);
+
+static float splitChance(Search *search, Bitboard after, uint8_t depth, float probability, uint8_t levels,
+        Boolean combine) {
+    uint8_t empty = Bitboard_empty(after);
+    if (!depth || !empty || probability < SEARCH_MIN_PROBABILITY)
+        return combine ? NTuple_value(search -> net, after) : 0;
+    float sum = 0;
+    for (uint8_t cell = 0; cell < 16; cell++) {
+        if ((after >> (4 * cell)) & 0x0F)
+            continue;
+        for (uint8_t tile = 1; tile <= 2; tile++) {
+            float odds = tile == 1 ? 0.9f : 0.1f;
+            Bitboard spawned = after | ((Bitboard) tile << (4 * cell));
+            float value = 0;
+            if (levels > 1) {
+                value = splitMax(search, spawned, depth, probability * odds / empty, levels - 1, combine);
+            } else if (combine) {
+                value = search -> tasks[search -> nextTask++].value;
+            } else {
+                SearchTask *task = &search -> tasks[search -> taskCount++];
+                task -> board = spawned;
+                task -> probability = probability * odds / empty;
+            }
+            sum += odds * value;
+        }
+    }
+    return sum / empty;
+}
+
+static float splitMax(Search *search, Bitboard board, uint8_t depth, float probability, uint8_t levels,
+        Boolean combine) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    Boolean any = FALSE;
+    float best = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + splitChance(search, results[dir], depth - 1, probability, levels, combine);
+        if (!any || value > best) {
+            best = value;
+            any = TRUE;
+        }
+    }
+    return best;
+}
+
+static void runTasks(Search *search, Worker *worker) {
+    uint32_t i;
+    while ((i = __atomic_fetch_add(&search -> nextTask, 1, __ATOMIC_RELAXED)) < search -> taskCount) {
+        SearchTask *task = &search -> tasks[i];
+        task -> value = maxNode(worker, task -> board, search -> depth, task -> probability);
+    }
+}
+
+static void *work(void *arg) {
+    Search *search = arg;
+    uint32_t seen = 0;
+    pthread_mutex_lock(&search -> lock);
+    for (;;) {
+        while (search -> generation == seen && !search -> quit)
+            pthread_cond_wait(&search -> start, &search -> lock);
+        if (search -> quit)
+            break;
+        seen = search -> generation;
+        pthread_mutex_unlock(&search -> lock);
+        Worker worker = {search, 0};
+        runTasks(search, &worker);
+        pthread_mutex_lock(&search -> lock);
+        search -> nodes += worker.nodes;
+        if (--search -> working == 0)
+            pthread_cond_signal(&search -> done);
+    }
+    pthread_mutex_unlock(&search -> lock);
+    return NULL;
+}
+
+/**
+ * Runs the tasks on the pool and the main thread, returning once they are
+ * all done
+ */
+static void runBatch(Search *search) {
+    if (!search -> taskCount)
+        return;
+    pthread_mutex_lock(&search -> lock);
+    search -> nextTask = 0;
+    search -> working = search -> threads - 1;
+    search -> generation++;
+    pthread_cond_broadcast(&search -> start);
+    pthread_mutex_unlock(&search -> lock);
+    Worker worker = {search, 0};
+    runTasks(search, &worker);
+    pthread_mutex_lock(&search -> lock);
+    search -> nodes += worker.nodes;
+    while (search -> working)
+        pthread_cond_wait(&search -> done, &search -> lock);
+    pthread_mutex_unlock(&search -> lock);
+}
+
+/**
+ * Searches depth moves deep, returning FALSE if the time ran out first
+ */
+static Boolean searchDepth(Search *search, Bitboard board, uint8_t depth, SearchResult *result) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    uint8_t levels = 0;
+    do {
+        levels++;
+        search -> taskCount = 0;
+        for (uint8_t dir = 0; dir < 4; dir++)
+            if (mask & (1 << dir))
+                splitChance(search, results[dir], depth - 1, 1.0f, levels, FALSE);
+    } while (levels == 1 && depth >= 3 && search -> taskCount < TASKS_PER_THREAD * (uint32_t) search -> threads);
+    search -> depth = depth - levels;
+    runBatch(search);
+    if (search -> aborted)
+        return FALSE;
+    search -> nextTask = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + splitChance(search, results[dir], depth - 1, 1.0f, levels, TRUE);
+        // The first move at this depth replaces what the last depth found
+        if (result -> depth != depth || value > result -> value) {
+            result -> move = dir;
+            result -> value = value;
+            result -> depth = depth;
+        }
+    }
+    return TRUE;
+}
+
+SearchResult Search_best(Search *search, Bitboard board, double seconds, uint8_t maxDepth) {
+    SearchResult result = {-1, 0, 0, 0, 0};
+    double start = Search_now();
+    search -> nodes = 0;
+    if (Bitboard_gameOver(board))
+        return result;
+    Direction move;
+    float value;
+    if (search -> book && Book_lookup(search -> book, board, &move, &value)) {
+        result.move = move;
+        result.value = value;
+        result.seconds = Search_now() - start;
+        return result;
+    }
+    if (maxDepth < 1)
+        maxDepth = 1;
+    if (maxDepth > SEARCH_MAX_DEPTH)
+        maxDepth = SEARCH_MAX_DEPTH;
+    search -> deadline = seconds > 0 ? start + seconds : 0;
+    search -> aborted = FALSE;
+    // A depth 1 search has no tasks and can't run out of time, so there is
+    // always a move
+    for (uint8_t depth = 1; depth <= maxDepth; depth++) {
+        double begun = Search_now();
+        if (!searchDepth(search, board, depth, &result))
+            break;
+        double now = Search_now();
+        if (seconds > 0 && now + (now - begun) * DEEPEN_FACTOR > search -> deadline)
+            break;
+    }
+    result.nodes = search -> nodes;
+    result.seconds = Search_now() - start;
+    return result;
+}
+
+void Search_clear(Search *search) {
+    memset(search -> buckets, 0, search -> length);
+}
+
+int Search_create(Search *search, const NTuple *net, const Book *book, uint32_t tableMB,
+        Boolean hugePages, int threads) {
+    memset(search, 0, sizeof *search);
+    if (threads < 1 || threads > SEARCH_MAX_THREADS)
+        return -1;
+    search -> net = net;
+    search -> book = book;
+    // At least two buckets, so the hash can be shifted down to an index
+    uint8_t bits = 1;
+    while (bits < 40 && (sizeof *search -> buckets << (bits + 1)) <= ((size_t) tableMB << 20))
+        bits++;
+    search -> bucketBits = bits;
+    search -> length = sizeof *search -> buckets << bits;
+    void *map = MAP_FAILED;
+    if (hugePages && search -> length >= HUGE_PAGE) {
+        map = mmap(NULL, search -> length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        search -> hugePages = map != MAP_FAILED;
+    }
+    if (map == MAP_FAILED) {
+        map = mmap(NULL, search -> length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            return -1;
+        if (hugePages)
+            madvise(map, search -> length, MADV_HUGEPAGE);
+    }
+    // Fresh pages are zeroes, which is an empty table
+    search -> buckets = map;
+    search -> tasks = malloc(MAX_TASKS * sizeof(SearchTask));
+    if (!search -> tasks) {
+        munmap(map, search -> length);
+        return -1;
+    }
+    pthread_mutex_init(&search -> lock, NULL);
+    pthread_cond_init(&search -> start, NULL);
+    pthread_cond_init(&search -> done, NULL);
+    search -> threads = threads;
+    for (int i = 0; i < threads - 1; i++)
+        if (pthread_create(&search -> pool[i], NULL, work, search) != 0) {
+            search -> threads = i + 1;
+            Search_free(search);
+            return -1;
+        }
+    return 0;
+}
+
+void Search_free(Search *search) {
+    if (!search -> buckets)
+        return;
+    pthread_mutex_lock(&search -> lock);
+    search -> quit = TRUE;
+    pthread_cond_broadcast(&search -> start);
+    pthread_mutex_unlock(&search -> lock);
+    for (int i = 0; i < search -> threads - 1; i++)
+        pthread_join(search -> pool[i], NULL);
+    pthread_mutex_destroy(&search -> lock);
+    pthread_cond_destroy(&search -> start);
+    pthread_cond_destroy(&search -> done);
+    munmap(search -> buckets, search -> length);
+    free(search -> tasks);
+    memset(search, 0, sizeof *search);
+}
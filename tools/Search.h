@@ -0,0 +1,113 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+/*
+ * Expectimax search on all cores. A move is worth its score plus the value
+ * of the position it leaves, which is the average over the spawns of the
+ * best move from each, down to a depth where the N-tuple network values the
+ * position instead. Spawns less likely than SEARCH_MIN_PROBABILITY are
+ * valued by the network straight away.
+ *
+ * Each depth is a batch of tasks for a pool of threads: the top of the tree
+ * is split at the chance nodes after the root moves, and at the ones after
+ * those too when that doesn't give every thread a few tasks. The main
+ * thread takes tasks as well, so a search with one thread has no pool.
+ *
+ * The threads share a transposition table of chance node values without
+ * locks. Buckets are one cache line of SEARCH_BUCKET entries, and an entry
+ * is stored as its board XORed with its data next to the data, so an entry
+ * torn by two threads writing it at once doesn't check out and is a miss.
+ *
+ * Search_best deepens one move at a time until the time is up, and answers
+ * from an opening book (see Book.h) without searching if it has the
+ * position.
+ */
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "Bitboard.h"
+#include "Book.h"
+#include "NTuple.h"
+
+#define SEARCH_MAX_THREADS 256
+#define SEARCH_MAX_DEPTH 12
+#define SEARCH_MIN_PROBABILITY 0.0001f
+#define SEARCH_BUCKET 4
+
+typedef struct {
+    uint64_t check;     // board ^ data
+    uint64_t data;      // float value, then depth in bits 32-39
+} SearchEntry;
+
+typedef struct {
+    Bitboard board;     // after the spawn
+    float probability;  // of getting there from the root
+    float value;
+} SearchTask;
+
+typedef struct {
+    int8_t move;        // Direction, -1 when the game is over
+    float value;
+    uint8_t depth;      // of the deepest search that finished, 0 from the book
+    uint64_t nodes;
+    double seconds;
+} SearchResult;
+
+typedef struct {
+    const NTuple *net;
+    const Book *book;   // may be NULL
+    // Transposition table
+    SearchEntry (*buckets)[SEARCH_BUCKET];
+    uint8_t bucketBits;
+    size_t length;
+    Boolean hugePages;  // explicitly, rather than transparent huge pages
+    // Thread pool
+    int threads;
+    pthread_t pool[SEARCH_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint32_t generation;
+    int working;
+    Boolean quit;
+    // The batch being searched
+    SearchTask *tasks;
+    uint32_t taskCount;
+    uint32_t nextTask;
+    uint8_t depth;      // of the max nodes the tasks start at
+    double deadline;    // 0 for none
+    Boolean aborted;
+    uint64_t nodes;
+} Search;
+
+/*
+ * Sets up a search with a table of up to tableMB megabytes (rounded down to
+ * a power of two number of buckets) and starts its threads. With hugePages
+ * the table is put on explicitly reserved huge pages if there are enough,
+ * otherwise it asks for transparent huge pages. Returns 0, or -1 if there
+ * isn't enough memory or the threads can't be started.
+ */
+int Search_create(Search *search, const NTuple *net, const Book *book, uint32_t tableMB,
+        Boolean hugePages, int threads);
+
+/*
+ * Stops the threads and frees the table
+ */
+void Search_free(Search *search);
+
+/*
+ * Empties the transposition table
+ */
+void Search_clear(Search *search);
+
+/*
+ * The best move for board, searching one move deeper at a time up to
+ * maxDepth moves, or until seconds have passed. With seconds 0 or less it
+ * always goes to maxDepth.
+ */
+SearchResult Search_best(Search *search, Bitboard board, double seconds, uint8_t maxDepth);
+
+/*
+ * Seconds on a monotonic clock
+ */
+double Search_now(void);
+#endif
@@ -0,0 +1,290 @@
+/*
+ * Python bindings for the board rules in Engine.h, built with
+ * `make -C tools python` as tools/board2048.*.so.
+ *
+ * The batch functions take any C contiguous buffer of unsigned integers of
+ * the right size (array.array('Q'), numpy arrays of uint64 and so on) and
+ * work on it in place through the buffer protocol, without copying a board
+ * or making a Python object for one. The interpreter lock is released while
+ * they run, so batches can be worked on from several Python threads.
+ *
+ *     import array, board2048
+ *     boards = array.array('Q', [board2048.pack([1, 1] + [0] * 14)] * 1000)
+ *     masks = bytearray(len(boards))
+ *     board2048.legal(boards, masks)
+ *     board2048.move(boards, board2048.LEFT)
+ *     state = board2048.spawn(boards, 12345)
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "Engine.h"
+
+/**
+ * Gets a C contiguous buffer of unsigned integers of itemsize bytes from
+ * obj. Returns the number of items, or -1 with an exception set.
+ */
+static Py_ssize_t getArray(PyObject *obj, Py_buffer *view, Py_ssize_t itemsize, int writable, const char *name) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(obj, view, flags) != 0)
+        return -1;
+    const char *format = view -> format ? view -> format : "B";
+    // Native or little endian, like the host
+    if (*format == '@' || *format == '=' || *format == '<')
+        format++;
+    if (view -> itemsize != itemsize || !*format || format[1] || !strchr("BHILQN", *format)) {
+        PyErr_Format(PyExc_TypeError, "%s must be an array of %zd byte unsigned integers", name, itemsize);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    return view -> len / itemsize;
+}
+
+static PyObject *lengthError(const char *name, Py_ssize_t expected) {
+    PyErr_Format(PyExc_ValueError, "%s must have %zd items", name, expected);
+    return NULL;
+}
+
+PyDoc_STRVAR(move_doc,
+"move(boards, direction, out=None, scores=None) -> int\n\n"
+"Moves every board in direction, in place unless out is given, and puts\n"
+"the score of each move in scores (uint32). Returns how many boards the\n"
+"move changed.");
+
+static PyObject *move(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"boards", "direction", "out", "scores", NULL};
+    PyObject *boardsObj, *outObj = Py_None, *scoresObj = Py_None;
+    int dir;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi|OO:move", keywords, &boardsObj, &dir, &outObj, &scoresObj))
+        return NULL;
+    if (dir < 0 || dir > 3) {
+        PyErr_SetString(PyExc_ValueError, "direction must be LEFT, RIGHT, UP or DOWN");
+        return NULL;
+    }
+    Py_buffer boards, out, scores;
+    Py_ssize_t count = getArray(boardsObj, &boards, 8, outObj == Py_None, "boards");
+    if (count < 0)
+        return NULL;
+    PyObject *result = NULL;
+    uint64_t *results = boards.buf;
+    uint32_t *scoreBuf = NULL;
+    if (outObj != Py_None) {
+        if (getArray(outObj, &out, 8, 1, "out") < 0)
+            goto releaseBoards;
+        if (out.len != boards.len) {
+            lengthError("out", count);
+            goto releaseOut;
+        }
+        results = out.buf;
+    }
+    if (scoresObj != Py_None) {
+        if (getArray(scoresObj, &scores, 4, 1, "scores") < 0)
+            goto releaseOut;
+        if (scores.len / 4 != count) {
+            lengthError("scores", count);
+            PyBuffer_Release(&scores);
+            goto releaseOut;
+        }
+        scoreBuf = scores.buf;
+    }
+    size_t changed;
+    Py_BEGIN_ALLOW_THREADS
+    changed = Engine_move(boards.buf, count, dir, results, scoreBuf);
+    Py_END_ALLOW_THREADS
+    result = PyLong_FromSize_t(changed);
+    if (scoreBuf)
+        PyBuffer_Release(&scores);
+releaseOut:
+    if (outObj != Py_None)
+        PyBuffer_Release(&out);
+releaseBoards:
+    PyBuffer_Release(&boards);
+    return result;
+}
+
+PyDoc_STRVAR(moves_doc,
+"moves(boards, out, scores=None, masks=None)\n\n"
+"All four moves of every board: out[4 * i + d] is board i moved in\n"
+"direction d, likewise scores (uint32). masks (uint8) gets the legal moves\n"
+"of each board. out can't be boards.");
+
+static PyObject *moves(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"boards", "out", "scores", "masks", NULL};
+    PyObject *boardsObj, *outObj, *scoresObj = Py_None, *masksObj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OO:moves", keywords, &boardsObj, &outObj, &scoresObj,
+            &masksObj))
+        return NULL;
+    Py_buffer boards, out, scores, masks;
+    Py_ssize_t count = getArray(boardsObj, &boards, 8, 0, "boards");
+    if (count < 0)
+        return NULL;
+    PyObject *result = NULL;
+    uint32_t *scoreBuf = NULL;
+    uint8_t *maskBuf = NULL;
+    if (getArray(outObj, &out, 8, 1, "out") < 0)
+        goto releaseBoards;
+    if (out.len / 8 != 4 * count) {
+        lengthError("out", 4 * count);
+        goto releaseOut;
+    }
+    if (out.buf == boards.buf) {
+        PyErr_SetString(PyExc_ValueError, "out can't be boards");
+        goto releaseOut;
+    }
+    if (scoresObj != Py_None) {
+        if (getArray(scoresObj, &scores, 4, 1, "scores") < 0)
+            goto releaseOut;
+        scoreBuf = scores.buf;
+        if (scores.len / 4 != 4 * count) {
+            lengthError("scores", 4 * count);
+            goto releaseMasks;
+        }
+    }
+    if (masksObj != Py_None) {
+        if (getArray(masksObj, &masks, 1, 1, "masks") < 0)
+            goto releaseMasks;
+        maskBuf = masks.buf;
+        if (masks.len != count) {
+            lengthError("masks", count);
+            goto releaseMasks;
+        }
+    }
+    Py_BEGIN_ALLOW_THREADS
+    Engine_moves(boards.buf, count, out.buf, scoreBuf, maskBuf);
+    Py_END_ALLOW_THREADS
+    Py_INCREF(Py_None);
+    result = Py_None;
+releaseMasks:
+    if (maskBuf)
+        PyBuffer_Release(&masks);
+    if (scoreBuf)
+        PyBuffer_Release(&scores);
+releaseOut:
+    PyBuffer_Release(&out);
+releaseBoards:
+    PyBuffer_Release(&boards);
+    return result;
+}
+
+PyDoc_STRVAR(legal_doc,
+"legal(boards, masks)\n\n"
+"Puts the legal moves of every board in masks (uint8), bit d is set if\n"
+"moving in direction d changes the board. 0 means the game is over.");
+
+static PyObject *legal(PyObject *self, PyObject *args) {
+    PyObject *boardsObj, *masksObj;
+    if (!PyArg_ParseTuple(args, "OO:legal", &boardsObj, &masksObj))
+        return NULL;
+    Py_buffer boards, masks;
+    Py_ssize_t count = getArray(boardsObj, &boards, 8, 0, "boards");
+    if (count < 0)
+        return NULL;
+    PyObject *result = NULL;
+    if (getArray(masksObj, &masks, 1, 1, "masks") < 0)
+        goto releaseBoards;
+    if (masks.len != count) {
+        lengthError("masks", count);
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        Engine_legal(boards.buf, count, masks.buf);
+        Py_END_ALLOW_THREADS
+        Py_INCREF(Py_None);
+        result = Py_None;
+    }
+    PyBuffer_Release(&masks);
+releaseBoards:
+    PyBuffer_Release(&boards);
+    return result;
+}
+
+PyDoc_STRVAR(spawn_doc,
+"spawn(boards, state) -> int\n\n"
+"Puts a random tile on every board with an empty cell, in place. state is\n"
+"the state of the random number generator, which can't be 0, and the new\n"
+"state is returned for the next call.");
+
+static PyObject *spawn(PyObject *self, PyObject *args) {
+    PyObject *boardsObj;
+    unsigned long long state;
+    if (!PyArg_ParseTuple(args, "OK:spawn", &boardsObj, &state))
+        return NULL;
+    Py_buffer boards;
+    Py_ssize_t count = getArray(boardsObj, &boards, 8, 1, "boards");
+    if (count < 0)
+        return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    state = Engine_spawn(boards.buf, count, state);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&boards);
+    return PyLong_FromUnsignedLongLong(state);
+}
+
+PyDoc_STRVAR(pack_doc,
+"pack(exponents) -> int\n\n"
+"The board with the 16 cell exponents given row by row, 0 for empty.");
+
+static PyObject *pack(PyObject *self, PyObject *exponents) {
+    PyObject *sequence = PySequence_Fast(exponents, "exponents must be a sequence");
+    if (!sequence)
+        return NULL;
+    if (PySequence_Fast_GET_SIZE(sequence) != 16) {
+        Py_DECREF(sequence);
+        return lengthError("exponents", 16);
+    }
+    uint64_t board = 0;
+    for (int i = 0; i < 16; i++) {
+        long exponent = PyLong_AsLong(PySequence_Fast_GET_ITEM(sequence, i));
+        if (exponent < 0 || exponent > 15) {
+            Py_DECREF(sequence);
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_ValueError, "exponents must be from 0 to 15");
+            return NULL;
+        }
+        board |= (uint64_t) exponent << (4 * i);
+    }
+    Py_DECREF(sequence);
+    return PyLong_FromUnsignedLongLong(board);
+}
+
+PyDoc_STRVAR(unpack_doc,
+"unpack(board) -> tuple\n\n"
+"The 16 cell exponents of a board, row by row.");
+
+static PyObject *unpack(PyObject *self, PyObject *boardObj) {
+    uint64_t board = PyLong_AsUnsignedLongLong(boardObj);
+    if (PyErr_Occurred())
+        return NULL;
+    PyObject *exponents = PyTuple_New(16);
+    if (!exponents)
+        return NULL;
+    for (int i = 0; i < 16; i++)
+        PyTuple_SET_ITEM(exponents, i, PyLong_FromLong((board >> (4 * i)) & 0x0F));
+    return exponents;
+}
+
+static PyMethodDef methods[] = {
+    {"move", (PyCFunction) (void (*)(void)) move, METH_VARARGS | METH_KEYWORDS, move_doc},
+    {"moves", (PyCFunction) (void (*)(void)) moves, METH_VARARGS | METH_KEYWORDS, moves_doc},
+    {"legal", legal, METH_VARARGS, legal_doc},
+    {"spawn", spawn, METH_VARARGS, spawn_doc},
+    {"pack", pack, METH_O, pack_doc},
+    {"unpack", unpack, METH_O, unpack_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "board2048", "2048 board rules on batches of 64 bit boards", -1, methods
+};
+
+PyMODINIT_FUNC PyInit_board2048(void) {
+    PyObject *m = PyModule_Create(&module);
+    if (!m)
+        return NULL;
+    if (PyModule_AddIntConstant(m, "ABI_VERSION", Engine_abiVersion()) != 0
+            || PyModule_AddIntConstant(m, "LEFT", 0) != 0 || PyModule_AddIntConstant(m, "RIGHT", 1) != 0
+            || PyModule_AddIntConstant(m, "UP", 2) != 0 || PyModule_AddIntConstant(m, "DOWN", 3) != 0) {
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+Plays 2048 on the capsule through the binary protocol (see util/Protocol.h)
+as fast as the serial link allows, and reports moves per second and round
+trip latency percentiles. 2048 must be on screen when it starts.
+
+    tools/drive2048.py /dev/ttyUSB0 --moves 500
+    tools/drive2048.py /dev/pts/3 --window 4
+
+With --window above 1 several commands are in flight at once, which keeps
+the link busy but means moves can't depend on the board, so they cycle
+through the directions instead.
+"""
+import argparse
+import os
+import random
+import select
+import sys
+import termios
+import time
+import tty
+
+START = 0x02
+STOP = 0x03
+QUERY = ord("?")
+SYNC = 0xA0
+SYNC_MASK = 0xF0
+MOVED = 0x01
+OVER = 0x02
+WON = 0x04
+FRAME_SIZE = 10
+# The recieve buffer on the device holds 16 bytes
+MAX_WINDOW = 16
+
+MOVES = {"left": b"j", "right": b"l", "up": b"i", "down": b"k"}
+# Keep the big tiles in the bottom left corner
+PREFERENCE = ["down", "left", "right", "up"]
+
+BAUDS = {9600: termios.B9600, 19200: termios.B19200, 38400: termios.B38400,
+         57600: termios.B57600, 115200: termios.B115200}
+
+
+def crc8(data):
+    crc = 0xFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def unpack(packed):
+    """Board_unpack: a 4x4 list of tile values"""
+    cells = []
+    for byte in packed:
+        for nibble in (byte & 0x0F, byte >> 4):
+            cells.append(1 << nibble if nibble else 0)
+    return [cells[i:i + 4] for i in range(0, 16, 4)]
+
+
+def slide(row):
+    """Shifts a row towards index 0 the way Board_shift does"""
+    tiles = [t for t in row if t]
+    out = []
+    while tiles:
+        if len(tiles) > 1 and tiles[0] == tiles[1]:
+            out.append(tiles[0] * 2)
+            tiles = tiles[2:]
+        else:
+            out.append(tiles.pop(0))
+    return out + [0] * (4 - len(out))
+
+
+def shift(board, direction):
+    if direction == "left":
+        return [slide(r) for r in board]
+    if direction == "right":
+        return [slide(r[::-1])[::-1] for r in board]
+    columns = [list(c) for c in zip(*board)]
+    if direction == "up":
+        columns = [slide(c) for c in columns]
+    else:
+        columns = [slide(c[::-1])[::-1] for c in columns]
+    return [list(r) for r in zip(*columns)]
+
+
+class Link:
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            attributes = termios.tcgetattr(self.fd)
+            attributes[4] = attributes[5] = BAUDS[baud]
+            termios.tcsetattr(self.fd, termios.TCSANOW, attributes)
+        self.pending = b""
+        self.dropped = 0
+
+    def send(self, data):
+        os.write(self.fd, data)
+
+    def frame(self, timeout):
+        """Next frame with a good checksum as (flags, board), None on timeout"""
+        deadline = time.monotonic() + timeout
+        while True:
+            while self.pending and (self.pending[0] & SYNC_MASK) != SYNC:
+                self.pending = self.pending[1:]
+                self.dropped += 1
+            if len(self.pending) >= FRAME_SIZE:
+                frame = self.pending[:FRAME_SIZE]
+                if crc8(frame[:-1]) == frame[-1]:
+                    self.pending = self.pending[FRAME_SIZE:]
+                    return frame[0] & ~SYNC_MASK, unpack(frame[1:9])
+                # Not a frame after all, look for the next sync
+                self.pending = self.pending[1:]
+                self.dropped += 1
+                continue
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            if select.select([self.fd], [], [], left)[0]:
+                self.pending += os.read(self.fd, 256)
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("device", help="serial port or pseudo-terminal of the capsule")
+    parser.add_argument("--moves", type=int, default=1000, help="commands to send (default %(default)s)")
+    parser.add_argument("--window", type=int, default=1, help="commands in flight (default %(default)s)")
+    parser.add_argument("--baud", type=int, default=9600, choices=sorted(BAUDS))
+    parser.add_argument("--timeout", type=float, default=2.0, help="seconds to wait for a reply")
+    parser.add_argument("--seed", type=int, help="for the random moves when the board is stuck")
+    args = parser.parse_args()
+    if not 1 <= args.window <= MAX_WINDOW:
+        parser.error("--window must be between 1 and %d" % MAX_WINDOW)
+    rng = random.Random(args.seed)
+
+    link = Link(args.device, args.baud)
+    link.send(bytes([START]))
+    reply = link.frame(args.timeout)
+    if reply is None:
+        sys.exit("drive2048: no reply, is 2048 on screen?")
+    board = reply[1]
+
+    sent = []
+    latencies = []
+    moved = games = largest = 0
+    won = False
+    cycle = 0
+    start = time.monotonic()
+    while len(latencies) < args.moves and not won:
+        while len(sent) < args.window and len(latencies) + len(sent) < args.moves:
+            if args.window == 1:
+                choices = [d for d in PREFERENCE if shift(board, d) != board]
+                direction = choices[0] if choices else rng.choice(PREFERENCE)
+            else:
+                direction = PREFERENCE[cycle % 4]
+                cycle += 1
+            sent.append(time.monotonic())
+            link.send(MOVES[direction])
+        reply = link.frame(args.timeout)
+        if reply is None:
+            sys.exit("drive2048: reply timed out after %d moves" % len(latencies))
+        latencies.append(time.monotonic() - sent.pop(0))
+        flags, board = reply
+        moved += bool(flags & MOVED)
+        games += bool(flags & OVER)
+        won = bool(flags & WON)
+        largest = max(largest, max(max(r) for r in board))
+        if flags & OVER and args.window == 1:
+            # The device has started a new game, see what it looks like
+            link.send(bytes([QUERY]))
+            reply = link.frame(args.timeout)
+            if reply is None:
+                sys.exit("drive2048: no reply to a query")
+            board = reply[1]
+    elapsed = time.monotonic() - start
+    if not won:
+        link.send(bytes([STOP]))
+
+    ms = [l * 1000 for l in latencies]
+    print("%d commands in %.2f s: %.1f moves/s, %d changed the board" % (len(ms), elapsed, len(ms) / elapsed, moved))
+    print("round trip ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f" % (
+        percentile(ms, 0.5), percentile(ms, 0.9), percentile(ms, 0.99), max(ms)))
+    print("games over: %d, largest tile: %d%s" % (games, largest, ", won" if won else ""))
+    if link.dropped:
+        print("bytes dropped while looking for frames: %d" % link.dropped)
+
+
+if __name__ == "__main__":
+    main()
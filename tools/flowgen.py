@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""
+Compiles a flow, the story and menus of the firmware, into the byte code
+and tables util/Flow.c runs from flash. The Makefile runs it on story.flow:
+
+    python3 tools/flowgen.py story.flow story.h
+
+A flow has one instruction per line, # starts a comment and a line ending in
+a backslash carries on on the next one:
+
+    settings TYPE               struct the settings are in, needed by if/set
+    LABEL:                      names the next instruction
+    page STRING                 print, wait for enter, skip a line
+    print STRING
+    prompt STRING SIZE          print, read a line of up to SIZE - 1 characters
+    match STRING LABEL          jump if the line read was STRING
+    jump LABEL
+    if SETTING VALUE LABEL      jump if the SETTING field of the settings is VALUE
+    set SETTING VALUE           change a setting and save the settings
+    call ACTION                 run the C function ACTION
+    end                         return from Flow_run
+
+A STRING is the name of a string in flash, like those in text.h, a macro in
+capitals that expands to a string literal or to PSTR of one, like
+MESSAGE_PASSWORD, or one or more "C string literals" which are joined like
+in C. PSTR can't be used outside a function, so a macro is copied into a
+string in flash of its own with PSTR standing for the literal. The output
+defines NAMEProgram, NAMEStrings and NAMEActions, NAME being the name of the
+output file, for a Flow to be built from.
+"""
+import argparse
+import os
+import re
+import sys
+
+# Opcodes and operand kinds, in the order of the enum in util/Flow.h
+INSTRUCTIONS = {
+    "end": (0, ()),
+    "page": (1, ("string",)),
+    "print": (2, ("string",)),
+    "prompt": (3, ("string", "byte")),
+    "match": (4, ("string", "label")),
+    "jump": (5, ("label",)),
+    "if": (6, ("setting", "byte", "label")),
+    "set": (7, ("setting", "byte")),
+    "call": (8, ("action",)),
+}
+OPCODES = ["FLOW_END", "FLOW_PAGE", "FLOW_PRINT", "FLOW_PROMPT", "FLOW_MATCH", "FLOW_JUMP", "FLOW_IF",
+           "FLOW_SET", "FLOW_CALL"]
+# Targets are one byte
+MAX_PROGRAM = 256
+
+TOKEN = re.compile(r'\s*(?:("(?:[^"\\]|\\.)*")|([^\s"]+))')
+NAME = re.compile(r"[A-Za-z_]\w*$")
+MACRO = re.compile(r"[A-Z_][A-Z0-9_]*$")
+
+
+class FlowError(Exception):
+    pass
+
+
+def tokenize(text):
+    """Splits a line into words and string literals, joining adjacent literals"""
+    tokens = []
+    position = 0
+    text = text.rstrip()
+    while position < len(text):
+        match = TOKEN.match(text, position)
+        if not match or match.end() == position:
+            raise FlowError("can't read %r" % text[position:])
+        position = match.end()
+        if match.group(1):
+            if tokens and tokens[-1].startswith('"'):
+                tokens[-1] = tokens[-1][:-1] + match.group(1)[1:]
+            else:
+                tokens.append(match.group(1))
+        else:
+            tokens.append(match.group(2))
+    return tokens
+
+
+def logical_lines(source):
+    """Lines with the comments removed and the continuations joined, with the number of their first line"""
+    pending, start = "", 0
+    for number, line in enumerate(source.splitlines(), 1):
+        # A # inside a string literal isn't a comment
+        line = re.sub(r'("(?:[^"\\]|\\.)*")|#.*', lambda m: m.group(1) or "", line)
+        if not pending:
+            start = number
+        if line.rstrip().endswith("\\"):
+            pending += line.rstrip()[:-1] + " "
+            continue
+        yield start, pending + line
+        pending = ""
+    if pending:
+        yield start, pending
+
+
+def parse(source):
+    settings_type = None
+    labels = {}
+    instructions = []
+    size = 0
+    for number, line in logical_lines(source):
+        try:
+            tokens = tokenize(line)
+            if not tokens:
+                continue
+            if len(tokens) == 1 and tokens[0].endswith(":") and NAME.match(tokens[0][:-1]):
+                label = tokens[0][:-1]
+                if label in labels:
+                    raise FlowError("label %s is already defined" % label)
+                labels[label] = size
+                continue
+            if tokens[0] == "settings":
+                if len(tokens) != 2 or not NAME.match(tokens[1]):
+                    raise FlowError("settings takes the name of a type")
+                settings_type = tokens[1]
+                continue
+            if tokens[0] not in INSTRUCTIONS:
+                raise FlowError("unknown instruction %s" % tokens[0])
+            opcode, kinds = INSTRUCTIONS[tokens[0]]
+            operands = tokens[1:]
+            if len(operands) != len(kinds):
+                raise FlowError("%s takes %d operands" % (tokens[0], len(kinds)))
+            for kind, operand in zip(kinds, operands):
+                if kind == "string":
+                    if not operand.startswith('"') and not NAME.match(operand):
+                        raise FlowError("%s isn't a string" % operand)
+                elif kind == "byte":
+                    if not operand.isdigit() or int(operand) > 255:
+                        raise FlowError("%s isn't a number from 0 to 255" % operand)
+                elif kind == "setting" and settings_type is None:
+                    raise FlowError("settings have to be declared before %s" % tokens[0])
+                elif not NAME.match(operand):
+                    raise FlowError("%s isn't a name" % operand)
+            instructions.append((number, tokens[0], opcode, list(zip(kinds, operands))))
+            size += 1 + len(kinds)
+        except FlowError as error:
+            raise FlowError("line %d: %s" % (number, error))
+    for label, offset in labels.items():
+        if offset == size:
+            raise FlowError("label %s isn't followed by an instruction" % label)
+    if size > MAX_PROGRAM:
+        raise FlowError("the program is %d bytes, it can't be more than %d" % (size, MAX_PROGRAM))
+    return settings_type, labels, instructions
+
+
+def generate(name, source_name, settings_type, labels, instructions):
+    strings, literals, actions = [], {}, []
+    label_at = {offset: label for label, offset in labels.items()}
+    program = []
+    offset = 0
+    for number, mnemonic, opcode, operands in instructions:
+        values = [OPCODES[opcode]]
+        for kind, operand in operands:
+            if kind == "string":
+                if operand.startswith('"') or MACRO.match(operand):
+                    if operand not in literals:
+                        literals[operand] = "%sText%d" % (name, len(literals))
+                    operand = literals[operand]
+                if operand not in strings:
+                    strings.append(operand)
+                values.append(str(strings.index(operand)))
+            elif kind == "action":
+                if operand not in actions:
+                    actions.append(operand)
+                values.append(str(actions.index(operand)))
+            elif kind == "label":
+                if operand not in labels:
+                    raise FlowError("line %d: label %s isn't defined" % (number, operand))
+                values.append(str(labels[operand]))
+            elif kind == "setting":
+                values.append("offsetof(%s, %s)" % (settings_type, operand))
+            else:
+                values.append(operand)
+        comment = "%3d %s" % (offset, label_at[offset] + ": " if offset in label_at else "")
+        program.append("    /* %s%s */ %s," % (comment, mnemonic, ", ".join(values)))
+        offset += len(values)
+
+    out = ["/*", " * Generated by tools/flowgen.py from %s, don't edit" % source_name, " */"]
+    out.append("#include <stddef.h>")
+    out.append("#include <Flow.h>")
+    out.append("")
+    macros = [literal for literal in literals if not literal.startswith('"')]
+    if macros:
+        out.append('#pragma push_macro("PSTR")')
+        out.append("#undef PSTR")
+        out.append("#define PSTR(s) s")
+    for literal, text_name in literals.items():
+        out.append("static const char %s[] PROGMEM = %s;" % (text_name, literal))
+    if macros:
+        out.append('#pragma pop_macro("PSTR")')
+    out.append("")
+    out.append("static PGM_P const %sStrings[] PROGMEM = {" % name)
+    # An empty initializer isn't C
+    out.extend("    %s," % string for string in strings or ["0"])
+    out.append("};")
+    out.append("")
+    out.append("static const FlowAction %sActions[] PROGMEM = {" % name)
+    out.extend("    %s," % action for action in actions or ["0"])
+    out.append("};")
+    out.append("")
+    out.append("static const uint8_t %sProgram[] PROGMEM = {" % name)
+    out.extend(program)
+    out.append("};")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compiles a flow for util/Flow.c")
+    parser.add_argument("source")
+    parser.add_argument("output")
+    args = parser.parse_args()
+    name = re.sub(r"\W", "_", os.path.splitext(os.path.basename(args.output))[0])
+    try:
+        with open(args.source) as source:
+            settings_type, labels, instructions = parse(source.read())
+        text = generate(name, os.path.basename(args.source), settings_type, labels, instructions)
+    except FlowError as error:
+        print("%s: %s" % (args.source, error), file=sys.stderr)
+        sys.exit(1)
+    with open(args.output, "w") as output:
+        output.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Client for tools/hintd (see tools/HintServer.h for the protocol).
+
+    from hintclient import HintClient
+    with HintClient() as client:
+        hint = client.best(0x1121, deadline=20)
+        print(hint.move, hint.value, client.stats())
+
+Run as a program it asks for hints for the boards given in hex (the layout
+of tools/Bitboard.h), or with --bench keeps the server busy from several
+connections and reports requests per second, round trip latency and the
+server's statistics.
+
+    tools/hintclient.py 0x1121 0x21000012
+    tools/hintclient.py --bench 10000 --clients 4 --window 32 --deadline 10
+"""
+import argparse
+import collections
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+DEFAULT_SOCKET = "/tmp/2048hint.sock"
+MOVE = 0
+STATS = 1
+REQUEST = struct.Struct("=BBHIQ")
+REPLY = struct.Struct("=BBBbIfB3x")
+STATS_FIELDS = ("requests", "cacheHits", "endgameHits", "batches", "batched", "searches", "late",
+                "microseconds", "clients")
+STATS_REPLY = struct.Struct("=8QI4x")
+DIRECTIONS = ("left", "right", "up", "down")
+SOURCES = ("greedy", "search", "endgame")
+
+Hint = collections.namedtuple("Hint", "move value source depth cached")
+
+
+class HintClient:
+    def __init__(self, path=DEFAULT_SOCKET):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        self.buffer = b""
+        self.next_id = 0
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        self.sock.close()
+
+    def _read(self, size):
+        while len(self.buffer) < size:
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("the hint server closed the connection")
+            self.buffer += data
+        data, self.buffer = self.buffer[:size], self.buffer[size:]
+        return data
+
+    def _reply(self):
+        kind, source, depth, move, request_id, value, cached = REPLY.unpack(self._read(REPLY.size))
+        if kind == STATS:
+            return request_id, dict(zip(STATS_FIELDS, STATS_REPLY.unpack(self._read(STATS_REPLY.size))))
+        return request_id, Hint(move, value, source, depth, bool(cached))
+
+    def send(self, board, deadline=0):
+        """Asks for a hint without waiting for it, returns the request id"""
+        self.next_id = (self.next_id + 1) & 0xFFFFFFFF
+        self.sock.sendall(REQUEST.pack(MOVE, 0, deadline, self.next_id, board))
+        return self.next_id
+
+    def receive(self):
+        """The next (id, Hint) to come back"""
+        return self._reply()
+
+    def best_many(self, boards, deadline=0):
+        """Hints for all the boards, asked for at once"""
+        ids = {self.send(board, deadline): i for i, board in enumerate(boards)}
+        hints = [None] * len(boards)
+        for _ in boards:
+            request_id, hint = self.receive()
+            hints[ids[request_id]] = hint
+        return hints
+
+    def best(self, board, deadline=0):
+        """The best move for a board, found within deadline milliseconds"""
+        return self.best_many([board], deadline)[0]
+
+    def stats(self):
+        self.next_id = (self.next_id + 1) & 0xFFFFFFFF
+        self.sock.sendall(REQUEST.pack(STATS, 0, 0, self.next_id, 0))
+        while True:
+            request_id, reply = self.receive()
+            if request_id == self.next_id and isinstance(reply, dict):
+                return reply
+
+
+def random_board(rng):
+    """A board of a few small tiles, not necessarily one a game can reach"""
+    board = 0
+    for cell in rng.sample(range(16), rng.randint(2, 10)):
+        board |= rng.randint(1, 6) << (4 * cell)
+    return board
+
+
+def bench(args):
+    rng = random.Random(args.seed)
+    # A pool smaller than the number of requests, so some come back from the cache
+    pool = [random_board(rng) for _ in range(max(1, args.bench // 4))]
+    latencies = []
+    lock = threading.Lock()
+
+    def run(count, seed):
+        local = random.Random(seed)
+        sent = {}
+        done = []
+        with HintClient(args.socket) as client:
+            for _ in range(min(args.window, count)):
+                sent[client.send(local.choice(pool), args.deadline)] = time.perf_counter()
+            remaining = count - len(sent)
+            while sent:
+                request_id, _ = client.receive()
+                done.append(time.perf_counter() - sent.pop(request_id))
+                if remaining:
+                    sent[client.send(local.choice(pool), args.deadline)] = time.perf_counter()
+                    remaining -= 1
+        with lock:
+            latencies.extend(done)
+
+    share = args.bench // args.clients
+    threads = [threading.Thread(target=run, args=(share, args.seed + i)) for i in range(args.clients)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+    latencies.sort()
+    print("%d requests in %.2f s: %.0f requests/s" % (len(latencies), elapsed, len(latencies) / elapsed))
+    for percentile in (50, 90, 99):
+        print("p%d latency %.2f ms" % (percentile, 1000 * latencies[len(latencies) * percentile // 100 - 1]))
+    with HintClient(args.socket) as client:
+        stats = client.stats()
+    print("server: %d requests, %.1f%% from the cache, %.1f boards per batch, %d searched, %d late" % (
+        stats["requests"], 100.0 * stats["cacheHits"] / max(1, stats["requests"]),
+        stats["batched"] / max(1, stats["batches"]), stats["searches"], stats["late"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Asks tools/hintd for hints")
+    parser.add_argument("boards", nargs="*", help="boards in hex")
+    parser.add_argument("--socket", default=DEFAULT_SOCKET)
+    parser.add_argument("--deadline", type=int, default=50, help="milliseconds per request")
+    parser.add_argument("--bench", type=int, default=0, help="requests to send")
+    parser.add_argument("--clients", type=int, default=1, help="connections for --bench")
+    parser.add_argument("--window", type=int, default=16, help="requests in flight on each connection")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    if args.bench:
+        if args.clients < 1 or args.window < 1 or args.bench < args.clients:
+            parser.error("--bench needs at least one request per client")
+        bench(args)
+        return
+    if not args.boards:
+        parser.error("give some boards or --bench")
+    with HintClient(args.socket) as client:
+        hints = client.best_many([int(board, 16) for board in args.boards], args.deadline)
+        for board, hint in zip(args.boards, hints):
+            move = DIRECTIONS[hint.move] if hint.move >= 0 else "none, the game is over"
+            print("%s: %s, value %.6g, %s depth %d%s" % (board, move, hint.value, SOURCES[hint.source],
+                                                         hint.depth, ", cached" if hint.cached else ""))
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except (ConnectionError, FileNotFoundError) as error:
+        sys.exit("hintclient: %s" % error)
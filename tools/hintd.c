@@ -0,0 +1,101 @@
+/*
+ * Serves hints from one warm solver to every local tool over a Unix domain
+ * socket, see HintServer.h for the protocol and tools/hintclient.py for a
+ * client. Statistics are printed every few seconds while requests come in.
+ * Ctrl-C or SIGTERM stops it and removes the socket.
+ *
+ * Usage: hintd -w weights.ntw [-k book.bin] [-e endgame.bin] [-s socket]
+ *              [-t threads] [-m tableMB] [-c cacheBits] [-d depth] [-q]
+ *
+ * -t 0 answers from the network alone, without a search thread.
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "HintServer.h"
+
+#define DEFAULT_SOCKET "/tmp/2048hint.sock"
+
+static HintServer server;
+static NTuple net;
+static Book book;
+static Endgame endgame;
+
+static void stop(int signal) {
+    HintServer_stop(&server);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s -w weights.ntw [-k book.bin] [-e endgame.bin] [-s socket] [-t threads]\n"
+            "       [-m tableMB] [-c cacheBits] [-d depth] [-q]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL;
+    const char *bookPath = NULL;
+    const char *endgamePath = NULL;
+    const char *path = DEFAULT_SOCKET;
+    HintOptions options = {&net, NULL, NULL, sysconf(_SC_NPROCESSORS_ONLN), 64, 20, 8, stdout};
+    int option;
+    while ((option = getopt(argc, argv, "w:k:e:s:t:m:c:d:q")) != -1) {
+        switch (option) {
+            case 'w': weights = optarg; break;
+            case 'k': bookPath = optarg; break;
+            case 'e': endgamePath = optarg; break;
+            case 's': path = optarg; break;
+            case 't': options.threads = atoi(optarg); break;
+            case 'm': options.tableMB = atoi(optarg); break;
+            case 'c': options.cacheBits = atoi(optarg); break;
+            case 'd': options.maxDepth = atoi(optarg); break;
+            case 'q': options.report = NULL; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!weights || options.threads < 0 || options.threads > SEARCH_MAX_THREADS || options.cacheBits < 1
+            || options.cacheBits > 30 || options.maxDepth < 1 || options.maxDepth > SEARCH_MAX_DEPTH)
+        usage(argv[0]);
+    if (NTuple_load(&net, weights) != 0) {
+        fprintf(stderr, "hintd: can't read the weights in %s\n", weights);
+        return 1;
+    }
+    if (bookPath) {
+        if (Book_open(&book, bookPath) != 0) {
+            fprintf(stderr, "hintd: can't open the book %s\n", bookPath);
+            return 1;
+        }
+        options.book = &book;
+    }
+    if (endgamePath) {
+        if (Endgame_open(&endgame, endgamePath) != 0) {
+            fprintf(stderr, "hintd: can't open the endgame table %s\n", endgamePath);
+            return 1;
+        }
+        options.endgame = &endgame;
+    }
+    Bitboard_setup();
+    if (HintServer_create(&server, path, &options) != 0) {
+        fprintf(stderr, "hintd: can't serve on %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("Serving hints on %s with %d search thread(s)\n", path, options.threads);
+    fflush(stdout);
+    int result = HintServer_run(&server);
+    if (result != 0)
+        fprintf(stderr, "hintd: %s\n", strerror(errno));
+    HintStats *stats = &server.stats;
+    printf("%llu requests, %llu from the cache, %llu from the endgame table, %llu searched, %llu late\n",
+            (unsigned long long) stats -> requests, (unsigned long long) stats -> cacheHits,
+            (unsigned long long) stats -> endgameHits, (unsigned long long) stats -> searches,
+            (unsigned long long) stats -> late);
+    HintServer_free(&server);
+    Endgame_close(&endgame);
+    Book_close(&book);
+    NTuple_free(&net);
+    return result != 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * Builds an opening book (see Book.h): the best move and expected score of
+ * every canonical position reachable from the start of a game with a tile
+ * sum up to a limit.
+ *
+ * Every move keeps the tile sum and every spawn adds 2 or 4 to it, so the
+ * positions fall into layers by tile sum. They are found going forwards
+ * from the opening positions, then valued going backwards: a position is
+ * worth the best over its moves of the score plus the average over the
+ * spawns of the positions they lead to. Positions past the limit are valued
+ * by an N-tuple network from tools/ntrain, one move ahead. Each layer is
+ * split between the threads.
+ *
+ * Usage: mkbook -w weights.ntw [-m maxSum] [-t threads] [-o book.bin]
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "Book.h"
+#include "NTuple.h"
+
+#define MAX_SUM 1024
+#define MAX_THREADS 256
+#define MIN_CAPACITY 4096
+
+typedef struct {
+    Bitboard *boards;
+    size_t count;
+    size_t capacity;
+    // Filled in going backwards
+    float *values;
+    uint8_t *moves;
+} Layer;
+
+typedef struct {
+    pthread_t thread;
+    uint32_t sum;
+    size_t start;
+    size_t end;
+} Slice;
+
+static Layer layers[MAX_SUM + 5];
+static uint32_t maxSum = 32;
+static NTuple net;
+
+static int compareBoards(const void *a, const void *b) {
+    Bitboard x = *(const Bitboard *) a;
+    Bitboard y = *(const Bitboard *) b;
+    return x < y ? -1 : x > y;
+}
+
+static int compareEntries(const void *a, const void *b) {
+    return compareBoards(&((const BookEntry *) a) -> board, &((const BookEntry *) b) -> board);
+}
+
+/**
+ * Sorts a layer and drops the duplicates
+ */
+static void compact(Layer *layer) {
+    if (!layer -> count)
+        return;
+    qsort(layer -> boards, layer -> count, sizeof(Bitboard), compareBoards);
+    size_t unique = 1;
+    for (size_t i = 1; i < layer -> count; i++)
+        if (layer -> boards[i] != layer -> boards[unique - 1])
+            layer -> boards[unique++] = layer -> boards[i];
+    layer -> count = unique;
+}
+
+static void add(uint32_t sum, Bitboard board) {
+    Layer *layer = &layers[sum];
+    if (layer -> count == layer -> capacity) {
+        // Most boards are found many times, try dropping those before growing
+        compact(layer);
+        if (layer -> count >= layer -> capacity / 2) {
+            layer -> capacity = layer -> capacity ? layer -> capacity * 2 : MIN_CAPACITY;
+            layer -> boards = realloc(layer -> boards, layer -> capacity * sizeof(Bitboard));
+            if (!layer -> boards) {
+                fprintf(stderr, "mkbook: out of memory at tile sum %u\n", sum);
+                exit(1);
+            }
+        }
+    }
+    layer -> boards[layer -> count++] = Bitboard_canonical(board);
+}
+
+/**
+ * Every position two spawns can start a game from
+ */
+static void addOpenings(void) {
+    for (uint8_t first = 0; first < 16; first++)
+        for (uint8_t second = first + 1; second < 16; second++)
+            for (uint8_t a = 1; a <= 2; a++)
+                for (uint8_t b = 1; b <= 2; b++) {
+                    uint32_t sum = (1U << a) + (1U << b);
+                    if (sum <= maxSum)
+                        add(sum, ((Bitboard) a << (4 * first)) | ((Bitboard) b << (4 * second)));
+                }
+}
+
+/**
+ * Adds every position one move and spawn away from the layer at sum
+ */
+static void expand(uint32_t sum) {
+    Layer *layer = &layers[sum];
+    for (size_t i = 0; i < layer -> count; i++) {
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(layer -> boards[i], results, scores);
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            if (!(mask & (1 << dir)))
+                continue;
+            for (uint8_t cell = 0; cell < 16; cell++) {
+                if ((results[dir] >> (4 * cell)) & 0x0F)
+                    continue;
+                if (sum + 2 <= maxSum)
+                    add(sum + 2, results[dir] | (1ULL << (4 * cell)));
+                if (sum + 4 <= maxSum)
+                    add(sum + 4, results[dir] | (2ULL << (4 * cell)));
+            }
+        }
+    }
+}
+
+/**
+ * Value of a position with the move to make, past the end of the book it
+ * comes from the network
+ */
+static float value(Bitboard board, uint32_t sum) {
+    if (sum <= maxSum) {
+        Layer *layer = &layers[sum];
+        Bitboard canonical = Bitboard_canonical(board);
+        Bitboard *found = bsearch(&canonical, layer -> boards, layer -> count, sizeof(Bitboard), compareBoards);
+        return layer -> values[found - layer -> boards];
+    }
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    // Game over is worth nothing, otherwise the best move counts even when
+    // the network has it below zero
+    float best = 0;
+    int8_t bestMove = -1;
+    for (uint8_t dir = 0; dir < 4; dir++)
+        if (mask & (1 << dir)) {
+            float v = scores[dir] + NTuple_value(&net, results[dir]);
+            if (bestMove < 0 || v > best) {
+                best = v;
+                bestMove = dir;
+            }
+        }
+    return best;
+}
+
+/**
+ * Best move and its value for part of a layer
+ */
+static void *solve(void *arg) {
+    Slice *slice = arg;
+    Layer *layer = &layers[slice -> sum];
+    for (size_t i = slice -> start; i < slice -> end; i++) {
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(layer -> boards[i], results, scores);
+        float best = 0;
+        int8_t bestMove = -1;
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            if (!(mask & (1 << dir)))
+                continue;
+            float expected = 0;
+            uint8_t empty = 0;
+            for (uint8_t cell = 0; cell < 16; cell++) {
+                if ((results[dir] >> (4 * cell)) & 0x0F)
+                    continue;
+                expected += 0.9f * value(results[dir] | (1ULL << (4 * cell)), slice -> sum + 2);
+                expected += 0.1f * value(results[dir] | (2ULL << (4 * cell)), slice -> sum + 4);
+                empty++;
+            }
+            float v = scores[dir] + expected / empty;
+            if (bestMove < 0 || v > best) {
+                best = v;
+                bestMove = dir;
+            }
+        }
+        // Game over is worth nothing, the move doesn't matter
+        layer -> values[i] = best;
+        layer -> moves[i] = bestMove < 0 ? LEFT : bestMove;
+    }
+    return NULL;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s -w weights.ntw [-m maxSum] [-t threads] [-o book.bin]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL;
+    const char *output = "book.bin";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+    while ((option = getopt(argc, argv, "w:m:t:o:")) != -1) {
+        switch (option) {
+            case 'w': weights = optarg; break;
+            case 'm': maxSum = atoi(optarg); break;
+            case 't': threads = atol(optarg); break;
+            case 'o': output = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!weights || maxSum < 4 || maxSum > MAX_SUM || threads < 1 || threads > MAX_THREADS)
+        usage(argv[0]);
+    if (NTuple_load(&net, weights) != 0) {
+        fprintf(stderr, "mkbook: can't read the weights in %s\n", weights);
+        return 1;
+    }
+    Bitboard_setup();
+
+    addOpenings();
+    uint64_t total = 0;
+    for (uint32_t sum = 4; sum <= maxSum; sum += 2) {
+        compact(&layers[sum]);
+        expand(sum);
+        total += layers[sum].count;
+        printf("tile sum %4u: %10zu positions\n", sum, layers[sum].count);
+        fflush(stdout);
+    }
+
+    Slice slices[MAX_THREADS];
+    for (uint32_t sum = maxSum - maxSum % 2; sum >= 4; sum -= 2) {
+        Layer *layer = &layers[sum];
+        layer -> values = malloc(layer -> count * sizeof(float));
+        layer -> moves = malloc(layer -> count);
+        if (!layer -> values || !layer -> moves) {
+            fprintf(stderr, "mkbook: out of memory at tile sum %u\n", sum);
+            return 1;
+        }
+        size_t share = (layer -> count + threads - 1) / threads;
+        for (long i = 0; i < threads; i++) {
+            slices[i].sum = sum;
+            slices[i].start = i * share < layer -> count ? i * share : layer -> count;
+            slices[i].end = (i + 1) * share < layer -> count ? (i + 1) * share : layer -> count;
+            pthread_create(&slices[i].thread, NULL, solve, &slices[i]);
+        }
+        for (long i = 0; i < threads; i++)
+            pthread_join(slices[i].thread, NULL);
+    }
+
+    BookEntry *entries = calloc(total, sizeof(BookEntry));
+    if (!entries) {
+        fprintf(stderr, "mkbook: out of memory for %llu entries\n", (unsigned long long) total);
+        return 1;
+    }
+    size_t next = 0;
+    for (uint32_t sum = 4; sum <= maxSum; sum += 2)
+        for (size_t i = 0; i < layers[sum].count; i++, next++) {
+            entries[next].board = layers[sum].boards[i];
+            entries[next].value = layers[sum].values[i];
+            entries[next].move = layers[sum].moves[i];
+        }
+    // Layers don't share boards, they only need merging
+    qsort(entries, total, sizeof(BookEntry), compareEntries);
+
+    BookHeader header = {{'2', '0', '4', '8', 'B', 'O', 'O', 'K'}, BOOK_VERSION, maxSum, total, sizeof(BookEntry), 0};
+    FILE *file = fopen(output, "wb");
+    if (!file || fwrite(&header, sizeof header, 1, file) != 1
+            || fwrite(entries, sizeof(BookEntry), total, file) != total || fclose(file) != 0) {
+        fprintf(stderr, "mkbook: can't write %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+    printf("%llu positions written to %s\n", (unsigned long long) total, output);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Builds a table of exact chances of making a goal tile (see Endgame.h)
+ * for every position reachable from some roots, then prints the chance
+ * and best move of each root. The roots are the boards given with -b, in
+ * hex as Bitboard.h lays them out, or every opening position if there are
+ * none. maxSum bounds the tile sum, by default 64 more than the smallest
+ * root's.
+ *
+ * Usage: mkendgame [-g goal] [-m maxSum] [-b board]... [-t threads] [-o endgame.bin]
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "Endgame.h"
+
+#define MAX_ROOTS 256
+#define DEFAULT_WINDOW 64
+
+static const char *const directions[] = {"left", "right", "up", "down"};
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-g goal] [-m maxSum] [-b board]... [-t threads] [-o endgame.bin]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    long goalTile = 2048;
+    long maxSum = 0;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output = "endgame.bin";
+    // Room for every opening
+    Bitboard roots[MAX_ROOTS + 480];
+    size_t count = 0;
+    int option;
+    while ((option = getopt(argc, argv, "g:m:b:t:o:")) != -1) {
+        switch (option) {
+            case 'g': goalTile = atol(optarg); break;
+            case 'm': maxSum = atol(optarg); break;
+            case 'b':
+                if (count == MAX_ROOTS)
+                    usage(argv[0]);
+                roots[count++] = strtoull(optarg, NULL, 16);
+                break;
+            case 't': threads = atol(optarg); break;
+            case 'o': output = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    uint8_t goal = 0;
+    while (goal < 16 && (1L << goal) != goalTile)
+        goal++;
+    if (goal < 2 || goal > 15 || maxSum < 0 || threads < 1 || threads > ENDGAME_MAX_THREADS)
+        usage(argv[0]);
+    Bitboard_setup();
+
+    Boolean openings = count == 0 ? TRUE : FALSE;
+    if (openings)
+        for (uint8_t first = 0; first < 16; first++)
+            for (uint8_t second = first + 1; second < 16; second++)
+                for (uint8_t a = 1; a <= 2; a++)
+                    for (uint8_t b = 1; b <= 2; b++)
+                        roots[count++] = ((Bitboard) a << (4 * first)) | ((Bitboard) b << (4 * second));
+    uint32_t minSum = UINT32_MAX;
+    for (size_t i = 0; i < count; i++)
+        if (Bitboard_tileSum(roots[i]) < minSum)
+            minSum = Bitboard_tileSum(roots[i]);
+    if (!maxSum)
+        maxSum = minSum + DEFAULT_WINDOW;
+
+    printf("Chances of making %ld from %zu root(s) up to a tile sum of %ld on %ld thread(s)\n", goalTile, count,
+            maxSum, threads);
+    double start = now();
+    if (Endgame_build(output, roots, count, goal, maxSum, threads, stdout) != 0) {
+        fprintf(stderr, "mkendgame: can't build %s: %s\n", output,
+                errno == EINVAL ? "a root has the goal tile, an odd tile sum or one over maxSum" : strerror(errno));
+        return 1;
+    }
+    double elapsed = now() - start;
+    Endgame table;
+    if (Endgame_open(&table, output) != 0) {
+        fprintf(stderr, "mkendgame: can't read back %s\n", output);
+        return 1;
+    }
+    printf("%llu positions in %.1f s, %.0f positions/s, written to %s\n", (unsigned long long) table.count,
+            elapsed, table.count / elapsed, output);
+    if (openings) {
+        // The game starts from each opening as often as the spawns make it
+        double total = 0, weight = 0;
+        for (size_t i = 0; i < count; i++) {
+            double probability, chance = 1;
+            for (Bitboard board = roots[i]; board; board >>= 4)
+                chance *= (board & 0x0F) == 1 ? 0.9 : (board & 0x0F) == 2 ? 0.1 : 1;
+            Endgame_lookup(&table, roots[i], NULL, &probability);
+            total += chance * probability;
+            weight += chance;
+        }
+        printf("chance from the start of a game: %.9f\n", total / weight);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            Direction move;
+            double probability;
+            Endgame_lookup(&table, roots[i], &move, &probability);
+            printf("%016llx: %.9f, %s\n", (unsigned long long) roots[i], probability, directions[move]);
+        }
+    }
+    Endgame_close(&table);
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Trains an N-tuple network (see NTuple.h) to value 2048 boards by self play
+ * on the Board rules, with TD(0) learning on afterstates: every move picks
+ * the direction with the best score plus value of the board it leaves, then
+ * pulls the value of the previous afterstate towards that.
+ *
+ * All the threads play their own games and update one shared set of weights
+ * without any locking (Hogwild), which costs the odd lost update but scales
+ * with the number of cores. Progress, including the training rate in moves
+ * per second, is printed every second.
+ *
+ * Usage: ntrain [-n small|large] [-t threads] [-g games] [-s seconds]
+ *               [-a alpha] [-r seed] [-o weights.ntw] [-q 8|16]
+ *               [-x trimmed.ntw|trimmed.h] [-b base]
+ *
+ * -o saves the whole network, -x a trimmed copy for the capsule with only
+ * the 4 cell tuples and exponents up to base - 1 (8 by default, so 128 and
+ * anything bigger share weights), as a weight file or a C header. The small
+ * network trims to two 4096 byte tables.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "NTuple.h"
+
+#define MAX_THREADS 256
+#define TRIM_SIZE 4
+#define TRIM_BASE 8
+#define WON_EXPONENT 11
+
+static const char *const smallTuples[] = {"0123", "4567"};
+static const char *const largeTuples[] = {"012345", "456789", "012456", "45689a"};
+
+// Counters of one thread, on a cache line of their own
+typedef struct {
+    pthread_t thread;
+    uint64_t random;
+    uint64_t moves;
+    uint64_t games;
+    uint64_t won;
+    uint64_t score;
+} __attribute__((aligned(64))) Worker;
+
+static NTuple net;
+static float step;
+static int64_t gamesLeft;
+static volatile int stop = 0;
+
+static uint64_t load(uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static void add(uint64_t *counter, uint64_t amount) {
+    __atomic_store_n(counter, *counter + amount, __ATOMIC_RELAXED);
+}
+
+/**
+ * The best move by score plus value of the afterstate, -1 if there is none
+ */
+static int8_t bestMove(Bitboard board, Bitboard *after, uint32_t *score) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    int8_t best = -1;
+    float bestValue = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + NTuple_value(&net, results[dir]);
+        if (best < 0 || value > bestValue) {
+            best = dir;
+            bestValue = value;
+        }
+    }
+    if (best >= 0) {
+        *after = results[best];
+        *score = scores[best];
+    }
+    return best;
+}
+
+/**
+ * Plays one game, learning as it goes
+ */
+static void playGame(Worker *worker) {
+    Bitboard board = Bitboard_spawnRandom(Bitboard_spawnRandom(0, &worker -> random), &worker -> random);
+    Bitboard previous = 0;
+    Boolean started = FALSE;
+    uint32_t total = 0;
+    uint64_t moves = 0;
+    for (;;) {
+        Bitboard after;
+        uint32_t score;
+        if (bestMove(board, &after, &score) < 0)
+            break;
+        if (started) {
+            float error = score + NTuple_value(&net, after) - NTuple_value(&net, previous);
+            NTuple_update(&net, previous, step * error);
+        }
+        previous = after;
+        started = TRUE;
+        total += score;
+        moves++;
+        board = Bitboard_spawnRandom(after, &worker -> random);
+    }
+    // Nothing follows the last afterstate
+    if (started)
+        NTuple_update(&net, previous, -step * NTuple_value(&net, previous));
+    add(&worker -> moves, moves);
+    add(&worker -> score, total);
+    add(&worker -> won, Bitboard_maxExponent(board) >= WON_EXPONENT);
+    add(&worker -> games, 1);
+}
+
+static void *train(void *arg) {
+    Worker *worker = arg;
+    while (!stop && __atomic_sub_fetch(&gamesLeft, 1, __ATOMIC_RELAXED) >= 0)
+        playGame(worker);
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n small|large] [-t threads] [-g games] [-s seconds] [-a alpha]\n"
+            "       [-r seed] [-o weights.ntw] [-q 8|16] [-x trimmed.ntw|trimmed.h] [-b base]\n", name);
+    exit(1);
+}
+
+static Boolean endsWith(const char *string, const char *end) {
+    size_t length = strlen(string);
+    return length >= strlen(end) && strcmp(string + length - strlen(end), end) == 0 ? TRUE : FALSE;
+}
+
+int main(int argc, char *argv[]) {
+    const char *network = "small";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long long games = 100000;
+    double seconds = 0;
+    double alpha = 0.1;
+    unsigned long long seed = 1;
+    const char *output = NULL;
+    const char *trimOutput = NULL;
+    int bits = 16;
+    int trimBase = TRIM_BASE;
+    int option;
+    while ((option = getopt(argc, argv, "n:t:g:s:a:r:o:q:x:b:")) != -1) {
+        switch (option) {
+            case 'n': network = optarg; break;
+            case 't': threads = atol(optarg); break;
+            case 'g': games = atoll(optarg); break;
+            case 's': seconds = atof(optarg); break;
+            case 'a': alpha = atof(optarg); break;
+            case 'r': seed = strtoull(optarg, NULL, 0); break;
+            case 'o': output = optarg; break;
+            case 'q': bits = atoi(optarg); break;
+            case 'x': trimOutput = optarg; break;
+            case 'b': trimBase = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (threads < 1 || threads > MAX_THREADS || games < 1 || (bits != 8 && bits != 16)
+            || trimBase < 2 || trimBase > NTUPLE_BASE)
+        usage(argv[0]);
+
+    int created;
+    if (strcmp(network, "small") == 0)
+        created = NTuple_create(&net, smallTuples, 2, NTUPLE_BASE);
+    else if (strcmp(network, "large") == 0)
+        created = NTuple_create(&net, largeTuples, 4, NTUPLE_BASE);
+    else
+        usage(argv[0]);
+    if (created != 0) {
+        fprintf(stderr, "ntrain: not enough memory for the %s network\n", network);
+        return 1;
+    }
+    // alpha is spread over every weight that makes up a value
+    step = alpha / (8 * net.count);
+    gamesLeft = games;
+    Bitboard_setup();
+
+    Worker *workers;
+    if (posix_memalign((void **) &workers, 64, threads * sizeof(Worker)) != 0) {
+        fprintf(stderr, "ntrain: not enough memory for %ld threads\n", threads);
+        return 1;
+    }
+    memset(workers, 0, threads * sizeof(Worker));
+    printf("Training the %s network on %ld thread(s)\n", network, threads);
+    double start = now();
+    for (long i = 0; i < threads; i++) {
+        // Distinct and never 0
+        workers[i].random = (seed + i) * 0x9E3779B97F4A7C15ULL | 1;
+        pthread_create(&workers[i].thread, NULL, train, &workers[i]);
+    }
+
+    uint64_t lastMoves = 0, lastGames = 0, lastScore = 0, lastWon = 0;
+    double last = start;
+    for (;;) {
+        sleep(1);
+        uint64_t moves = 0, played = 0, score = 0, won = 0;
+        for (long i = 0; i < threads; i++) {
+            moves += load(&workers[i].moves);
+            played += load(&workers[i].games);
+            score += load(&workers[i].score);
+            won += load(&workers[i].won);
+        }
+        double time = now();
+        uint64_t windowGames = played - lastGames;
+        printf("%8.0f s %10llu games %10.0f moves/s  mean score %8.0f  2048 %5.1f%%\n",
+                time - start, (unsigned long long) played, (moves - lastMoves) / (time - last),
+                windowGames ? (double) (score - lastScore) / windowGames : 0,
+                windowGames ? 100.0 * (won - lastWon) / windowGames : 0);
+        fflush(stdout);
+        lastMoves = moves, lastGames = played, lastScore = score, lastWon = won;
+        last = time;
+        if (played >= (uint64_t) games)
+            break;
+        if (seconds > 0 && time - start >= seconds) {
+            stop = 1;
+            break;
+        }
+    }
+    for (long i = 0; i < threads; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    uint64_t moves = 0;
+    for (long i = 0; i < threads; i++)
+        moves += workers[i].moves;
+    double elapsed = now() - start;
+    printf("%llu moves in %.1f s, %.0f moves/s\n", (unsigned long long) moves, elapsed, moves / elapsed);
+
+    if (output && NTuple_save(&net, output, bits) != 0) {
+        fprintf(stderr, "ntrain: can't write %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+    if (trimOutput) {
+        NTuple trimmed;
+        if (NTuple_trim(&net, &trimmed, TRIM_SIZE, trimBase) != 0) {
+            fprintf(stderr, "ntrain: no tuples of %d cells or fewer to trim to\n", TRIM_SIZE);
+            return 1;
+        }
+        int saved = endsWith(trimOutput, ".h") ? NTuple_saveHeader(&trimmed, trimOutput, "ntuple")
+                : NTuple_save(&trimmed, trimOutput, 8);
+        if (saved != 0) {
+            fprintf(stderr, "ntrain: can't write %s: %s\n", trimOutput, strerror(errno));
+            return 1;
+        }
+        NTuple_free(&trimmed);
+    }
+    NTuple_free(&net);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Measures how the search in Search.h speeds up with more threads. The
+ * same positions, taken from games played by the network, are searched to
+ * a fixed depth with 1, 2, 4... threads, starting from an empty table each
+ * time, and the time is compared to one thread.
+ *
+ * Usage: searchbench -w weights.ntw [-d depth] [-p positions] [-t threads]
+ *                    [-m tableMB] [-H] [-r seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "NTuple.h"
+#include "Search.h"
+
+#define MAX_POSITIONS 1000
+// Positions are taken every this many moves
+#define POSITION_MOVES 37
+
+static NTuple net;
+
+/**
+ * Greedy play with the network, for the positions to search
+ */
+static uint32_t findPositions(Bitboard *positions, uint32_t count, uint64_t seed) {
+    uint64_t random = seed * 0x9E3779B97F4A7C15ULL | 1;
+    uint32_t found = 0;
+    uint32_t moves = 0;
+    Bitboard board = Bitboard_spawnRandom(Bitboard_spawnRandom(0, &random), &random);
+    while (found < count) {
+        Bitboard results[4];
+        uint32_t scores[4];
+        uint8_t mask = Bitboard_moves(board, results, scores);
+        if (!mask) {
+            board = Bitboard_spawnRandom(Bitboard_spawnRandom(0, &random), &random);
+            continue;
+        }
+        if (++moves % POSITION_MOVES == 0)
+            positions[found++] = board;
+        int8_t best = -1;
+        float bestValue = 0;
+        for (uint8_t dir = 0; dir < 4; dir++) {
+            if (!(mask & (1 << dir)))
+                continue;
+            float value = scores[dir] + NTuple_value(&net, results[dir]);
+            if (best < 0 || value > bestValue) {
+                best = dir;
+                bestValue = value;
+            }
+        }
+        board = Bitboard_spawnRandom(results[best], &random);
+    }
+    return found;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s -w weights.ntw [-d depth] [-p positions] [-t threads] [-m tableMB] [-H] [-r seed]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL;
+    int depth = 4;
+    int count = 20;
+    long maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned tableMB = 256;
+    Boolean hugePages = FALSE;
+    unsigned long long seed = 1;
+    int option;
+    while ((option = getopt(argc, argv, "w:d:p:t:m:Hr:")) != -1) {
+        switch (option) {
+            case 'w': weights = optarg; break;
+            case 'd': depth = atoi(optarg); break;
+            case 'p': count = atoi(optarg); break;
+            case 't': maxThreads = atol(optarg); break;
+            case 'm': tableMB = atoi(optarg); break;
+            case 'H': hugePages = TRUE; break;
+            case 'r': seed = strtoull(optarg, NULL, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!weights || depth < 1 || depth > SEARCH_MAX_DEPTH || count < 1 || count > MAX_POSITIONS
+            || maxThreads < 1 || maxThreads > SEARCH_MAX_THREADS)
+        usage(argv[0]);
+    if (NTuple_load(&net, weights) != 0) {
+        fprintf(stderr, "searchbench: can't read the weights in %s\n", weights);
+        return 1;
+    }
+    Bitboard_setup();
+
+    static Bitboard positions[MAX_POSITIONS];
+    static int8_t firstMoves[MAX_POSITIONS];
+    findPositions(positions, count, seed);
+
+    printf("%d positions searched %d moves deep\n", count, depth);
+    printf("threads   seconds   Mnodes/s   speedup   same move\n");
+    double oneThread = 0;
+    // Powers of two, then all of them
+    for (long threads = 1; ; threads = threads * 2 > maxThreads ? maxThreads : threads * 2) {
+        Search search;
+        if (Search_create(&search, &net, NULL, tableMB, hugePages, threads) != 0) {
+            fprintf(stderr, "searchbench: can't set up a search with %ld threads\n", threads);
+            return 1;
+        }
+        if (threads == 1)
+            printf("(%zu MB table%s)\n", search.length >> 20, search.hugePages ? " on huge pages" : "");
+        double seconds = 0;
+        uint64_t nodes = 0;
+        int same = 0;
+        for (int i = 0; i < count; i++) {
+            Search_clear(&search);
+            SearchResult result = Search_best(&search, positions[i], 0, depth);
+            seconds += result.seconds;
+            nodes += result.nodes;
+            if (threads == 1)
+                firstMoves[i] = result.move;
+            same += result.move == firstMoves[i];
+        }
+        Search_free(&search);
+        if (threads == 1)
+            oneThread = seconds;
+        printf("%7ld %9.3f %10.2f %9.2f %8d/%d\n", threads, seconds, nodes / seconds / 1e6, oneThread / seconds,
+                same, count);
+        fflush(stdout);
+        if (threads == maxThreads)
+            break;
+    }
+    NTuple_free(&net);
+    return 0;
+}
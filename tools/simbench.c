@@ -0,0 +1,164 @@
+/*
+ * Runs a benchmark firmware image headless in simavr and prints the exact
+ * number of CPU cycles each measured operation took.
+ *
+ * The firmware names a measurement by writing it to GPIOR2 one character at
+ * a time and brackets it with BENCH_START and BENCH_STOP written to GPIOR0,
+ * see tests/BenchFirmware.c. Cycles spent asleep, waiting on the UART or the
+ * ADC, are left out so the numbers are the work the CPU actually did,
+ * interrupt handlers included. The first measurement is expected to be empty
+ * and is subtracted from the rest as the cost of the markers.
+ *
+ * Usage: simbench firmware.elf [mcu] [frequency]
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_uart.h>
+
+// Data space addresses on the ATmega328P
+#define GPIOR0_ADDR 0x3E
+#define GPIOR2_ADDR 0x4B
+
+#define BENCH_START 1
+#define BENCH_STOP 2
+#define BENCH_DONE 0xFF
+
+#define MAX_NAME 32
+#define MAX_RESULTS 64
+// Give up after a minute of simulated time
+#define MAX_SECONDS 60
+
+typedef struct {
+    char name[MAX_NAME];
+    uint32_t calls;
+    uint64_t min;
+    uint64_t max;
+    uint64_t total;
+} Result;
+
+static Result results[MAX_RESULTS];
+static int resultCount = 0;
+
+static char name[MAX_NAME];
+static int nameLength = 0;
+static avr_cycle_count_t asleep = 0;
+static avr_cycle_count_t startCycle;
+static avr_cycle_count_t startAsleep;
+static int running = 0;
+static int done = 0;
+
+static uint64_t overhead = 0;
+static int calibrated = 0;
+
+static void record(uint64_t cycles) {
+    if (!calibrated) {
+        overhead = cycles;
+        calibrated = 1;
+        return;
+    }
+    cycles = cycles > overhead ? cycles - overhead : 0;
+    Result *result = NULL;
+    for (int i = 0; i < resultCount; i++)
+        if (strcmp(results[i].name, name) == 0)
+            result = &results[i];
+    if (!result) {
+        if (resultCount == MAX_RESULTS) {
+            fprintf(stderr, "simbench: too many measurements\n");
+            exit(1);
+        }
+        result = &results[resultCount++];
+        strcpy(result->name, name);
+        result->min = UINT64_MAX;
+    }
+    result->calls++;
+    result->total += cycles;
+    if (cycles < result->min)
+        result->min = cycles;
+    if (cycles > result->max)
+        result->max = cycles;
+}
+
+static void nameWrite(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+    if (nameLength < MAX_NAME - 1)
+        name[nameLength++] = v;
+}
+
+static void markerWrite(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+    if (v == BENCH_START) {
+        name[nameLength] = '\0';
+        startCycle = avr->cycle;
+        startAsleep = asleep;
+        running = 1;
+    } else if (v == BENCH_STOP && running) {
+        record((avr->cycle - startCycle) - (asleep - startAsleep));
+        running = 0;
+        nameLength = 0;
+    } else if (v == BENCH_DONE) {
+        done = 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s firmware.elf [mcu] [frequency]\n", argv[0]);
+        return 1;
+    }
+    const char *mcu = argc > 2 ? argv[2] : "atmega328p";
+    uint32_t frequency = argc > 3 ? strtoul(argv[3], NULL, 0) : 8000000;
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof firmware);
+    if (elf_read_firmware(argv[1], &firmware) != 0) {
+        fprintf(stderr, "simbench: can't read %s\n", argv[1]);
+        return 1;
+    }
+    avr_t *avr = avr_make_mcu_by_name(mcu);
+    if (!avr) {
+        fprintf(stderr, "simbench: unknown mcu %s\n", mcu);
+        return 1;
+    }
+    avr_init(avr);
+    avr->frequency = frequency;
+    avr->log = LOG_ERROR;
+    avr_load_firmware(avr, &firmware);
+
+    // Keep the firmware's UART output out of the report
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~(AVR_UART_FLAG_STDIO | AVR_UART_FLAG_POLL_SLEEP);
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+    avr_register_io_write(avr, GPIOR0_ADDR, markerWrite, NULL);
+    avr_register_io_write(avr, GPIOR2_ADDR, nameWrite, NULL);
+
+    int state = cpu_Running;
+    while (!done && state != cpu_Done && state != cpu_Crashed) {
+        avr_cycle_count_t before = avr->cycle;
+        int sleeping = avr->state == cpu_Sleeping;
+        state = avr_run(avr);
+        if (sleeping)
+            asleep += avr->cycle - before;
+        if (avr->cycle > (avr_cycle_count_t) frequency * MAX_SECONDS) {
+            fprintf(stderr, "simbench: firmware didn't finish in %d s\n", MAX_SECONDS);
+            return 1;
+        }
+    }
+    if (!done) {
+        fprintf(stderr, "simbench: firmware stopped before finishing\n");
+        return 1;
+    }
+
+    printf("%-24s %6s %10s %10s %10s\n", "cycles", "calls", "min", "mean", "max");
+    for (int i = 0; i < resultCount; i++) {
+        Result *r = &results[i];
+        printf("%-24s %6" PRIu32 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+            r->name, r->calls, r->min, r->total / r->calls, r->max);
+    }
+    printf("(%" PRIu64 " cycles of marker overhead subtracted, %" PRIu32 " Hz)\n", overhead, frequency);
+    return 0;
+}
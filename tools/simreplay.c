@@ -0,0 +1,481 @@
+/*
+ * Replays recorded sessions against the firmware headless in simavr and
+ * checks what they cost against a baseline, so a change that makes the
+ * firmware slower, chattier or deeper in stack fails the run.
+ *
+ * A recording is made by running main_native with HAL_RECORD=path, see
+ * hal/linux/HAL.h. It holds the EEPROM at startup, the ADC samples the seed
+ * of the random number generator was made from and every input byte with
+ * the milliseconds until it was read:
+ *
+ *     eeprom 0x000 01 00 ff ...       16 bytes from an address, erased if left out
+ *     adc 517                         the next conversion result
+ *     rx 1520 0x0d                    an input byte and when it was read
+ *
+ * A byte is handed to the UART once its time has come, the one before it
+ * has been read and the CPU is asleep, which is when main_native reads input
+ * too, so the firmware sees the same bytes in the same states every run and
+ * the counts are exact. The replay ends a while after the last byte once the
+ * CPU is asleep again, or when the firmware powers down.
+ *
+ * For each recording it measures
+ *     cycles      cycles the CPU was awake, interrupt handlers included
+ *     keyMean     awake cycles from one input byte to the next, on average,
+ *                 leaving out the clock tick interrupt
+ *     keyMax      and at most
+ *     uartBytes   bytes the firmware sent
+ *     stackPeak   deepest the stack pointer went below the end of RAM
+ *
+ * and compares them with the baseline, lines of a recording's file name
+ * without the extension, a metric, its value and how many percent above it
+ * is still a pass:
+ *
+ *     session cycles 18231422 2
+ *
+ * The ticks come at the same rate however long the player took over a key,
+ * so counting them would make the key metrics follow the recorded think time
+ * rather than the work the key caused.
+ *
+ * -u writes the measurements to the baseline instead, keeping the tolerances.
+ * A baseline without any numbers yet checks nothing, it prints the
+ * measurements and exits with SKIPPED_EXIT instead of passing.
+ *
+ * Usage: simreplay [-b baseline] [-u] [-m mcu] [-f frequency] firmware.elf recording...
+ */
+#include <inttypes.h>
+#include <libgen.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_adc.h>
+#include <simavr/avr_eeprom.h>
+#include <simavr/avr_uart.h>
+
+// Data space address on the ATmega328P
+#define ADMUX_ADDR 0x7C
+// Byte address of the TIMER0_COMPA vector, the tick of util/Clock.c
+#define TIMER0_COMPA_VECTOR 0x38
+#define EEPROM_SIZE 1024
+// Volts at the reference pins, in millivolts
+#define REFERENCE_MV 5000
+// How long the firmware is left to finish after the last byte
+#define SETTLE_MS 500
+// A byte that is never read is given up on after this long
+#define RX_TIMEOUT_MS 100
+// Give up a minute of simulated time after the last byte
+#define MAX_SECONDS 60
+#define MAX_NAME 64
+#define MAX_BASELINE 256
+// Exit status when there was nothing to check against, as automake has it
+#define SKIPPED_EXIT 77
+
+enum { CYCLES, KEY_MEAN, KEY_MAX, UART_BYTES, STACK_PEAK, METRICS };
+static const char *metricNames[METRICS] = {"cycles", "keyMean", "keyMax", "uartBytes", "stackPeak"};
+// Percent above the baseline that still passes, for new entries
+static const double defaultTolerances[METRICS] = {2, 2, 5, 0, 0};
+
+typedef struct {
+    uint32_t ms;
+    uint8_t byte;
+} Input;
+
+typedef struct {
+    char name[MAX_NAME];
+    uint8_t eeprom[EEPROM_SIZE];
+    uint16_t *adc;
+    size_t adcCount;
+    Input *inputs;
+    size_t inputCount;
+} Recording;
+
+typedef struct {
+    char name[MAX_NAME];
+    int metric;
+    uint64_t value;
+    double tolerance;
+} Expected;
+
+typedef struct {
+    avr_t *avr;
+    const Recording *recording;
+    size_t adcNext;
+    size_t inputNext;
+    int rxDrained;
+    avr_cycle_count_t sentAt;
+    avr_cycle_count_t asleep;
+    avr_cycle_count_t keyStart;
+    // Cycles in the clock tick interrupt so far, and the stack pointer it
+    // returns to while one is running
+    avr_cycle_count_t tick;
+    int inTick;
+    uint16_t tickSp;
+    // Bytes from whose delivery the cycles up to the next one were counted
+    size_t keys;
+    uint64_t keyTotal;
+    uint64_t keyMax;
+    uint64_t uartBytes;
+    uint16_t minSp;
+} Replay;
+
+static Expected baseline[MAX_BASELINE];
+static int baselineCount = 0;
+
+static void fail(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "simreplay: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+static void *grow(void *items, size_t count, size_t size) {
+    // Doubles at every power of two
+    if (count & (count - 1))
+        return items;
+    items = realloc(items, (count ? 2 * count : 16) * size);
+    if (!items)
+        fail("out of memory");
+    return items;
+}
+
+static void readRecording(const char *path, Recording *recording) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        fail("can't read %s", path);
+    memset(recording, 0, sizeof *recording);
+    memset(recording->eeprom, 0xFF, sizeof recording->eeprom);
+    char copy[256];
+    snprintf(copy, sizeof copy, "%s", path);
+    snprintf(recording->name, sizeof recording->name, "%s", basename(copy));
+    char *dot = strrchr(recording->name, '.');
+    if (dot && dot != recording->name)
+        *dot = '\0';
+
+    char line[256];
+    long number = 0;
+    while (fgets(line, sizeof line, file)) {
+        number++;
+        char kind[16];
+        int used;
+        if (sscanf(line, " %15s%n", kind, &used) != 1 || kind[0] == '#')
+            continue;
+        const char *rest = line + used;
+        unsigned address, value, ms;
+        if (strcmp(kind, "eeprom") == 0) {
+            if (sscanf(rest, "%x%n", &address, &used) != 1)
+                fail("%s:%ld: eeprom needs an address", path, number);
+            rest += used;
+            while (sscanf(rest, "%x%n", &value, &used) == 1) {
+                if (address >= EEPROM_SIZE || value > 0xFF)
+                    fail("%s:%ld: eeprom byte out of range", path, number);
+                recording->eeprom[address++] = value;
+                rest += used;
+            }
+        } else if (strcmp(kind, "adc") == 0) {
+            if (sscanf(rest, "%u", &value) != 1 || value > 0x3FF)
+                fail("%s:%ld: adc needs a result from 0 to 1023", path, number);
+            recording->adc = grow(recording->adc, recording->adcCount, sizeof *recording->adc);
+            recording->adc[recording->adcCount++] = value;
+        } else if (strcmp(kind, "rx") == 0) {
+            if (sscanf(rest, "%u %x", &ms, &value) != 2 || value > 0xFF)
+                fail("%s:%ld: rx needs a time and a byte", path, number);
+            recording->inputs = grow(recording->inputs, recording->inputCount, sizeof *recording->inputs);
+            recording->inputs[recording->inputCount++] = (Input) {ms, value};
+        } else {
+            fail("%s:%ld: unknown line", path, number);
+        }
+    }
+    fclose(file);
+}
+
+static void readBaseline(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return;
+    char line[256];
+    long number = 0;
+    while (fgets(line, sizeof line, file)) {
+        number++;
+        char name[MAX_NAME], metric[16];
+        uint64_t value;
+        double tolerance;
+        int fields = sscanf(line, " %63s %15s %" SCNu64 " %lf", name, metric, &value, &tolerance);
+        if (fields <= 0 || name[0] == '#')
+            continue;
+        int m = 0;
+        while (m < METRICS && strcmp(metricNames[m], metric) != 0)
+            m++;
+        if (fields != 4 || m == METRICS)
+            fail("%s:%ld: expected a recording, a metric, a value and a tolerance", path, number);
+        if (baselineCount == MAX_BASELINE)
+            fail("%s:%ld: too many entries", path, number);
+        Expected *e = &baseline[baselineCount++];
+        snprintf(e->name, sizeof e->name, "%s", name);
+        e->metric = m;
+        e->value = value;
+        e->tolerance = tolerance;
+    }
+    fclose(file);
+}
+
+static Expected *findExpected(const char *name, int metric) {
+    for (int i = 0; i < baselineCount; i++)
+        if (baseline[i].metric == metric && strcmp(baseline[i].name, name) == 0)
+            return &baseline[i];
+    return NULL;
+}
+
+static void writeBaseline(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file)
+        fail("can't write %s", path);
+    fprintf(file, "# Written by tools/simreplay -u, see there for the format\n");
+    fprintf(file, "# recording metric value tolerance(%%)\n");
+    for (int i = 0; i < baselineCount; i++)
+        fprintf(file, "%s %s %" PRIu64 " %g\n", baseline[i].name, metricNames[baseline[i].metric],
+            baseline[i].value, baseline[i].tolerance);
+    if (fclose(file) != 0)
+        fail("can't write %s", path);
+}
+
+/**
+ * simavr samples the input when the result is read, this sets it to the
+ * voltage that converts to the next recorded result just before
+ */
+static void adcTrigger(struct avr_irq_t *irq, uint32_t value, void *param) {
+    Replay *replay = param;
+    union {
+        avr_adc_mux_t mux;
+        uint32_t v;
+    } e = {.v = value};
+    if (e.mux.kind != ADC_MUX_SINGLE)
+        return;
+    uint16_t result = 0;
+    if (replay->adcNext < replay->recording->adcCount)
+        result = replay->recording->adc[replay->adcNext++];
+    else if (replay->adcNext++ == replay->recording->adcCount)
+        fprintf(stderr, "simreplay: %s: ran out of ADC samples, reading 0\n", replay->recording->name);
+    uint32_t reference;
+    switch (replay->avr->data[ADMUX_ADDR] >> 6) {
+        case 0: reference = replay->avr->aref; break;
+        case 1: reference = replay->avr->avcc; break;
+        default: reference = 1100; break;
+    }
+    // The smallest voltage that converts to result
+    uint32_t mv = (result * reference + 0x3FE) / 0x3FF;
+    avr_raise_irq(avr_io_getirq(replay->avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + e.mux.src), mv);
+}
+
+static void uartOutput(struct avr_irq_t *irq, uint32_t value, void *param) {
+    ((Replay *) param)->uartBytes++;
+}
+
+// Raised once the firmware has read everything recieved
+static void uartXon(struct avr_irq_t *irq, uint32_t value, void *param) {
+    ((Replay *) param)->rxDrained = 1;
+}
+
+// Awake cycles outside the clock tick interrupt
+static avr_cycle_count_t keyCycles(const Replay *replay) {
+    return replay->avr->cycle - replay->asleep - replay->tick;
+}
+
+static void endKey(Replay *replay) {
+    avr_cycle_count_t awake = keyCycles(replay);
+    uint64_t cycles = awake - replay->keyStart;
+    replay->keys++;
+    replay->keyTotal += cycles;
+    if (cycles > replay->keyMax)
+        replay->keyMax = cycles;
+    replay->keyStart = awake;
+}
+
+/**
+ * Runs one recording from reset and fills in its measurements
+ */
+static void replay(elf_firmware_t *firmware, const char *mcu, uint32_t frequency, const Recording *recording,
+        uint64_t measured[METRICS]) {
+    Replay r;
+    memset(&r, 0, sizeof r);
+    r.recording = recording;
+    r.rxDrained = 1;
+    avr_t *avr = r.avr = avr_make_mcu_by_name(mcu);
+    if (!avr)
+        fail("unknown mcu %s", mcu);
+    avr_init(avr);
+    avr->frequency = frequency;
+    avr->log = LOG_ERROR;
+    avr->vcc = avr->avcc = avr->aref = REFERENCE_MV;
+    avr_load_firmware(avr, firmware);
+
+    avr_eeprom_desc_t eeprom = {.ee = (uint8_t *) recording->eeprom, .offset = 0, .size = EEPROM_SIZE};
+    avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &eeprom);
+
+    // Keep the firmware's UART output out of the report
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~(AVR_UART_FLAG_STDIO | AVR_UART_FLAG_POLL_SLEEP);
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_t *rx = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOutput, &r);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUT_XON), uartXon, &r);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_OUT_TRIGGER), adcTrigger, &r);
+
+    avr_cycle_count_t perMs = frequency / 1000;
+    uint32_t lastMs = recording->inputCount ? recording->inputs[recording->inputCount - 1].ms : 0;
+    avr_cycle_count_t limit = (avr_cycle_count_t) perMs * lastMs + (avr_cycle_count_t) frequency * MAX_SECONDS;
+    r.minSp = avr->ramend;
+    int state = cpu_Running;
+    for (;;) {
+        if (avr->state == cpu_Sleeping) {
+            if (r.inputNext < recording->inputCount) {
+                const Input *next = &recording->inputs[r.inputNext];
+                if (!r.rxDrained && avr->cycle - r.sentAt > perMs * RX_TIMEOUT_MS) {
+                    fprintf(stderr, "simreplay: %s: byte %zu wasn't read\n", recording->name, r.inputNext);
+                    r.rxDrained = 1;
+                }
+                if (r.rxDrained && avr->cycle >= perMs * next->ms) {
+                    if (r.inputNext > 0)
+                        endKey(&r);
+                    else
+                        r.keyStart = keyCycles(&r);
+                    r.rxDrained = 0;
+                    r.sentAt = avr->cycle;
+                    r.inputNext++;
+                    avr_raise_irq(rx, next->byte);
+                }
+            } else if (avr->cycle - r.sentAt > perMs * SETTLE_MS) {
+                break;
+            }
+        }
+        uint16_t sp = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+        // Taken with the return address already pushed, over once it's popped
+        if (!r.inTick && avr->pc == TIMER0_COMPA_VECTOR) {
+            r.inTick = 1;
+            r.tickSp = sp;
+        }
+        avr_cycle_count_t before = avr->cycle;
+        int sleeping = avr->state == cpu_Sleeping;
+        state = avr_run(avr);
+        if (sleeping)
+            r.asleep += avr->cycle - before;
+        else if (r.inTick)
+            r.tick += avr->cycle - before;
+        sp = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+        if (r.inTick && sp > r.tickSp)
+            r.inTick = 0;
+        if (sp && sp < r.minSp)
+            r.minSp = sp;
+        // Sleeping with interrupts off, the firmware has powered down
+        if (state == cpu_Done)
+            break;
+        if (state == cpu_Crashed)
+            fail("%s: the firmware crashed", recording->name);
+        if (avr->cycle > limit)
+            fail("%s: the firmware didn't finish in %d s after the last byte", recording->name, MAX_SECONDS);
+    }
+    if (r.inputNext < recording->inputCount)
+        fprintf(stderr, "simreplay: %s: the firmware stopped with %zu bytes left\n", recording->name,
+            recording->inputCount - r.inputNext);
+    if (r.inputNext > 0)
+        endKey(&r);
+
+    measured[CYCLES] = avr->cycle - r.asleep;
+    measured[KEY_MEAN] = r.keys ? r.keyTotal / r.keys : 0;
+    measured[KEY_MAX] = r.keyMax;
+    measured[UART_BYTES] = r.uartBytes;
+    measured[STACK_PEAK] = avr->ramend - r.minSp;
+    avr_terminate(avr);
+}
+
+int main(int argc, char *argv[]) {
+    const char *baselinePath = "tests/replay/baseline.txt";
+    const char *mcu = "atmega328p";
+    uint32_t frequency = 8000000;
+    int update = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:um:f:")) != -1) {
+        switch (opt) {
+            case 'b': baselinePath = optarg; break;
+            case 'u': update = 1; break;
+            case 'm': mcu = optarg; break;
+            case 'f': frequency = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-b baseline] [-u] [-m mcu] [-f frequency] firmware.elf recording...\n",
+                    argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "usage: %s [-b baseline] [-u] [-m mcu] [-f frequency] firmware.elf recording...\n", argv[0]);
+        return 1;
+    }
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof firmware);
+    if (elf_read_firmware(argv[optind], &firmware) != 0)
+        fail("can't read %s", argv[optind]);
+    readBaseline(baselinePath);
+    int unchecked = baselineCount == 0 && !update;
+
+    int failures = 0;
+    printf("%-16s %-10s %12s %12s %8s\n", "recording", "metric", "baseline", "measured", "change");
+    for (int i = optind + 1; i < argc; i++) {
+        Recording recording;
+        readRecording(argv[i], &recording);
+        uint64_t measured[METRICS];
+        replay(&firmware, mcu, frequency, &recording, measured);
+        for (int m = 0; m < METRICS; m++) {
+            Expected *e = findExpected(recording.name, m);
+            if (update) {
+                if (!e) {
+                    if (baselineCount == MAX_BASELINE)
+                        fail("too many baseline entries");
+                    e = &baseline[baselineCount++];
+                    snprintf(e->name, sizeof e->name, "%s", recording.name);
+                    e->metric = m;
+                    e->tolerance = defaultTolerances[m];
+                }
+                e->value = measured[m];
+            }
+            if (!e) {
+                printf("%-16s %-10s %12s %12" PRIu64 "%s\n", recording.name, metricNames[m], "-", measured[m],
+                    unchecked ? "" : "           FAIL, not in the baseline");
+                failures += !unchecked;
+                continue;
+            }
+            double change = e->value ? 100.0 * ((double) measured[m] - e->value) / e->value : (measured[m] ? 100 : 0);
+            int over = measured[m] > e->value * (1 + e->tolerance / 100);
+            printf("%-16s %-10s %12" PRIu64 " %12" PRIu64 " %+7.2f%%", recording.name, metricNames[m],
+                e->value, measured[m], change);
+            if (over) {
+                printf("  FAIL, +%g%% allowed", e->tolerance);
+                failures++;
+            }
+            printf("\n");
+        }
+        free(recording.adc);
+        free(recording.inputs);
+    }
+    if (update) {
+        writeBaseline(baselinePath);
+        printf("Baseline written to %s\n", baselinePath);
+        return 0;
+    }
+    if (unchecked) {
+        printf("SKIPPED, nothing checked as %s has no numbers yet. Run make replay-baseline\n"
+            "with simavr installed and commit it to check against these.\n", baselinePath);
+        return SKIPPED_EXIT;
+    }
+    if (failures) {
+        printf("%d measurement%s over the baseline in %s\n", failures, failures == 1 ? "" : "s", baselinePath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Plays games on all cores with a trained N-tuple network (tools/ntrain) and
+ * reports how well it does and how fast. With an opening book (tools/mkbook)
+ * every position is looked up in the book first, the network only picks the
+ * moves for positions the book doesn't have.
+ *
+ * Usage: simulate -w weights.ntw [-k book.bin] [-g games] [-t threads] [-r seed]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "Book.h"
+#include "NTuple.h"
+
+#define MAX_THREADS 256
+#define WON_EXPONENT 11
+
+typedef struct {
+    pthread_t thread;
+    uint64_t random;
+    uint64_t moves;
+    uint64_t bookMoves;
+    uint64_t games;
+    uint64_t won;
+    uint64_t score;
+} __attribute__((aligned(64))) Worker;
+
+static NTuple net;
+static Book book;
+static int64_t gamesLeft;
+
+/**
+ * The book's move if it has the position, otherwise the network's
+ */
+static int8_t chooseMove(Bitboard board, Worker *worker) {
+    Bitboard results[4];
+    uint32_t scores[4];
+    uint8_t mask = Bitboard_moves(board, results, scores);
+    if (!mask)
+        return -1;
+    Direction move;
+    if (Book_lookup(&book, board, &move, NULL)) {
+        worker -> bookMoves++;
+        return move;
+    }
+    int8_t best = -1;
+    float bestValue = 0;
+    for (uint8_t dir = 0; dir < 4; dir++) {
+        if (!(mask & (1 << dir)))
+            continue;
+        float value = scores[dir] + NTuple_value(&net, results[dir]);
+        if (best < 0 || value > bestValue) {
+            best = dir;
+            bestValue = value;
+        }
+    }
+    return best;
+}
+
+static void *play(void *arg) {
+    Worker *worker = arg;
+    while (__atomic_sub_fetch(&gamesLeft, 1, __ATOMIC_RELAXED) >= 0) {
+        Bitboard board = Bitboard_spawnRandom(Bitboard_spawnRandom(0, &worker -> random), &worker -> random);
+        int8_t move;
+        while ((move = chooseMove(board, worker)) >= 0) {
+            uint32_t score = 0;
+            board = Bitboard_spawnRandom(Bitboard_shift(board, move, &score), &worker -> random);
+            worker -> score += score;
+            worker -> moves++;
+        }
+        worker -> won += Bitboard_maxExponent(board) >= WON_EXPONENT;
+        worker -> games++;
+    }
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s -w weights.ntw [-k book.bin] [-g games] [-t threads] [-r seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL;
+    const char *bookPath = NULL;
+    long long games = 1000;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long seed = 1;
+    int option;
+    while ((option = getopt(argc, argv, "w:k:g:t:r:")) != -1) {
+        switch (option) {
+            case 'w': weights = optarg; break;
+            case 'k': bookPath = optarg; break;
+            case 'g': games = atoll(optarg); break;
+            case 't': threads = atol(optarg); break;
+            case 'r': seed = strtoull(optarg, NULL, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!weights || games < 1 || threads < 1 || threads > MAX_THREADS)
+        usage(argv[0]);
+    if (NTuple_load(&net, weights) != 0) {
+        fprintf(stderr, "simulate: can't read the weights in %s\n", weights);
+        return 1;
+    }
+    if (bookPath && Book_open(&book, bookPath) != 0) {
+        fprintf(stderr, "simulate: can't open the book %s\n", bookPath);
+        return 1;
+    }
+    Bitboard_setup();
+    gamesLeft = games;
+
+    Worker *workers;
+    if (posix_memalign((void **) &workers, 64, threads * sizeof(Worker)) != 0) {
+        fprintf(stderr, "simulate: not enough memory for %ld threads\n", threads);
+        return 1;
+    }
+    memset(workers, 0, threads * sizeof(Worker));
+    double start = now();
+    for (long i = 0; i < threads; i++) {
+        workers[i].random = (seed + i) * 0x9E3779B97F4A7C15ULL | 1;
+        pthread_create(&workers[i].thread, NULL, play, &workers[i]);
+    }
+    uint64_t moves = 0, bookMoves = 0, played = 0, won = 0, score = 0;
+    for (long i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        moves += workers[i].moves;
+        bookMoves += workers[i].bookMoves;
+        played += workers[i].games;
+        won += workers[i].won;
+        score += workers[i].score;
+    }
+    double elapsed = now() - start;
+
+    printf("%llu games in %.2f s: %.0f games/s, %.0f moves/s\n", (unsigned long long) played, elapsed,
+            played / elapsed, moves / elapsed);
+    printf("mean score %.0f, 2048 reached in %.1f%%\n", (double) score / played, 100.0 * won / played);
+    if (bookPath)
+        printf("book moves: %llu of %llu (%.2f%%), %llu positions in the book\n",
+                (unsigned long long) bookMoves, (unsigned long long) moves,
+                100.0 * bookMoves / moves, (unsigned long long) book.count);
+    Book_close(&book);
+    NTuple_free(&net);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+Prints the stack frame of every function from the .su files that gcc writes
+with -fstack-usage, largest first, next to the RAM use measured on the
+device. Run it through 'make stack', reading the measurements off the debug
+menu:
+
+    make stack PEAK=412 STATIC=389
+
+PEAK is the "Stack ... peak" and STATIC the "static" figure from the menu.
+"""
+import argparse
+import sys
+
+RAM = 2048
+
+
+def read_su(paths):
+    frames = []
+    for path in paths:
+        try:
+            with open(path) as su:
+                for line in su:
+                    # file:line:column:function<TAB>bytes<TAB>qualifiers
+                    location, size, qualifiers = line.rstrip("\n").split("\t")
+                    source, _, _, function = location.rsplit(":", 3)
+                    frames.append((int(size), function, source, qualifiers))
+        except FileNotFoundError:
+            print("stack_usage: no %s, was it built with -fstack-usage?" % path, file=sys.stderr)
+            sys.exit(1)
+    return sorted(frames, reverse=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--peak", type=int, help="deepest stack measured on the device")
+    parser.add_argument("--static", type=int, help="static RAM reported on the device")
+    parser.add_argument("--ram", type=int, default=RAM, help="bytes of RAM (default %(default)s)")
+    parser.add_argument("su", nargs="+", help=".su files")
+    args = parser.parse_args()
+
+    frames = read_su(args.su)
+    print("%6s  %-10s %-24s %s" % ("bytes", "kind", "function", "file"))
+    for size, function, source, qualifiers in frames:
+        print("%6d  %-10s %-24s %s" % (size, qualifiers, function, source))
+
+    # Anything but "static" can't be bounded at compile time
+    unbounded = [f for f in frames if f[3] != "static"]
+    if unbounded:
+        print("\n%d frame(s) are dynamic or bounded, the measured peak is the only bound" % len(unbounded))
+
+    if args.peak is not None:
+        print("\nMeasured stack peak: %d bytes" % args.peak)
+        if args.static is not None:
+            headroom = args.ram - args.static - args.peak
+            print("Static RAM: %d bytes, headroom left: %d bytes" % (args.static, headroom))
+            if frames and headroom < frames[0][0]:
+                print("Warning: less headroom than the largest single frame (%s)" % frames[0][1])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Decodes a trace dump from firmware built with 'make TRACE=1' (see
+util/Trace.h) into Chrome trace JSON, which chrome://tracing and Perfetto
+open, or into a plain text timeline.
+
+The input is anything with the dump in it: a capture of the serial output,
+or the serial port or pseudo-terminal itself, in which case it waits for the
+next dump (press 't' in 2048).
+
+    tools/trace_decode.py capture.bin -o trace.json
+    tools/trace_decode.py /dev/ttyUSB0 --text
+"""
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+import termios
+import tty
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "util", "Trace.h")
+MAGIC = b"TRC"
+VERSION = 1
+RECORD = struct.Struct("<BHBH")
+TICK_US = 8
+TICKS_PER_MS = 125
+BAUD = termios.B9600
+# Events from the board engine share a track, so spans nest
+BOARD = ("shift", "game", "put")
+
+
+def event_names(header):
+    """The TraceEvent names, in order, from Trace.h"""
+    with open(header) as source:
+        text = source.read()
+    body = re.search(r"typedef enum \{(.*?)\} TraceEvent;", text, re.S).group(1)
+    return [name.lower() for name in re.findall(r"^\s*TRACE_(\w+)", body, re.M)]
+
+
+def read_dump(stream):
+    """Reads up to the end of the first dump, returns its records"""
+    window = b""
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            sys.exit("trace_decode: no trace dump found")
+        window = (window + byte)[-len(MAGIC):]
+        if window == MAGIC:
+            break
+    version, size = stream.read(2)
+    if version != VERSION:
+        sys.exit("trace_decode: dump version %d, expected %d" % (version, VERSION))
+    data = b""
+    while len(data) < size * RECORD.size:
+        more = stream.read(size * RECORD.size - len(data))
+        if not more:
+            sys.exit("trace_decode: dump cut short")
+        data += more
+    return [RECORD.unpack_from(data, i * RECORD.size) for i in range(size)]
+
+
+def timeline(records, names):
+    """Turns records into (microseconds, name, payload), oldest first"""
+    events = []
+    wraps = 0
+    last = None
+    for event, millis, count, payload in records:
+        if event == 0:
+            continue
+        if last is not None and millis < last:
+            wraps += 1
+        last = millis
+        ms = millis + (wraps << 16)
+        ticks = count & 0x7F
+        # A compare match was pending, the millisecond count was one behind
+        if count & 0x80 and ticks < TICKS_PER_MS - 1:
+            ms += 1
+        name = names[event] if event < len(names) else "event_%d" % event
+        events.append((ms * 1000 + ticks * TICK_US, name, payload))
+    if events:
+        start = events[0][0]
+        events = [(time - start, name, payload) for time, name, payload in events]
+    return events
+
+
+def chrome_trace(events):
+    tracks = {}
+    trace = []
+    for time, name, payload in events:
+        category = name.split("_")[0]
+        if category in BOARD:
+            category = "board"
+        tid = tracks.setdefault(category, len(tracks) + 1)
+        if name.endswith("_begin"):
+            phase, name = "B", name[:-len("_begin")]
+        elif name.endswith("_end"):
+            phase, name = "E", name[:-len("_end")]
+        else:
+            phase = "i"
+        record = {"name": name, "ph": phase, "ts": time, "pid": 1, "tid": tid,
+                  "args": {"payload": payload}}
+        if phase == "i":
+            record["s"] = "t"
+        trace.append(record)
+    for category, tid in tracks.items():
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                      "args": {"name": category}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def open_input(path):
+    if path == "-":
+        return sys.stdin.buffer
+    stream = open(path, "rb", buffering=0)
+    if stream.isatty():
+        tty.setraw(stream.fileno())
+        attributes = termios.tcgetattr(stream.fileno())
+        attributes[4] = attributes[5] = BAUD
+        termios.tcsetattr(stream.fileno(), termios.TCSANOW, attributes)
+    return stream
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("input", help="capture file, serial port or - for stdin")
+    parser.add_argument("-o", "--output", help="write here instead of stdout")
+    parser.add_argument("--text", action="store_true", help="print a text timeline instead of JSON")
+    parser.add_argument("--header", default=HEADER, help="Trace.h to take event names from")
+    args = parser.parse_args()
+
+    names = event_names(args.header)
+    events = timeline(read_dump(open_input(args.input)), names)
+    output = open(args.output, "w") if args.output else sys.stdout
+    if args.text:
+        for time, name, payload in events:
+            output.write("%10.3f ms  %-16s %d\n" % (time / 1000.0, name, payload))
+    else:
+        json.dump(chrome_trace(events), output, indent=1)
+        output.write("\n")
+
+
+if __name__ == "__main__":
+    main()
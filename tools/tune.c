@@ -0,0 +1,388 @@
+/*
+ * Tunes the weights of the heuristic in Heuristic.h with CMA-ES: every
+ * generation samples a population of weight vectors from a multivariate
+ * normal distribution, plays each of them on the same set of games, and
+ * moves the distribution towards the ones that scored best, adapting its
+ * step size and covariance as it goes.
+ *
+ * The games are spread over all cores. Within a generation every candidate
+ * plays the same seeds (common random numbers), so the differences between
+ * them come from the weights rather than from luckier tiles, and each
+ * generation has seeds of its own so the weights don't fit one set of
+ * games. One line per generation goes to stdout and, with -l, a CSV log,
+ * including the evaluation rate in games per second. At the end the mean of
+ * the distribution is played on seeds it hasn't seen and written with -o.
+ *
+ * Usage: tune [-g games] [-G generations] [-p population] [-t threads]
+ *             [-s seconds] [-S sigma] [-i start.txt] [-r seed]
+ *             [-o weights.txt] [-l log.csv]
+ */
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Bitboard.h"
+#include "Heuristic.h"
+
+#define MAX_THREADS 256
+#define MAX_POPULATION 64
+#define N HEURISTIC_FEATURES
+// Stops once the steps get this small
+#define TOLERANCE 1e-4
+#define JACOBI_SWEEPS 50
+// Generation whose seeds are kept for the final evaluation
+#define VALIDATION UINT32_MAX
+
+typedef struct {
+    pthread_t thread;
+    uint64_t games;
+    uint64_t moves;
+} __attribute__((aligned(64))) Worker;
+
+// The evaluation the workers share
+static struct {
+    float weights[MAX_POPULATION][N];
+    uint64_t score[MAX_POPULATION];
+    uint32_t candidates;
+    uint32_t generation;
+    uint64_t tasks;
+    uint64_t next;
+} batch;
+static uint64_t baseSeed;
+
+/**
+ * Seed of a game, the same for every candidate of a generation
+ */
+static uint64_t gameSeed(uint32_t generation, uint64_t game) {
+    // splitmix64
+    uint64_t x = baseSeed + ((uint64_t) generation << 40) + game * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return (x ^ (x >> 31)) | 1;
+}
+
+static void *evaluate(void *arg) {
+    Worker *worker = arg;
+    uint64_t task;
+    // Candidates take turns, so they all finish together
+    while ((task = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED)) < batch.tasks) {
+        uint32_t candidate = task % batch.candidates;
+        uint32_t moves;
+        uint32_t score = Heuristic_play(batch.weights[candidate], gameSeed(batch.generation, task / batch.candidates),
+                &moves);
+        __atomic_add_fetch(&batch.score[candidate], score, __ATOMIC_RELAXED);
+        worker -> games++;
+        worker -> moves += moves;
+    }
+    return NULL;
+}
+
+/**
+ * Plays games games with each of the candidates in batch.weights on all
+ * threads, leaving the total scores in batch.score
+ */
+static void evaluateBatch(Worker *workers, long threads, uint32_t candidates, uint32_t generation,
+        uint64_t games) {
+    batch.candidates = candidates;
+    batch.generation = generation;
+    batch.tasks = candidates * games;
+    batch.next = 0;
+    memset(batch.score, 0, sizeof batch.score);
+    for (long i = 0; i < threads; i++)
+        pthread_create(&workers[i].thread, NULL, evaluate, &workers[i]);
+    for (long i = 0; i < threads; i++)
+        pthread_join(workers[i].thread, NULL);
+}
+
+/**
+ * Eigenvalues and eigenvectors (the columns of vectors) of the symmetric
+ * matrix a, by Jacobi rotations
+ */
+static void eigen(const double a[N][N], double values[N], double vectors[N][N]) {
+    double m[N][N];
+    memcpy(m, a, sizeof m);
+    for (int i = 0; i < N; i++)
+        for (int j = 0; j < N; j++)
+            vectors[i][j] = i == j;
+    for (int sweep = 0; sweep < JACOBI_SWEEPS; sweep++) {
+        double off = 0;
+        for (int p = 0; p < N; p++)
+            for (int q = p + 1; q < N; q++)
+                off += m[p][q] * m[p][q];
+        if (off < 1e-30)
+            break;
+        for (int p = 0; p < N; p++) {
+            for (int q = p + 1; q < N; q++) {
+                if (fabs(m[p][q]) < 1e-300)
+                    continue;
+                double theta = (m[q][q] - m[p][p]) / (2 * m[p][q]);
+                double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                double c = 1 / sqrt(t * t + 1), s = t * c;
+                for (int k = 0; k < N; k++) {
+                    double kp = m[k][p], kq = m[k][q];
+                    m[k][p] = c * kp - s * kq;
+                    m[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < N; k++) {
+                    double pk = m[p][k], qk = m[q][k];
+                    m[p][k] = c * pk - s * qk;
+                    m[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < N; k++) {
+                    double kp = vectors[k][p], kq = vectors[k][q];
+                    vectors[k][p] = c * kp - s * kq;
+                    vectors[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < N; i++)
+        values[i] = m[i][i];
+}
+
+/**
+ * A standard normal random number, by Box-Muller
+ */
+static double gaussian(uint64_t *state) {
+    double u = (Bitboard_random(state) + 1.0) / 4294967297.0;
+    double v = Bitboard_random(state) / 4294967296.0;
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-g games] [-G generations] [-p population] [-t threads] [-s seconds]\n"
+            "       [-S sigma] [-i start.txt] [-r seed] [-o weights.txt] [-l log.csv]\n", name);
+    exit(1);
+}
+
+/**
+ * Candidate numbers from the best fitness to the worst
+ */
+static void rank(const double fitness[], int count, int order[]) {
+    for (int k = 0; k < count; k++) {
+        int i = k;
+        for (; i > 0 && fitness[order[i - 1]] < fitness[k]; i--)
+            order[i] = order[i - 1];
+        order[i] = k;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long long games = 200;
+    long generations = 100;
+    int population = 4 + (int) (3 * log(N));
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    double seconds = 0;
+    double sigma = 2;
+    const char *start = NULL;
+    unsigned long long seed = 1;
+    const char *output = NULL;
+    const char *logPath = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "g:G:p:t:s:S:i:r:o:l:")) != -1) {
+        switch (option) {
+            case 'g': games = atoll(optarg); break;
+            case 'G': generations = atol(optarg); break;
+            case 'p': population = atoi(optarg); break;
+            case 't': threads = atol(optarg); break;
+            case 's': seconds = atof(optarg); break;
+            case 'S': sigma = atof(optarg); break;
+            case 'i': start = optarg; break;
+            case 'r': seed = strtoull(optarg, NULL, 0); break;
+            case 'o': output = optarg; break;
+            case 'l': logPath = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (games < 1 || generations < 1 || population < 4 || population > MAX_POPULATION || threads < 1
+            || threads > MAX_THREADS || !(sigma > 0))
+        usage(argv[0]);
+    double mean[N];
+    float weights[N];
+    memcpy(weights, Heuristic_defaults, sizeof weights);
+    if (start && Heuristic_load(weights, start) != 0) {
+        fprintf(stderr, "tune: can't read the weights in %s\n", start);
+        return 1;
+    }
+    for (int i = 0; i < N; i++)
+        mean[i] = weights[i];
+    FILE *logFile = NULL;
+    if (logPath) {
+        logFile = fopen(logPath, "w");
+        if (!logFile) {
+            fprintf(stderr, "tune: can't write %s: %s\n", logPath, strerror(errno));
+            return 1;
+        }
+        fprintf(logFile, "generation,games,seconds,games_per_s,sigma,best,median,worst");
+        for (int i = 0; i < N; i++)
+            fprintf(logFile, ",%s", Heuristic_names[i]);
+        fprintf(logFile, "\n");
+    }
+    Bitboard_setup();
+    Heuristic_setup();
+    baseSeed = seed * 0x9E3779B97F4A7C15ULL;
+    uint64_t random = seed * 0xD1B54A32D192ED03ULL | 1;
+
+    Worker *workers;
+    if (posix_memalign((void **) &workers, 64, threads * sizeof(Worker)) != 0) {
+        fprintf(stderr, "tune: not enough memory for %ld threads\n", threads);
+        return 1;
+    }
+    memset(workers, 0, threads * sizeof(Worker));
+
+    // Strategy parameters, as in Hansen's CMA-ES tutorial
+    int mu = population / 2;
+    double recombination[MAX_POPULATION / 2];
+    double sum = 0, sumSquares = 0;
+    for (int i = 0; i < mu; i++) {
+        recombination[i] = log(mu + 0.5) - log(i + 1);
+        sum += recombination[i];
+    }
+    for (int i = 0; i < mu; i++) {
+        recombination[i] /= sum;
+        sumSquares += recombination[i] * recombination[i];
+    }
+    double mueff = 1 / sumSquares;
+    double cc = (4 + mueff / N) / (N + 4 + 2 * mueff / N);
+    double cs = (mueff + 2) / (N + mueff + 5);
+    double c1 = 2 / ((N + 1.3) * (N + 1.3) + mueff);
+    double cmu = fmin(1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((N + 2) * (N + 2) + mueff));
+    double damps = 1 + 2 * fmax(0, sqrt((mueff - 1) / (N + 1)) - 1) + cs;
+    double chiN = sqrt(N) * (1 - 1.0 / (4 * N) + 1.0 / (21 * N * N));
+
+    double pc[N] = {0}, ps[N] = {0};
+    double C[N][N], B[N][N], D[N], invSqrtC[N][N];
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++)
+            C[i][j] = B[i][j] = invSqrtC[i][j] = i == j;
+        D[i] = 1;
+    }
+
+    printf("Tuning %d weights, %d candidates of %lld games per generation on %ld thread(s)\n", N, population,
+            games, threads);
+    double x[MAX_POPULATION][N], fitness[MAX_POPULATION];
+    int order[MAX_POPULATION];
+    double begin = now();
+    uint64_t totalGames = 0;
+    long generation;
+    for (generation = 0; generation < generations; generation++) {
+        for (int k = 0; k < population; k++) {
+            double z[N];
+            for (int i = 0; i < N; i++)
+                z[i] = D[i] * gaussian(&random);
+            for (int i = 0; i < N; i++) {
+                double y = 0;
+                for (int j = 0; j < N; j++)
+                    y += B[i][j] * z[j];
+                x[k][i] = mean[i] + sigma * y;
+                batch.weights[k][i] = x[k][i];
+            }
+        }
+        double started = now();
+        evaluateBatch(workers, threads, population, generation, games);
+        double elapsed = now() - started;
+        totalGames += population * games;
+        for (int k = 0; k < population; k++)
+            fitness[k] = (double) batch.score[k] / games;
+        rank(fitness, population, order);
+
+        double old[N], step[N];
+        for (int i = 0; i < N; i++) {
+            old[i] = mean[i];
+            mean[i] = 0;
+            for (int k = 0; k < mu; k++)
+                mean[i] += recombination[k] * x[order[k]][i];
+            step[i] = (mean[i] - old[i]) / sigma;
+        }
+        double psNorm = 0;
+        for (int i = 0; i < N; i++) {
+            double whitened = 0;
+            for (int j = 0; j < N; j++)
+                whitened += invSqrtC[i][j] * step[j];
+            ps[i] = (1 - cs) * ps[i] + sqrt(cs * (2 - cs) * mueff) * whitened;
+            psNorm += ps[i] * ps[i];
+        }
+        psNorm = sqrt(psNorm);
+        int hsig = psNorm / sqrt(1 - pow(1 - cs, 2 * (generation + 1))) / chiN < 1.4 + 2.0 / (N + 1);
+        for (int i = 0; i < N; i++)
+            pc[i] = (1 - cc) * pc[i] + hsig * sqrt(cc * (2 - cc) * mueff) * step[i];
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                double rankMu = 0;
+                for (int k = 0; k < mu; k++)
+                    rankMu += recombination[k] * (x[order[k]][i] - old[i]) * (x[order[k]][j] - old[j]);
+                C[i][j] = (1 - c1 - cmu) * C[i][j] + c1 * (pc[i] * pc[j] + (1 - hsig) * cc * (2 - cc) * C[i][j])
+                        + cmu * rankMu / (sigma * sigma);
+            }
+        }
+        sigma *= exp(cs / damps * (psNorm / chiN - 1));
+        eigen(C, D, B);
+        double maxD = 0;
+        for (int i = 0; i < N; i++) {
+            D[i] = sqrt(fmax(D[i], 1e-20));
+            maxD = fmax(maxD, D[i]);
+        }
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                invSqrtC[i][j] = 0;
+                for (int k = 0; k < N; k++)
+                    invSqrtC[i][j] += B[i][k] / D[k] * B[j][k];
+            }
+        }
+
+        double best = fitness[order[0]], median = fitness[order[population / 2]];
+        double worst = fitness[order[population - 1]];
+        printf("%4ld %8.1f s %8.0f games/s  sigma %8.4f  best %8.0f  median %8.0f  mean", generation,
+                now() - begin, population * games / elapsed, sigma, best, median);
+        for (int i = 0; i < N; i++)
+            printf(" %.3f", mean[i]);
+        printf("\n");
+        fflush(stdout);
+        if (logFile) {
+            fprintf(logFile, "%ld,%llu,%.3f,%.1f,%.6g,%.1f,%.1f,%.1f", generation,
+                    (unsigned long long) totalGames, now() - begin, population * games / elapsed, sigma, best,
+                    median, worst);
+            for (int i = 0; i < N; i++)
+                fprintf(logFile, ",%.6g", mean[i]);
+            fprintf(logFile, "\n");
+            fflush(logFile);
+        }
+        if (sigma * maxD < TOLERANCE || (seconds > 0 && now() - begin >= seconds)) {
+            generation++;
+            break;
+        }
+    }
+
+    // The mean on games none of the generations played
+    for (int i = 0; i < N; i++)
+        weights[i] = batch.weights[0][i] = mean[i];
+    evaluateBatch(workers, threads, 1, VALIDATION, games);
+    totalGames += games;
+    double elapsed = now() - begin;
+    uint64_t moves = 0;
+    for (long i = 0; i < threads; i++)
+        moves += workers[i].moves;
+    printf("%ld generations, %llu games in %.1f s: %.0f games/s, %.0f moves/s\n", generation,
+            (unsigned long long) totalGames, elapsed, totalGames / elapsed, moves / elapsed);
+    printf("mean score of the tuned weights on %lld new games: %.0f\n", games, (double) batch.score[0] / games);
+    for (int i = 0; i < N; i++)
+        printf("%s %.9g\n", Heuristic_names[i], weights[i]);
+    if (logFile)
+        fclose(logFile);
+    if (output && Heuristic_save(weights, output) != 0) {
+        fprintf(stderr, "tune: can't write %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+    free(workers);
+    return 0;
+}
@@ -1,17 +1,35 @@
+#include <HAL.h>
 #include <ADC.h>
+#include <Power.h>
+#include <Trace.h>
+
+/**
+ * The conversion complete interrupt only exists to wake the CPU up,
+ * the flag is cleared by running the handler
+ */
+#ifdef TRACE_ENABLE
+HAL_ISR (ADC) {
+    TRACE(TRACE_ADC_END, HAL_adcResult());
+}
+#else
+HAL_EMPTY_ISR (ADC);
+#endif
 
 /**
  * Sets up ADC 
  */
 void ADC_setup(void) {
-    ADCSRA |= (1 << ADPS2) | (1 << ADPS1) | (0 << ADPS0); //set prescaler to 64
-    ADCSRA |= (1 << ADEN); //Enable ADC 
+    HAL_adcSetup(); //Prescaler of 64, interrupt on conversion complete
 }
 
 uint16_t ADC_read(void) {
-    ADCSRA |= (1 << ADSC);  //Start a new conversion;
-    while (ADCSRA & (1<<ADSC)){} //Wait until ADC conversion complete
-    uint16_t retVal = ADCL; //Record the results
-    retVal |= ADCH << 8;
-    return retVal;
+    HAL_disableInterrupts();
+    TRACE(TRACE_ADC_BEGIN, 0);
+    HAL_adcStart();  //Start a new conversion;
+    while (HAL_adcBusy()) { //Sleep until ADC conversion complete
+        Power_idle();
+        HAL_disableInterrupts();
+    }
+    HAL_enableInterrupts();
+    return HAL_adcResult();
 }
@@ -1,6 +1,6 @@
 #ifndef ADC_H
 #define ADC_H
-#include <avr/io.h>
+#include <stdint.h>
 
 /*
  * Implementation of APIs that allow users to interact
@@ -14,7 +14,8 @@
 void ADC_setup(void);
 
 /*
- * Reads the ADC data register and return the result
+ * Starts a conversion, sleeps until it completes and
+ * returns the result
  */
 uint16_t ADC_read(void);
 #endif
@@ -1,4 +1,5 @@
 #include "Board.h"
+#include "Trace.h"
 
 Board Board_newBlankBoard(void) {
     Board newBoard;
@@ -43,6 +44,7 @@ void Board_putRandom(Board *board, uint32_t randomNum, Boolean two) {
     uint8_t index = (uint8_t) (randomNum % numEmpty);
     uint8_t row = emptySpots[index][0];
     uint8_t col = emptySpots[index][1];
+    TRACE(TRACE_PUT_RANDOM, row * 4 + col);
     if (two == TRUE) {
         board -> grid[row][col].value = 2;
     } else {
@@ -67,6 +69,12 @@ static uint8_t lessThan (int8_t *counter) {
 }
 
 Boolean Board_shift(Direction dir, Board *gameBoard) {
+    uint32_t score = 0;
+    return Board_shiftScore(dir, gameBoard, &score);
+}
+
+Boolean Board_shiftScore(Direction dir, Board *gameBoard, uint32_t *score) {
+    TRACE(TRACE_SHIFT_BEGIN, dir);
     // Make a copy of the original board to check against it later
     Board board = * gameBoard;
     
@@ -144,6 +152,7 @@ Boolean Board_shift(Direction dir, Board *gameBoard) {
                 //Matching blocks, combine and shift
                 if (seenVal == boardVal) {
                     newRow[moveIndex] = 2 * seenVal;
+                    *score += 2 * seenVal;
                     (*innerIncFnPtr)(&moveIndex);
                     seenVal = 0; 
                 } else {
@@ -168,7 +177,9 @@ Boolean Board_shift(Direction dir, Board *gameBoard) {
             gameBoard -> grid[row][col].value = newRow[(*innerLoop)];
         }
     }     
-    return !Board_equal(gameBoard, &board);
+    Boolean moved = !Board_equal(gameBoard, &board);
+    TRACE(TRACE_SHIFT_END, moved);
+    return moved;
 }
 
 Boolean Board_gameOver(Board *board) {
@@ -177,11 +188,14 @@ Boolean Board_gameOver(Board *board) {
     //will return from the function 
     Board gameBoard = *board;
     Direction allDirs[4] = {UP,DOWN,LEFT,RIGHT};
-    for (uint8_t i = 0; i < 4; i++) {
+    Boolean over = TRUE;
+    TRACE(TRACE_GAME_OVER_BEGIN, 0);
+    for (uint8_t i = 0; i < 4 && over; i++) {
         if(Board_shift(allDirs[i], &gameBoard))
-            return FALSE; 
+            over = FALSE; 
     }
-    return TRUE;
+    TRACE(TRACE_GAME_OVER_END, over);
+    return over;
 }
 
 Boolean Board_gameWon(Board *board){
@@ -192,3 +206,26 @@ Boolean Board_gameWon(Board *board){
         } 
     return FALSE;
 }
+
+void Board_pack(Board *board, uint8_t packed[8]) {
+    for (uint8_t i = 0; i < 8; i++)
+        packed[i] = 0;
+    for (uint8_t cell = 0; cell < 16; cell++) {
+        uint16_t value = board -> grid[cell / 4][cell % 4].value;
+        uint8_t exponent = 0;
+        while (value > 1) {
+            value >>= 1;
+            exponent++;
+        }
+        packed[cell / 2] |= exponent << ((cell % 2) * 4);
+    }
+}
+
+Board Board_unpack(const uint8_t packed[8]) {
+    Board newBoard;
+    for (uint8_t cell = 0; cell < 16; cell++) {
+        uint8_t exponent = (packed[cell / 2] >> ((cell % 2) * 4)) & 0x0F;
+        newBoard.grid[cell / 4][cell % 4].value = exponent ? 1U << exponent : 0;
+    }
+    return newBoard;
+}
@@ -67,6 +67,12 @@ void Board_putRandom(Board * board, uint32_t randomNum, Boolean two);
  */
 Boolean Board_shift(Direction dir, Board * gameBoard); 
 
+/*
+ * Same as Board_shift, but also adds the value of every block created by a 
+ * merge to the score pointed to by score, following 2048 scoring rules
+ */
+Boolean Board_shiftScore(Direction dir, Board * gameBoard, uint32_t * score);
+
 /*
  * Checks to see if the game is over according to 2048 rules:
  *   - A shift in any direction will not result in any merges
@@ -81,4 +87,17 @@ Boolean Board_gameOver(Board *board);
  */
 Boolean Board_gameWon(Board *board);
 
+/*
+ * Packs a board into 8 bytes, 4 bits for each block holding the exponent of 
+ * its value (0 for an empty block). Blocks are in row major order, with the 
+ * first of every pair in the low bits. Block values must be powers of two 
+ * up to 32768.
+ */
+void Board_pack(Board *board, uint8_t packed[8]);
+
+/*
+ * Constructor function that unpacks a board packed by Board_pack
+ */
+Board Board_unpack(const uint8_t packed[8]);
+
 #endif
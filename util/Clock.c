@@ -0,0 +1,86 @@
+#include <HAL.h>
+#include <Clock.h>
+#include <Timer.h>
+
+// While slowed down timer0 counts CLOCK_SLOW_TICKS at a time and
+// interrupts every CLOCK_SLOW_MS
+#define CLOCK_SLOW_TICKS (HAL_TIMER0_SLOW_PRESCALER / HAL_TIMER0_PRESCALER)
+#define CLOCK_SLOW_MS 32
+#define CLOCK_SLOW_TOP (CLOCK_SLOW_MS * CLOCK_TICKS_PER_MS / CLOCK_SLOW_TICKS - 1)
+
+volatile uint32_t clockMillis = 0;
+// Milliseconds a compare match stands for, CLOCK_SLOW_MS while slowed down
+static volatile uint8_t clockStep = 1;
+// Ticks into the millisecond when the slow count started
+static uint8_t clockOffset = 0;
+
+HAL_ISR (TIMER0_COMPA) {
+    uint32_t now = clockMillis + clockStep;
+    clockMillis = now;
+    Timer_tick(now);
+}
+
+void Clock_setup(void) {
+    HAL_timer0Start(CLOCK_TICKS_PER_MS - 1);
+}
+
+uint32_t Clock_now(void) {
+    uint32_t ms;
+    uint16_t ticks;
+    HAL_ATOMIC_BLOCK {
+        uint8_t count = HAL_timer0Count();
+        ms = clockMillis;
+        if (clockStep == 1) {
+            // A compare match that has happened but hasn't been serviced yet
+            if (HAL_timer0MatchPending() && count < CLOCK_TICKS_PER_MS - 1)
+                ms++;
+            ticks = count;
+        } else {
+            if (HAL_timer0MatchPending() && count < CLOCK_SLOW_TOP)
+                ms += CLOCK_SLOW_MS;
+            ticks = clockOffset + count * CLOCK_SLOW_TICKS;
+        }
+    }
+    return ms * CLOCK_TICKS_PER_MS + ticks;
+}
+
+uint32_t Clock_millis(void) {
+    uint32_t ms;
+    HAL_ATOMIC_BLOCK {
+        ms = clockMillis;
+    }
+    return ms;
+}
+
+void Clock_slowDown(void) {
+#ifndef TRACE_ENABLE
+    if (Timer_anyArmed())
+        return;
+    uint8_t count = HAL_timer0Count();
+    // The pending interrupt is dropped, with nothing armed it had nothing
+    // to run
+    if (HAL_timer0MatchPending() && count < CLOCK_TICKS_PER_MS - 1)
+        clockMillis++;
+    clockOffset = count;
+    clockStep = CLOCK_SLOW_MS;
+    HAL_timer0Restart(CLOCK_SLOW_TOP, 0, 1);
+#endif
+}
+
+void Clock_speedUp(void) {
+    if (clockStep == 1)
+        return;
+    uint8_t count = HAL_timer0Count();
+    uint32_t ms = clockMillis;
+    if (HAL_timer0MatchPending() && count < CLOCK_SLOW_TOP)
+        ms += CLOCK_SLOW_MS;
+    // At most CLOCK_SLOW_MS rounds, cheaper than a division
+    uint16_t ticks = clockOffset + count * CLOCK_SLOW_TICKS;
+    while (ticks >= CLOCK_TICKS_PER_MS) {
+        ticks -= CLOCK_TICKS_PER_MS;
+        ms++;
+    }
+    clockMillis = ms;
+    clockStep = 1;
+    HAL_timer0Restart(CLOCK_TICKS_PER_MS - 1, ticks, 0);
+}
@@ -0,0 +1,56 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include <stdint.h>
+
+/*
+ * Timestamps from timer0, which counts in 8us ticks and interrupts once a
+ * millisecond to keep the count going. Timestamps wrap around after about
+ * 9.5 hours, durations are the difference of two timestamps and come out
+ * right across the wrap as long as they are shorter than that.
+ *
+ * The millisecond interrupt is also the tick of the software timers in
+ * Timer.h. While the CPU waits a long time with no timer armed the Clock
+ * can slow down to an interrupt every 32 ms counting in 128us, which wakes
+ * the CPU 32 times less often. Timestamps taken meanwhile are only to the
+ * 128us, and each slow down can leave the Clock up to 128us off, as often
+ * ahead as behind.
+ */
+#define CLOCK_TICK_US 8
+#define CLOCK_TICKS_PER_MS 125
+
+/*
+ * Starts timer0
+ */
+void Clock_setup(void);
+
+/*
+ * Current time in ticks of CLOCK_TICK_US microseconds. Safe to call with
+ * interrupts disabled and from interrupt handlers.
+ */
+uint32_t Clock_now(void);
+
+/*
+ * Milliseconds since Clock_setup
+ */
+uint32_t Clock_millis(void);
+
+/*
+ * Slows the Clock down if no timer is armed, for Power_wait. Only called
+ * with interrupts disabled. TRACE builds never slow down, the trace records
+ * the timer0 count as is.
+ */
+void Clock_slowDown(void);
+
+/*
+ * Back to the millisecond interrupt, does nothing if the Clock isn't slowed
+ * down. Timer_arm calls it, so interrupt handlers can arm timers while it
+ * is. Only called with interrupts disabled.
+ */
+void Clock_speedUp(void);
+
+/*
+ * Milliseconds counted by the timer0 interrupt, only for code that reads 
+ * the timer itself to stay cheaper than Clock_now (see Trace.h)
+ */
+extern volatile uint32_t clockMillis;
+#endif
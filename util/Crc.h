@@ -0,0 +1,23 @@
+#ifndef CRC_H
+#define CRC_H
+#include <stdint.h>
+
+/*
+ * CRC-8 with polynomial 0x07, shared by the EEPROM records of Storage.h
+ * and the frames of Protocol.h. Start from CRC_INIT and feed the bytes in.
+ */
+#define CRC_INIT 0xFF
+
+static inline uint8_t Crc_update(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (uint8_t bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    return crc;
+}
+
+static inline uint8_t Crc_block(uint8_t crc, const uint8_t *data, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++)
+        crc = Crc_update(crc, data[i]);
+    return crc;
+}
+#endif
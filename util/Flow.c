@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <Flow.h>
+
+void Flow_run(const Flow *flow, uint8_t *settings) {
+    const uint8_t *program = pgm_read_ptr(&flow -> program);
+    PGM_P const *strings = pgm_read_ptr(&flow -> strings);
+    const FlowAction *actions = pgm_read_ptr(&flow -> actions);
+    char line[FLOW_LINE] = "";
+    const uint8_t *pc = program;
+    for (;;) {
+        uint8_t op = pgm_read_byte(pc++);
+        if (op == FLOW_END || op > FLOW_CALL)
+            return;
+        // Every other instruction has at least one operand
+        uint8_t a = pgm_read_byte(pc);
+        switch (op) {
+            case FLOW_PAGE:
+                printf_P(pgm_read_ptr(&strings[a]));
+                ((FlowAction) pgm_read_ptr(&flow -> getEnter))();
+                printf_P(PSTR("\n\n"));
+                pc += 1;
+                break;
+            case FLOW_PRINT:
+                printf_P(pgm_read_ptr(&strings[a]));
+                pc += 1;
+                break;
+            case FLOW_PROMPT: {
+                uint8_t size = pgm_read_byte(pc + 1);
+                void (*getInput)(char *, size_t) = (void (*)(char *, size_t)) pgm_read_ptr(&flow -> getInput);
+                printf_P(pgm_read_ptr(&strings[a]));
+                getInput(line, size < FLOW_LINE ? size : FLOW_LINE);
+                pc += 2;
+                break;
+            }
+            case FLOW_MATCH:
+                if (strcmp_P(line, pgm_read_ptr(&strings[a])) == 0)
+                    pc = program + pgm_read_byte(pc + 1);
+                else
+                    pc += 2;
+                break;
+            case FLOW_JUMP:
+                pc = program + a;
+                break;
+            case FLOW_IF:
+                if (settings[a] == pgm_read_byte(pc + 1))
+                    pc = program + pgm_read_byte(pc + 2);
+                else
+                    pc += 3;
+                break;
+            case FLOW_SET:
+                settings[a] = pgm_read_byte(pc + 1);
+                ((FlowAction) pgm_read_ptr(&flow -> save))();
+                pc += 2;
+                break;
+            case FLOW_CALL:
+                ((FlowAction) pgm_read_ptr(&actions[a]))();
+                pc += 1;
+                break;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef FLOW_H
+#define FLOW_H
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/*
+ * Interpreter for the story and menus, which are a program of byte codes in
+ * flash instead of C code. tools/flowgen.py compiles story.flow into the
+ * program and the tables of strings and actions it uses, see there for the
+ * source format.
+ *
+ * Each instruction is an opcode followed by byte operands. A string is an
+ * index into the string table, an action an index into the action table,
+ * a setting the offset of a byte in the settings and a target the offset
+ * of an instruction in the program:
+ *
+ *     FLOW_END                         return from Flow_run
+ *     FLOW_PAGE    string              print, wait for enter, skip a line
+ *     FLOW_PRINT   string              print
+ *     FLOW_PROMPT  string size         print, read a line of up to size - 1
+ *                                      characters
+ *     FLOW_MATCH   string target       jump if the line read was string
+ *     FLOW_JUMP    target
+ *     FLOW_IF      setting value target
+ *                                      jump if the setting has value
+ *     FLOW_SET     setting value       change a setting and save them all
+ *     FLOW_CALL    action              run an action, which may not return
+ */
+enum {
+    FLOW_END,
+    FLOW_PAGE,
+    FLOW_PRINT,
+    FLOW_PROMPT,
+    FLOW_MATCH,
+    FLOW_JUMP,
+    FLOW_IF,
+    FLOW_SET,
+    FLOW_CALL
+};
+
+// Longest line a prompt reads, with the terminating null
+#define FLOW_LINE 20
+
+typedef void (*FlowAction)(void);
+
+/*
+ * A compiled flow with what it needs from the application, all in flash
+ */
+typedef struct {
+    const uint8_t *program;
+    PGM_P const *strings;
+    const FlowAction *actions;
+    FlowAction save;                            // writes the settings back
+    FlowAction getEnter;                        // waits for enter
+    void (*getInput)(char *str, size_t size);   // reads a line
+} Flow;
+
+/*
+ * Runs a flow stored in flash from the start of its program, testing and
+ * changing the bytes of settings
+ */
+void Flow_run(const Flow *flow, uint8_t *settings);
+#endif
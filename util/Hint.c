@@ -0,0 +1,162 @@
+#include <avr/pgmspace.h>
+#include "Hint.h"
+
+// Reward for each empty cell, in the units of the weighted tile values
+#define EMPTY_BONUS 256
+// A 2 spawns 9 times out of 10
+#define WEIGHT_TWO 9
+#define WEIGHT_FOUR 1
+
+/*
+ * Weight of each cell, row by row from the top left. Following the snake
+ * keeps the tiles in order so they can merge into each other.
+ */
+static const uint8_t weights[16] PROGMEM = {
+    64, 48, 32, 24,
+     4,  8, 12, 16,
+     3,  2,  1,  1,
+     0,  0,  0,  0
+};
+
+// Tile value of each exponent, a shift by a variable amount is slow on the AVR
+static const uint16_t values[16] PROGMEM = {
+    0, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768
+};
+
+// First cell and step between cells of each line, for every direction
+static const int8_t lineStart[4][4] PROGMEM = {
+    {0, 4, 8, 12},      // LEFT
+    {3, 7, 11, 15},     // RIGHT
+    {0, 1, 2, 3},       // UP
+    {12, 13, 14, 15}    // DOWN
+};
+static const int8_t lineStep[4] PROGMEM = {1, -1, 4, -4};
+
+static uint8_t searchAborted;
+
+/**
+ * Board_shift on tile exponents, returns TRUE if anything moved
+ */
+static Boolean shift(uint8_t cells[16], Direction dir) {
+    Boolean moved = FALSE;
+    int8_t step = pgm_read_byte(&lineStep[dir]);
+    for (uint8_t line = 0; line < 4; line++) {
+        int8_t start = pgm_read_byte(&lineStart[dir][line]);
+        uint8_t out[4] = {0, 0, 0, 0};
+        uint8_t count = 0;
+        uint8_t seen = 0;
+        for (int8_t i = 0, cell = start; i < 4; i++, cell += step) {
+            uint8_t exponent = cells[cell];
+            if (!exponent)
+                continue;
+            if (seen == exponent) {
+                out[count++] = exponent + 1;
+                seen = 0;
+            } else {
+                if (seen)
+                    out[count++] = seen;
+                seen = exponent;
+            }
+        }
+        if (seen)
+            out[count++] = seen;
+        for (int8_t i = 0, cell = start; i < 4; i++, cell += step) {
+            if (cells[cell] != out[i]) {
+                cells[cell] = out[i];
+                moved = TRUE;
+            }
+        }
+    }
+    return moved;
+}
+
+static uint32_t evaluate(const uint8_t cells[16]) {
+    uint32_t score = 0;
+    for (uint8_t i = 0; i < 16; i++) {
+        if (cells[i])
+            score += (uint32_t) pgm_read_word(&values[cells[i]]) * pgm_read_byte(&weights[i]);
+        else
+            score += EMPTY_BONUS;
+    }
+    return score;
+}
+
+static uint32_t bestMove(const uint8_t cells[16], uint8_t depth, HintExpired expired, int8_t *best);
+
+/**
+ * Expected score after a tile spawns on cells, followed by depth more moves
+ */
+static uint32_t expected(uint8_t cells[16], uint8_t depth, HintExpired expired) {
+    uint32_t total = 0;
+    uint16_t weight = 0;
+    for (uint8_t i = 0; i < 16; i++) {
+        if (cells[i])
+            continue;
+        if (expired()) {
+            searchAborted = TRUE;
+            return 0;
+        }
+        int8_t move;
+        cells[i] = 1;
+        total += WEIGHT_TWO * bestMove(cells, depth, expired, &move);
+        cells[i] = 2;
+        total += WEIGHT_FOUR * bestMove(cells, depth, expired, &move);
+        cells[i] = 0;
+        weight += WEIGHT_TWO + WEIGHT_FOUR;
+    }
+    // A full board can't happen after a move, but be safe
+    return weight ? total / weight : evaluate(cells);
+}
+
+/**
+ * Score of the best of the moves from cells, searching depth moves deep.
+ * The last move is scored without a spawn after it. Positions with no moves
+ * left score 0.
+ */
+static uint32_t bestMove(const uint8_t cells[16], uint8_t depth, HintExpired expired, int8_t *best) {
+    uint32_t bestScore = 0;
+    *best = -1;
+    for (uint8_t dir = 0; dir < 4 && !searchAborted; dir++) {
+        uint8_t next[16];
+        for (uint8_t i = 0; i < 16; i++)
+            next[i] = cells[i];
+        if (!shift(next, (Direction) dir))
+            continue;
+        uint32_t score = depth > 1 ? expected(next, depth - 1, expired) : evaluate(next);
+        if (*best < 0 || score > bestScore) {
+            bestScore = score;
+            *best = dir;
+        }
+    }
+    return bestScore;
+}
+
+int8_t Hint_search(Board *board, uint8_t depth, HintExpired expired) {
+    uint8_t cells[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        uint16_t value = board -> grid[i / 4][i % 4].value;
+        uint8_t exponent = 0;
+        while (value > 1) {
+            value >>= 1;
+            exponent++;
+        }
+        cells[i] = exponent;
+    }
+    int8_t best;
+    searchAborted = FALSE;
+    bestMove(cells, depth, expired, &best);
+    return searchAborted ? -1 : best;
+}
+
+static Boolean never(void) {
+    return FALSE;
+}
+
+int8_t Hint_suggest(Board *board, HintExpired expired) {
+    // One move ahead is only four evaluations, always finish it
+    int8_t best = Hint_search(board, 1, never);
+    if (best < 0)
+        return best;
+    int8_t deeper = Hint_search(board, 2, expired);
+    return deeper < 0 ? best : deeper;
+}
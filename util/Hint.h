@@ -0,0 +1,33 @@
+#ifndef HINT_H
+#define HINT_H
+#include <stdint.h>
+#include "Board.h"
+
+/*
+ * Move suggestions small enough for the capsule. An expectimax search looks
+ * one or two moves ahead, averaging over every tile that could spawn in
+ * between. The positions it reaches are scored with a table of weights in
+ * flash that favours keeping the big tiles in a snake from the top left
+ * corner, plus a bonus for every empty cell. Boards are searched as 16 byte
+ * arrays of tile exponents, so the whole search needs around 100 bytes of
+ * stack.
+ */
+
+/*
+ * Returns TRUE once the search should stop
+ */
+typedef Boolean (*HintExpired)(void);
+
+/*
+ * Best move searching depth moves ahead (1 or 2), or -1 if no move changes
+ * the board or expired returned TRUE before the search finished.
+ */
+int8_t Hint_search(Board *board, uint8_t depth, HintExpired expired);
+
+/*
+ * Searches one move ahead, then two unless expired returns TRUE first, and
+ * returns the deepest result there was time for. -1 if no move changes the
+ * board.
+ */
+int8_t Hint_suggest(Board *board, HintExpired expired);
+#endif
@@ -0,0 +1,23 @@
+#include <string.h>
+#include <Latency.h>
+
+static LatencyHistogram histograms[LATENCY_PHASES];
+
+void Latency_record(LatencyPhase phase, uint32_t ticks) {
+    LatencyHistogram *histogram = &histograms[phase];
+    uint8_t bucket = 0;
+    for (uint32_t t = ticks >> 1; t && bucket < LATENCY_BUCKETS - 1; t >>= 1)
+        bucket++;
+    if (histogram -> counts[bucket] != UINT16_MAX)
+        histogram -> counts[bucket]++;
+    if (ticks > histogram -> max)
+        histogram -> max = ticks;
+}
+
+const LatencyHistogram *Latency_get(LatencyPhase phase) {
+    return &histograms[phase];
+}
+
+void Latency_clear(void) {
+    memset(histograms, 0, sizeof histograms);
+}
@@ -0,0 +1,44 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include <stdint.h>
+
+/*
+ * Histograms of how long each phase of handling a key press takes, kept in
+ * RAM so they can be read back over the UART. Durations are in Clock ticks
+ * and counted in power of two buckets: bucket 0 holds durations under 2
+ * ticks, bucket i durations from 2^i up to 2^(i+1) ticks and the last
+ * bucket everything longer.
+ */
+typedef enum {
+    LATENCY_RECIEVE,    // from the key arriving to it being read
+    LATENCY_COMMIT,     // copying in a move worked out ahead of time
+    LATENCY_SHIFT,
+    LATENCY_SPAWN,
+    LATENCY_GAME_OVER,
+    LATENCY_RENDER,
+    LATENCY_DRAIN,      // from rendering to the last byte leaving the UART
+    LATENCY_PHASES
+} LatencyPhase;
+
+#define LATENCY_BUCKETS 16
+
+typedef struct {
+    uint16_t counts[LATENCY_BUCKETS];   // stop counting at 65535
+    uint32_t max;
+} LatencyHistogram;
+
+/*
+ * Counts a duration of ticks for phase
+ */
+void Latency_record(LatencyPhase phase, uint32_t ticks);
+
+/*
+ * Histogram of phase
+ */
+const LatencyHistogram *Latency_get(LatencyPhase phase);
+
+/*
+ * Empties every histogram
+ */
+void Latency_clear(void);
+#endif
@@ -0,0 +1,93 @@
+#include <HAL.h>
+#include <Led.h>
+#include <Timer.h>
+#include <Trace.h>
+
+// Next step to load, null when stopped
+static const LedStep *volatile nextStep = 0;
+// Current step, with the pattern already converted to LED pin bits
+static volatile uint8_t bits = 0;
+static volatile uint8_t level = 0;
+static volatile uint8_t ticksLeft = 0;
+static volatile uint8_t phase = 0;
+static volatile uint8_t dimming = 0;
+// Goes off every LED_STEP_MS while a sequence is playing
+static Timer stepTimer;
+
+static void stopPwm(void) {
+    if (dimming) {
+        HAL_timer1Stop();
+        dimming = 0;
+    }
+}
+
+static void stop(void) {
+    Timer_cancel(&stepTimer);
+    stopPwm();
+    nextStep = 0;
+    HAL_ledWrite(0);
+}
+
+/**
+ * Loads the next step of the sequence, stopping at LED_END. Steps that are
+ * fully on or off are written straight to the pins, only the others need
+ * timer1. Only called with interrupts disabled.
+ */
+static inline void loadStep(void) {
+    const LedStep *step = nextStep;
+    uint8_t duration = pgm_read_byte(&step -> duration);
+    if (!duration) {
+        stop();
+        return;
+    }
+    uint8_t pattern = pgm_read_byte(&step -> pattern);
+    TRACE(TRACE_LED_STEP, pattern);
+    bits = HAL_LED_BITS(pattern);
+    level = pgm_read_byte(&step -> brightness);
+    ticksLeft = duration;
+    nextStep = step + 1;
+    if (level == 0 || level >= LED_FULL) {
+        stopPwm();
+        HAL_ledWrite(level ? bits : 0);
+    } else if (!dimming) {
+        // Timer1 at 1 MHz, compare every 500 ticks gives LED_FULL 
+        // slots per LED_STEP_MS
+        phase = 0;
+        dimming = 1;
+        HAL_timer1Start((F_CPU / HAL_TIMER1_PRESCALER / 1000) * LED_STEP_MS / LED_FULL - 1);
+    }
+}
+
+static void stepElapsed(Timer *timer) {
+    if (--ticksLeft == 0)
+        loadStep();
+}
+
+/**
+ * PWM slot interrupt, LED_FULL slots make up one period of LED_STEP_MS
+ */
+HAL_ISR (TIMER1_COMPA) {
+    uint8_t slot = (phase + 1) & (LED_FULL - 1);
+    phase = slot;
+    HAL_ledWrite(slot < level ? bits : 0);
+}
+
+void Led_setup(void) {
+    HAL_ledSetup();
+    Timer_init(&stepTimer, stepElapsed, 0);
+}
+
+void Led_play(const LedStep *sequence) {
+    HAL_ATOMIC_BLOCK {
+        nextStep = sequence;
+        loadStep();
+        if (nextStep)
+            Timer_arm(&stepTimer, LED_STEP_MS, LED_STEP_MS);
+    }
+}
+
+void Led_stop(void) {
+    HAL_ATOMIC_BLOCK {
+        stop();
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LED_H
+#define LED_H
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+/*
+ * Implementation of a table driven pattern engine for the 4 LEDs on PC2-PC5.
+ * A sequence is an array of LedSteps stored in flash and terminated by 
+ * LED_END. Each step lights a 4 bit pattern at a brightness for a duration.
+ * Steps are timed by a periodic software timer (see Timer.h). Brightness
+ * is done with software PWM from the timer1 compare interrupt, which only
+ * runs during steps that are neither fully on nor off and only touches
+ * PC2-PC5. Led_setup has to come before Led_play.
+ */
+
+// Number of brightness levels, a brightness of LED_FULL is always on
+#define LED_FULL 16
+// Length of one duration unit in milliseconds (one PWM period)
+#define LED_STEP_MS 8
+
+typedef struct {
+    uint8_t pattern;    // Bit 0 is PC2, bit 3 is PC5
+    uint8_t brightness; // 0 to LED_FULL
+    uint8_t duration;   // In units of LED_STEP_MS, 0 ends the sequence
+} LedStep;
+
+#define LED_END {0, 0, 0}
+
+/*
+ * Sets up PC2-PC5 as outputs, turned off 
+ */
+void Led_setup(void);
+
+/*
+ * Starts playing a sequence stored in flash from its first step,
+ * replacing the sequence that is currently playing. The LEDs are
+ * turned off once the sequence ends.
+ */
+void Led_play(const LedStep *sequence);
+
+/*
+ * Stops the current sequence and turns off the LEDs
+ */
+void Led_stop(void);
+#endif
@@ -0,0 +1,30 @@
+#include <HAL.h>
+#include <Memory.h>
+
+#define PAINT 0xC5
+
+/*
+ * Runs before main, when nothing has been pushed on the stack and the heap
+ * is still empty
+ */
+HAL_EARLY_INIT(Memory_paint) {
+    uint8_t *stack = HAL_ramStack();
+    for (uint8_t *p = HAL_ramStaticEnd(); p < stack; p++)
+        *p = PAINT;
+}
+
+void Memory_getStats(MemoryStats *stats) {
+    uint8_t *heapEnd = HAL_ramHeapEnd();
+    uint8_t *stack = HAL_ramStack();
+    uint8_t *untouched = heapEnd;
+    while (untouched < stack && *untouched == PAINT)
+        untouched++;
+
+    stats->total = HAL_ramEnd() - HAL_ramStart();
+    stats->statics = HAL_ramStaticEnd() - HAL_ramStart();
+    stats->heap = heapEnd - HAL_ramStaticEnd();
+    stats->stack = HAL_ramEnd() - stack;
+    stats->stackPeak = HAL_ramEnd() - untouched;
+    stats->free = stack - heapEnd;
+    stats->minFree = untouched - heapEnd;
+}
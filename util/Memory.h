@@ -0,0 +1,31 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <stdint.h>
+
+/*
+ * RAM usage report. The free RAM between the heap and the stack is painted 
+ * with a known value at reset, before main runs. The stack overwrites the 
+ * paint as it grows, so the paint that is left shows how close the stack 
+ * has come to the heap since reset.
+ */
+
+/*
+ * Sizes in bytes. stackPeak and minFree are the deepest the stack has been
+ * and the least free RAM there has been. A buffer on the stack that was 
+ * never written to still looks free, so they are a lower and upper bound.
+ */
+typedef struct {
+    uint16_t total;
+    uint16_t statics;   // .data and .bss
+    uint16_t heap;
+    uint16_t stack;     // in use by the caller now
+    uint16_t stackPeak;
+    uint16_t free;
+    uint16_t minFree;
+} MemoryStats;
+
+/*
+ * Fills in *stats
+ */
+void Memory_getStats(MemoryStats *stats);
+#endif
@@ -0,0 +1,54 @@
+#include <HAL.h>
+#include <Power.h>
+#include <Clock.h>
+
+#define CLOCK_TICKS_PER_POWER_TICK (POWER_TICK_US / CLOCK_TICK_US)
+
+static uint32_t asleepTicks = 0;
+// Clock ticks asleep that don't make up a whole power tick yet
+static uint8_t asleepRemainder = 0;
+static uint32_t wakeups = 0;
+
+void Power_setup(void) {
+    HAL_powerSetup();
+}
+
+static void idle(uint8_t slow) {
+    if (slow)
+        Clock_slowDown();
+    uint32_t start = Clock_now();
+    HAL_sleep();
+    // The interrupt that woke us has been serviced by now
+    HAL_disableInterrupts();
+    if (slow)
+        Clock_speedUp();
+    uint32_t slept = Clock_now() - start + asleepRemainder;
+    asleepTicks += slept / CLOCK_TICKS_PER_POWER_TICK;
+    asleepRemainder = slept % CLOCK_TICKS_PER_POWER_TICK;
+    wakeups++;
+    HAL_enableInterrupts();
+}
+
+void Power_idle(void) {
+    idle(0);
+}
+
+void Power_wait(void) {
+    idle(1);
+}
+
+void Power_halt(void) {
+    HAL_powerDown();
+}
+
+void Power_getStats(PowerStats *stats) {
+    // Milliseconds to power ticks without overflowing for the first 6 days
+    uint32_t ms = Clock_millis();
+    uint32_t total = (ms / 16) * (16000 / POWER_TICK_US) + (ms % 16) * 1000 / POWER_TICK_US;
+    HAL_ATOMIC_BLOCK {
+        stats -> asleep = asleepTicks;
+        // total is only to the millisecond
+        stats -> awake = total > asleepTicks ? total - asleepTicks : 0;
+        stats -> wakeups = wakeups;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef POWER_H
+#define POWER_H
+#include <stdint.h>
+
+/*
+ * Implementation of an idle policy for the ATMega328P. Code that waits on
+ * an event puts the CPU into idle sleep between interrupts instead of
+ * polling, and the time spent asleep versus awake is accounted for with
+ * the Clock so that the savings can be reported.
+ */
+
+/*
+ * Time spent asleep and awake since Clock_setup, in units of
+ * POWER_TICK_US microseconds, and the number of times the CPU was woken up.
+ */
+#define POWER_TICK_US 128
+
+typedef struct {
+    uint32_t asleep;
+    uint32_t awake;
+    uint32_t wakeups;
+} PowerStats;
+
+/*
+ * Shuts down unused peripherals and selects idle sleep. The accounting
+ * needs the Clock to be running.
+ */
+void Power_setup(void);
+
+/*
+ * Puts the CPU to sleep until the next interrupt has been serviced. 
+ * Must be called with interrupts disabled, right after the caller has 
+ * checked that there is nothing to do; interrupts are enabled when this
+ * returns. This avoids losing a wakeup that arrives between the check
+ * and the sleep instruction. Idle mode keeps the USART, timers and ADC 
+ * running, so any of them can wake the CPU.
+ */
+void Power_idle(void);
+
+/*
+ * Power_idle for waits that can take long, like for the next key. With no
+ * timer armed the Clock is slowed down meanwhile so that its tick doesn't
+ * wake the CPU every millisecond, see Clock.h.
+ */
+void Power_wait(void);
+
+/*
+ * Powers down the CPU for good, only a reset wakes it up again.
+ */
+void Power_halt(void);
+
+/*
+ * Copies the sleep accounting into *stats
+ */
+void Power_getStats(PowerStats *stats);
+#endif
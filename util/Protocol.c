@@ -0,0 +1,8 @@
+#include "Protocol.h"
+#include "Crc.h"
+
+void Protocol_frame(Board *board, uint8_t flags, uint8_t frame[PROTOCOL_FRAME_SIZE]) {
+    frame[0] = PROTOCOL_SYNC | flags;
+    Board_pack(board, frame + 1);
+    frame[PROTOCOL_FRAME_SIZE - 1] = Crc_block(CRC_INIT, frame, PROTOCOL_FRAME_SIZE - 1);
+}
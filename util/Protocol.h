@@ -0,0 +1,36 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+#include <stdint.h>
+#include "Board.h"
+
+/*
+ * Binary protocol for playing 2048 from a program instead of a terminal.
+ * PROTOCOL_START, sent while 2048 is running, switches from redrawing the
+ * board to framed replies and PROTOCOL_STOP switches back. In between the 
+ * host sends one byte commands: the usual move keys (i, j, k, l) or 
+ * PROTOCOL_QUERY, and every command is answered with one frame:
+ *
+ *   byte 0     PROTOCOL_SYNC in the top 4 bits, PROTOCOL_ flags below
+ *   bytes 1-8  the board as packed by Board_pack
+ *   byte 9     CRC-8 (polynomial 0x07, initial value 0xFF) of bytes 0-8
+ *
+ * On game over the frame shows the final board and the next command plays
+ * on a new game. Once the game is won 2048 ends and protocol mode with it.
+ */
+#define PROTOCOL_START 0x02
+#define PROTOCOL_STOP 0x03
+#define PROTOCOL_QUERY '?'
+
+#define PROTOCOL_SYNC 0xA0
+#define PROTOCOL_SYNC_MASK 0xF0
+#define PROTOCOL_MOVED 0x01     // the command changed the board
+#define PROTOCOL_OVER 0x02      // no moves left
+#define PROTOCOL_WON 0x04
+
+#define PROTOCOL_FRAME_SIZE 10
+
+/*
+ * Builds the frame for board with flags
+ */
+void Protocol_frame(Board *board, uint8_t flags, uint8_t frame[PROTOCOL_FRAME_SIZE]);
+#endif
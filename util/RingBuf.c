@@ -1,3 +1,4 @@
+#include <string.h>
 #include "RingBuf.h"
 
 int ringBufPush(ringBuf_t *buf, uint8_t data)
@@ -32,3 +33,112 @@ int ringBufPop(ringBuf_t *buf, uint8_t *data)
  
     return 0;
 }
+
+// Keeps the compiler from moving buffer accesses past an index update
+#define BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+int spscRingBufPush(spscRingBuf_t *buf, uint8_t data)
+{
+    uint8_t head = buf->head;
+    // Full when every slot is in use
+    if ((uint8_t)(head - buf->tail) > buf->mask)
+        return -1;
+
+    buf->buffer[head & buf->mask] = data;
+    BARRIER();
+    buf->head = head + 1;
+    return 0;
+}
+
+int spscRingBufPop(spscRingBuf_t *buf, uint8_t *data)
+{
+    uint8_t tail = buf->tail;
+    if (tail == buf->head)
+        return -1;
+
+    *data = buf->buffer[tail & buf->mask];
+    BARRIER();
+    buf->tail = tail + 1;
+    return 0;
+}
+
+uint8_t spscRingBufCount(const spscRingBuf_t *buf)
+{
+    return buf->head - buf->tail;
+}
+
+uint8_t spscRingBufFree(const spscRingBuf_t *buf)
+{
+    return buf->mask + 1 - (uint8_t)(buf->head - buf->tail);
+}
+
+uint8_t spscRingBufPeekWrite(spscRingBuf_t *buf, void **span)
+{
+    uint8_t head = buf->head;
+    uint8_t index = head & buf->mask;
+    uint8_t free = buf->mask + 1 - (uint8_t)(head - buf->tail);
+    // Stop at the end of the underlying storage
+    uint8_t contiguous = buf->mask + 1 - index;
+
+    *span = buf->buffer + index * buf->size;
+    return free < contiguous ? free : contiguous;
+}
+
+void spscRingBufCommitWrite(spscRingBuf_t *buf, uint8_t count)
+{
+    BARRIER();
+    buf->head += count;
+}
+
+uint8_t spscRingBufPeekRead(spscRingBuf_t *buf, const void **span)
+{
+    uint8_t tail = buf->tail;
+    uint8_t index = tail & buf->mask;
+    uint8_t count = buf->head - tail;
+    uint8_t contiguous = buf->mask + 1 - index;
+
+    BARRIER();
+    *span = buf->buffer + index * buf->size;
+    return count < contiguous ? count : contiguous;
+}
+
+void spscRingBufCommitRead(spscRingBuf_t *buf, uint8_t count)
+{
+    BARRIER();
+    buf->tail += count;
+}
+
+uint8_t spscRingBufWrite(spscRingBuf_t *buf, const void *src, uint8_t count)
+{
+    const uint8_t *bytes = src;
+    uint8_t written = 0;
+    void *span;
+    // At most two spans, before and after the end of the storage
+    for (uint8_t i = 0; i < 2 && written < count; i++) {
+        uint8_t n = spscRingBufPeekWrite(buf, &span);
+        if (n > count - written)
+            n = count - written;
+        memcpy(span, bytes, n * buf->size);
+        spscRingBufCommitWrite(buf, n);
+        bytes += n * buf->size;
+        written += n;
+    }
+    return written;
+}
+
+uint8_t spscRingBufRead(spscRingBuf_t *buf, void *dst, uint8_t count)
+{
+    uint8_t *bytes = dst;
+    uint8_t read = 0;
+    const void *span;
+    for (uint8_t i = 0; i < 2 && read < count; i++) {
+        uint8_t n = spscRingBufPeekRead(buf, &span);
+        if (n > count - read)
+            n = count - read;
+        memcpy(bytes, span, n * buf->size);
+        spscRingBufCommitRead(buf, n);
+        bytes += n * buf->size;
+        read += n;
+    }
+    return read;
+}
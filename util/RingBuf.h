@@ -0,0 +1,129 @@
+#ifndef RINGBUF_H 
+#define RINGBUF_H
+
+#include <stdint.h>
+
+//Defines a ring buffer with the first parameter as its name and the second parameter as its size
+#define RINGBUF_DEF(x,y) uint8_t x##_space[y]; ringBuf_t x = { x##_space,0,0,y}
+
+/**
+ * Simple implementation of a ring buffer which does not overwrite old data when it gets full. 
+ * The head variable indicates where we should insert a new element, and the tail variable
+ * indicates where we should pop. Note with this implementation, the last byte in the buffer 
+ * is never used. 
+ */
+
+typedef struct {
+    uint8_t *const buffer;
+    int head;
+    int tail;
+    const int maxLen;
+} ringBuf_t;
+/**
+ * Pushes an unsigned 8 bit int to the buffer of a ringBuf_t object,
+ * returns -1 if the ring buffer is full and will not push the data 
+ * on. User should check and handle this appropriately.  
+ */
+int ringBufPush(ringBuf_t *buf, uint8_t data);
+
+/**
+ * Pops an unsigned 8 bit in to the location specified by *data. 
+ * returns -1 if the ring buffer is empty.
+ */
+int ringBufPop(ringBuf_t *buf, uint8_t *data);
+
+//Defines a single producer, single consumer ring buffer with the first parameter as its name 
+//and the second parameter as its size, which must be a power of two no larger than 128
+#define SPSC_RINGBUF_DEF(x,y) SPSC_RINGBUF_DEF_TYPED(x,uint8_t,y)
+
+//Defines a single producer, single consumer ring buffer of fixed size records, such as structs,
+//with the first parameter as its name, the second as the record type and the third as its size
+//in records, which must be a power of two no larger than 128
+#define SPSC_RINGBUF_DEF_TYPED(x,t,y) \
+    t x##_space[(((y) & ((y) - 1)) == 0 && (y) <= 128) ? (y) : -1]; \
+    spscRingBuf_t x = { (uint8_t *) x##_space,0,0,(y) - 1,sizeof(t)}
+
+/**
+ * Ring buffer that is safe to share between one producer and one consumer, for 
+ * example an interrupt handler that pushes and the main loop that pops, without
+ * disabling interrupts. The head is only written by the producer and the tail 
+ * only by the consumer; both are 8 bits so they are read and written atomically 
+ * on AVR. They run freely and are masked into the buffer, so head - tail is the 
+ * number of records stored and every record in the buffer is used.
+ * Records are a single byte unless the buffer is defined with SPSC_RINGBUF_DEF_TYPED,
+ * counts below are always in records.
+ */
+
+typedef struct {
+    uint8_t *const buffer;
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    const uint8_t mask;
+    const uint8_t size;
+} spscRingBuf_t;
+
+/**
+ * Pushes an unsigned 8 bit int to a buffer of bytes, returns -1 if 
+ * the ring buffer is full and will not push the data on.
+ * Must only be called by the producer.
+ */
+int spscRingBufPush(spscRingBuf_t *buf, uint8_t data);
+
+/**
+ * Pops an unsigned 8 bit int from a buffer of bytes to the location 
+ * specified by *data, returns -1 if the ring buffer is empty. Must only 
+ * be called by the consumer.
+ */
+int spscRingBufPop(spscRingBuf_t *buf, uint8_t *data);
+
+/**
+ * Number of records that can be popped. Only a lower bound when 
+ * called by the consumer while the producer is running.
+ */
+uint8_t spscRingBufCount(const spscRingBuf_t *buf);
+
+/**
+ * Number of records that can be pushed. Only a lower bound when 
+ * called by the producer while the consumer is running.
+ */
+uint8_t spscRingBufFree(const spscRingBuf_t *buf);
+
+/**
+ * Pushes up to count records from src, returns the number of records
+ * that fit. Must only be called by the producer.
+ */
+uint8_t spscRingBufWrite(spscRingBuf_t *buf, const void *src, uint8_t count);
+
+/**
+ * Pops up to count records to dst, returns the number of records
+ * that were popped. Must only be called by the consumer.
+ */
+uint8_t spscRingBufRead(spscRingBuf_t *buf, void *dst, uint8_t count);
+
+/**
+ * Points *span at the free records following the head so that the producer 
+ * can write them in place, and returns how many of them are contiguous. 
+ * Nothing is pushed until spscRingBufCommitWrite is called. A second call 
+ * after committing returns the rest of the free space when it wraps around.
+ */
+uint8_t spscRingBufPeekWrite(spscRingBuf_t *buf, void **span);
+
+/**
+ * Pushes count records that were written in place through spscRingBufPeekWrite,
+ * count must not be larger than what it returned.
+ */
+void spscRingBufCommitWrite(spscRingBuf_t *buf, uint8_t count);
+
+/**
+ * Points *span at the records following the tail so that the consumer can 
+ * read them in place, and returns how many of them are contiguous. Nothing 
+ * is popped until spscRingBufCommitRead is called.
+ */
+uint8_t spscRingBufPeekRead(spscRingBuf_t *buf, const void **span);
+
+/**
+ * Pops count records that were read in place through spscRingBufPeekRead,
+ * count must not be larger than what it returned.
+ */
+void spscRingBufCommitRead(spscRingBuf_t *buf, uint8_t count);
+#endif
@@ -0,0 +1,29 @@
+#include <stddef.h>
+#include "Speculate.h"
+
+void Speculate_begin(Speculation *speculation, uint32_t random, Boolean two) {
+    speculation -> random = random;
+    speculation -> two = two;
+    speculation -> ready = 0;
+}
+
+Boolean Speculate_step(Speculation *speculation, Board *board, uint32_t score) {
+    if (speculation -> ready == 4)
+        return FALSE;
+    SpeculatedMove *move = &speculation -> moves[speculation -> ready];
+    Board next = *board;
+    move -> score = score;
+    move -> moved = Board_shiftScore((Direction) speculation -> ready, &next, &move -> score);
+    move -> over = FALSE;
+    if (move -> moved) {
+        Board_putRandom(&next, speculation -> random, speculation -> two);
+        move -> over = Board_gameOver(&next);
+        Board_pack(&next, move -> board);
+    }
+    speculation -> ready++;
+    return speculation -> ready < 4 ? TRUE : FALSE;
+}
+
+const SpeculatedMove *Speculate_get(const Speculation *speculation, Direction dir) {
+    return dir < speculation -> ready ? &speculation -> moves[dir] : NULL;
+}
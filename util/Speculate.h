@@ -0,0 +1,46 @@
+#ifndef SPECULATE_H
+#define SPECULATE_H
+#include <stdint.h>
+#include "Board.h"
+
+/*
+ * Works out what each of the four moves would do while 2048 waits for a
+ * key, so a key press only has to copy the result in and can start drawing
+ * straight away. The random numbers for the spawn are known in advance, so
+ * the result is exactly what playing the move would have given.
+ *
+ * Each call to Speculate_step works out one direction, which lets the
+ * caller stop as soon as a key arrives. A direction that hasn't been worked
+ * out yet is simply played the slow way.
+ */
+typedef struct {
+    uint8_t board[8];   // Board_pack of the board after the spawn
+    uint32_t score;
+    Boolean moved;
+    Boolean over;
+} SpeculatedMove;
+
+typedef struct {
+    SpeculatedMove moves[4];
+    uint32_t random;
+    Boolean two;
+    uint8_t ready;      // directions worked out so far, in Direction order
+} Speculation;
+
+/*
+ * Forgets everything worked out so far, the moves from now on spawn with
+ * random and two as they would be passed to Board_putRandom
+ */
+void Speculate_begin(Speculation *speculation, uint32_t random, Boolean two);
+
+/*
+ * Works out the next direction from board and score. Returns FALSE once all
+ * four are ready.
+ */
+Boolean Speculate_step(Speculation *speculation, Board *board, uint32_t score);
+
+/*
+ * The outcome of dir, or NULL if it hasn't been worked out yet
+ */
+const SpeculatedMove *Speculate_get(const Speculation *speculation, Direction dir);
+#endif
@@ -0,0 +1,205 @@
+#include <string.h>
+#include <HAL.h>
+#include <Storage.h>
+#include <Crc.h>
+#include <Power.h>
+#include <Trace.h>
+
+// Every slot holds the record followed by a checksum and a sequence number
+#define OVERHEAD 2
+#define MAX_SIZE STORAGE_GAME_SIZE
+
+typedef struct {
+    uint16_t base;      // EEPROM address of the first slot
+    uint8_t slots;      // Less than 128 so sequence numbers can be compared
+    uint8_t size;       // Record size
+    uint8_t *cache;
+} Region;
+
+static uint8_t settingsCache[STORAGE_SETTINGS_SIZE];
+static uint8_t gameCache[STORAGE_GAME_SIZE];
+
+static const Region regions[STORAGE_REGIONS] = {
+    // 127 slots of 4 bytes, from address 0
+    {0, 127, STORAGE_SETTINGS_SIZE, settingsCache},
+    // 28 slots of 18 bytes, from address 512
+    {512, 28, STORAGE_GAME_SIZE, gameCache},
+};
+
+// Slot and sequence number of the newest record of every region
+static uint8_t newestSlot[STORAGE_REGIONS];
+static uint8_t newestSeq[STORAGE_REGIONS];
+// Bit masks of regions that have a record, and of regions waiting to be written
+static uint8_t stored = 0;
+static volatile uint8_t dirty = 0;
+
+// Slot being written by the EEPROM ready interrupt
+static uint8_t staged[MAX_SIZE + OVERHEAD];
+static uint16_t stagedAddr;
+static uint8_t stagedLength = 0;
+static uint8_t stagedIndex = 0;
+
+/**
+ * CRC-8 of a record and its sequence number, never 0xFF for an erased 
+ * slot or 0 for a zeroed one
+ */
+static uint8_t checksum(const uint8_t *record, uint8_t size, uint8_t seq) {
+    return Crc_update(Crc_block(CRC_INIT, record, size), seq);
+}
+
+static uint16_t slotAddr(const Region *region, uint8_t slot) {
+    return region -> base + (uint16_t) slot * (region -> size + OVERHEAD);
+}
+
+/**
+ * Reads EEPROM directly, only used on startup before any writes are queued
+ */
+static void readBlock(uint8_t *dst, uint16_t addr, uint8_t length) {
+    while (HAL_eepromBusy()) {}
+    for (uint8_t i = 0; i < length; i++)
+        dst[i] = HAL_eepromRead(addr + i);
+}
+
+static uint8_t readSeq(const Region *region, uint8_t slot) {
+    uint8_t seq;
+    readBlock(&seq, slotAddr(region, slot) + region -> size + 1, 1);
+    return seq;
+}
+
+/**
+ * Reads a slot into the region's cache, returns 0 if its checksum is valid
+ */
+static int readSlot(const Region *region, uint8_t slot) {
+    uint8_t record[MAX_SIZE + OVERHEAD];
+    uint8_t size = region -> size;
+    readBlock(record, slotAddr(region, slot), size + OVERHEAD);
+    if (checksum(record, size, record[size + 1]) != record[size])
+        return -1;
+    memcpy(region -> cache, record, size);
+    return 0;
+}
+
+/**
+ * Finds the newest valid record of a region
+ */
+static void load(uint8_t index) {
+    const Region *region = &regions[index];
+    // Slots are written in order, so the newest is normally the last one 
+    // whose sequence number follows on from the one before it
+    uint8_t slot = 0;
+    uint8_t seq = readSeq(region, 0);
+    for (uint8_t i = 1; i < region -> slots; i++) {
+        uint8_t next = readSeq(region, i);
+        if (next != (uint8_t) (seq + 1))
+            break;
+        slot = i;
+        seq = next;
+    }
+    if (readSlot(region, slot) != 0) {
+        // A blank or corrupted log, look through every slot instead
+        uint8_t found = 0;
+        for (uint8_t i = 0; i < region -> slots; i++) {
+            uint8_t next = readSeq(region, i);
+            if ((!found || (int8_t) (next - seq) > 0) && readSlot(region, i) == 0) {
+                found = 1;
+                slot = i;
+                seq = next;
+            }
+        }
+        if (!found) {
+            memset(region -> cache, 0, region -> size);
+            // The first write goes to slot 0 with sequence number 0
+            newestSlot[index] = region -> slots - 1;
+            newestSeq[index] = 0xFF;
+            return;
+        }
+        // The scan leaves the cache holding the last valid slot it read
+        readSlot(region, slot);
+    }
+    stored |= 1 << index;
+    newestSlot[index] = slot;
+    newestSeq[index] = seq;
+}
+
+/**
+ * Copies the next dirty region into the next slot of its log, returns 0 if 
+ * nothing is waiting to be written. Only called with interrupts disabled.
+ */
+static int stageNext(void) {
+    for (uint8_t index = 0; index < STORAGE_REGIONS; index++) {
+        if (!(dirty & (1 << index)))
+            continue;
+        const Region *region = &regions[index];
+        uint8_t size = region -> size;
+        uint8_t slot = newestSlot[index] + 1;
+        if (slot == region -> slots)
+            slot = 0;
+        uint8_t seq = newestSeq[index] + 1;
+
+        memcpy(staged, region -> cache, size);
+        staged[size] = checksum(staged, size, seq);
+        staged[size + 1] = seq;
+        stagedAddr = slotAddr(region, slot);
+        stagedLength = size + OVERHEAD;
+        stagedIndex = 0;
+
+        newestSlot[index] = slot;
+        newestSeq[index] = seq;
+        dirty &= ~(1 << index);
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * EEPROM ready interrupt, writes the next byte of the staged slot. Bytes that 
+ * already hold the right value are skipped to save time and wear.
+ */
+HAL_ISR (EE_READY) {
+    if (stagedIndex == stagedLength && stageNext() != 0) {
+        // Nothing left, the interrupt is enabled again by Storage_write
+        HAL_eepromDisableInterrupt();
+        return;
+    }
+    uint16_t addr = stagedAddr + stagedIndex;
+    uint8_t byte = staged[stagedIndex++];
+    if (HAL_eepromRead(addr) != byte) {
+        TRACE(TRACE_EEPROM_WRITE, addr);
+        HAL_eepromWrite(addr, byte);
+    }
+}
+
+void Storage_setup(void) {
+    for (uint8_t index = 0; index < STORAGE_REGIONS; index++)
+        load(index);
+}
+
+int Storage_read(StorageRegion region, void *data) {
+    HAL_ATOMIC_BLOCK {
+        memcpy(data, regions[region].cache, regions[region].size);
+    }
+    return (stored & (1 << region)) ? 0 : -1;
+}
+
+void Storage_write(StorageRegion region, const void *data) {
+    const Region *r = &regions[region];
+    HAL_ATOMIC_BLOCK {
+        if ((stored & (1 << region)) && memcmp(r -> cache, data, r -> size) == 0)
+            return;
+        memcpy(r -> cache, data, r -> size);
+        stored |= 1 << region;
+        dirty |= 1 << region;
+        HAL_eepromEnableInterrupt();
+    }
+}
+
+void Storage_flush(void) {
+    HAL_disableInterrupts();
+    while (HAL_eepromInterruptEnabled()) {
+        Power_idle();
+        HAL_disableInterrupts();
+    }
+    HAL_enableInterrupts();
+    // The last byte may still be being written
+    while (HAL_eepromBusy()) {}
+}
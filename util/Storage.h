@@ -0,0 +1,53 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+#include <stdint.h>
+
+/*
+ * Implementation of a non-blocking, wear leveled store for small records in 
+ * the EEPROM of an ATMega328P. Each region keeps a RAM copy of its record, 
+ * reads come from the copy and writes update it and return immediately. 
+ * Changed regions are written back in the background by the EEPROM ready 
+ * interrupt, one byte per interrupt.
+ *
+ * A region is a log of record slots that is written round robin, so each 
+ * write lands on a different part of the EEPROM. Every slot holds the record,
+ * a checksum and a sequence number, which is written last; on startup the 
+ * newest slot with a valid checksum is loaded, so a write cut short by a power
+ * loss falls back to the previous record.
+ */
+
+typedef enum {
+    STORAGE_SETTINGS,
+    STORAGE_GAME,
+    STORAGE_REGIONS
+} StorageRegion;
+
+// Record sizes in bytes
+#define STORAGE_SETTINGS_SIZE 2
+#define STORAGE_GAME_SIZE 16
+
+/*
+ * Loads the newest record of every region, reading the EEPROM directly. 
+ * Must be called once before any other function here. 
+ */
+void Storage_setup(void);
+
+/*
+ * Copies the record of a region to data, which must be as large as the record.
+ * Returns -1 if the EEPROM doesn't hold a record for this region yet, in which 
+ * case data is all zeroes.
+ */
+int Storage_read(StorageRegion region, void *data);
+
+/*
+ * Replaces the record of a region with data and queues it to be written to 
+ * the EEPROM, returning immediately. Writes to a region that hasn't been 
+ * written back yet are merged. Writing an unchanged record does nothing.
+ */
+void Storage_write(StorageRegion region, const void *data);
+
+/*
+ * Sleeps until every queued write has reached the EEPROM
+ */
+void Storage_flush(void);
+#endif
@@ -0,0 +1,100 @@
+#include <HAL.h>
+#include <Clock.h>
+#include <Timer.h>
+
+Timer *timerWheel[TIMER_SLOTS];
+
+/**
+ * Puts a timer at the head of a list. Only called with interrupts disabled.
+ */
+static inline void link(Timer *timer, Timer **head) {
+    timer -> next = *head;
+    if (timer -> next)
+        timer -> next -> link = &timer -> next;
+    *head = timer;
+    timer -> link = head;
+}
+
+/**
+ * Takes a timer out of whatever list it's in. Only called with interrupts
+ * disabled.
+ */
+static inline void unlink(Timer *timer) {
+    *timer -> link = timer -> next;
+    if (timer -> next)
+        timer -> next -> link = timer -> link;
+    timer -> link = 0;
+}
+
+static inline void insert(Timer *timer, uint32_t expires) {
+    timer -> expires = expires;
+    link(timer, &timerWheel[expires & (TIMER_SLOTS - 1)]);
+}
+
+void Timer_init(Timer *timer, TimerCallback callback, void *context) {
+    timer -> next = 0;
+    timer -> link = 0;
+    timer -> expires = 0;
+    timer -> period = 0;
+    timer -> callback = callback;
+    timer -> context = context;
+}
+
+void Timer_arm(Timer *timer, uint16_t delay, uint16_t period) {
+    if (!delay)
+        delay = 1;
+    HAL_ATOMIC_BLOCK {
+        if (timer -> link)
+            unlink(timer);
+        timer -> period = period;
+        // A slowed down Clock skips the milliseconds timers expire on
+        Clock_speedUp();
+        insert(timer, clockMillis + delay);
+    }
+}
+
+void Timer_cancel(Timer *timer) {
+    HAL_ATOMIC_BLOCK {
+        if (timer -> link)
+            unlink(timer);
+    }
+}
+
+uint8_t Timer_armed(const Timer *timer) {
+    uint8_t armed;
+    HAL_ATOMIC_BLOCK {
+        armed = timer -> link != 0;
+    }
+    return armed;
+}
+
+uint8_t Timer_anyArmed(void) {
+    for (uint8_t slot = 0; slot < TIMER_SLOTS; slot++)
+        if (timerWheel[slot])
+            return 1;
+    return 0;
+}
+
+void Timer_expire(uint32_t now) {
+    // Move the timers that are due onto a list of their own first, as the
+    // callbacks can change the list of this slot. Cancelling or arming a
+    // timer that is still waiting its turn takes it off the due list.
+    Timer *due = 0;
+    Timer *timer = timerWheel[now & (TIMER_SLOTS - 1)];
+    while (timer) {
+        Timer *next = timer -> next;
+        // The others go round the wheel again
+        if (timer -> expires == now) {
+            unlink(timer);
+            link(timer, &due);
+        }
+        timer = next;
+    }
+    while (due) {
+        timer = due;
+        unlink(timer);
+        if (timer -> period)
+            insert(timer, now + timer -> period);
+        timer -> callback(timer);
+    }
+}
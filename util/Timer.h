@@ -0,0 +1,74 @@
+#ifndef TIMER_H
+#define TIMER_H
+#include <stdint.h>
+
+/*
+ * Software timers on the millisecond tick of the Clock. Any number of
+ * one-shot and periodic timers can be armed; each is a Timer owned by the
+ * caller, so nothing is allocated.
+ *
+ * The timers hang off a hashed wheel of TIMER_SLOTS lists, a timer going
+ * into the list of the millisecond it expires on modulo TIMER_SLOTS. Arming
+ * and cancelling only link and unlink the timer, and each tick only looks
+ * at one list, which is empty most of the time. Timers further away than
+ * TIMER_SLOTS milliseconds go round the wheel until their time comes.
+ *
+ * Callbacks run from the timer0 interrupt with interrupts disabled, so they
+ * have to be short. They may arm and cancel timers, their own included.
+ */
+#define TIMER_SLOTS 32
+
+typedef struct Timer Timer;
+typedef void (*TimerCallback)(Timer *timer);
+
+struct Timer {
+    Timer *next;
+    Timer **link;       // what points to this timer, null when not armed
+    uint32_t expires;   // in Clock_millis
+    uint16_t period;    // in milliseconds, 0 for a one-shot timer
+    TimerCallback callback;
+    void *context;      // for the callback
+};
+
+/*
+ * Sets up a timer that isn't armed
+ */
+void Timer_init(Timer *timer, TimerCallback callback, void *context);
+
+/*
+ * Arms a timer to go off in delay milliseconds (at least 1), and then every
+ * period milliseconds if period isn't 0. Rearms a timer that is armed
+ * already.
+ */
+void Timer_arm(Timer *timer, uint16_t delay, uint16_t period);
+
+/*
+ * Stops a timer, which does nothing if it isn't armed
+ */
+void Timer_cancel(Timer *timer);
+
+uint8_t Timer_armed(const Timer *timer);
+
+/*
+ * Whether any timer is armed, for the Clock to know when it can stop
+ * ticking every millisecond. Only called with interrupts disabled.
+ */
+uint8_t Timer_anyArmed(void);
+
+/*
+ * Runs the timers expiring at now. Only for the timer0 interrupt, through
+ * Timer_tick.
+ */
+void Timer_expire(uint32_t now);
+
+extern Timer *timerWheel[TIMER_SLOTS];
+
+/*
+ * Called by the Clock on every millisecond tick, keeps the cost of a tick
+ * with nothing to do down to one load and compare
+ */
+static inline void Timer_tick(uint32_t now) {
+    if (timerWheel[now & (TIMER_SLOTS - 1)])
+        Timer_expire(now);
+}
+#endif
@@ -0,0 +1,22 @@
+#include <Trace.h>
+
+#ifdef TRACE_ENABLE
+#include <UART.h>
+
+#define TRACE_VERSION 1
+
+TraceRecord traceBuffer[TRACE_SIZE];
+volatile uint8_t traceNext = 0;
+volatile uint8_t tracePaused = 0;
+
+void Trace_dump(void) {
+    static const uint8_t header[] = {'T', 'R', 'C', TRACE_VERSION, TRACE_SIZE};
+    tracePaused = 1;
+    UART_send(header, sizeof header);
+    uint8_t oldest = traceNext & (TRACE_SIZE - 1);
+    UART_send((const uint8_t *) &traceBuffer[oldest], (TRACE_SIZE - oldest) * sizeof (TraceRecord));
+    UART_send((const uint8_t *) traceBuffer, oldest * sizeof (TraceRecord));
+    UART_flush();
+    tracePaused = 0;
+}
+#endif
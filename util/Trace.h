@@ -0,0 +1,83 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdint.h>
+
+/*
+ * Event tracing into a RAM ring buffer, for looking at timing without
+ * printing over the UART while it happens. Only built with TRACE_ENABLE
+ * defined (make TRACE=1), otherwise TRACE expands to nothing.
+ *
+ * Each event is a 6 byte record: the event, the low 16 bits of the Clock's
+ * milliseconds, the timer0 count and a 16 bit payload. The buffer keeps the
+ * latest TRACE_SIZE events and is sent over the UART by Trace_dump,
+ * tools/trace_decode.py turns the dump into a Chrome trace.
+ *
+ * Events named _BEGIN and _END are decoded as the start and end of a span,
+ * the decoder reads the names from this file so they must stay in order.
+ */
+typedef enum {
+    TRACE_NONE,                 // an empty record
+    TRACE_SHIFT_BEGIN,          // direction
+    TRACE_SHIFT_END,            // TRUE if the board changed
+    TRACE_GAME_OVER_BEGIN,
+    TRACE_GAME_OVER_END,        // TRUE on game over
+    TRACE_PUT_RANDOM,           // row * 4 + column of the new tile
+    TRACE_UART_RX,              // the byte
+    TRACE_UART_TX_BEGIN,        // the first byte
+    TRACE_UART_TX_END,
+    TRACE_ADC_BEGIN,
+    TRACE_ADC_END,              // the result
+    TRACE_LED_STEP,             // pattern
+    TRACE_EEPROM_WRITE          // address
+} TraceEvent;
+
+#ifdef TRACE_ENABLE
+#include <HAL.h>
+#include <Clock.h>
+
+// Records kept, a power of 2 up to 128
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 32
+#endif
+
+// The top bit of count is set when a timer0 compare match is pending
+typedef struct {
+    uint8_t event;
+    uint16_t millis;
+    uint8_t count;
+    uint16_t payload;
+} __attribute__((packed)) TraceRecord;
+
+extern TraceRecord traceBuffer[TRACE_SIZE];
+extern volatile uint8_t traceNext;
+extern volatile uint8_t tracePaused;
+
+/*
+ * Records an event, safe to use anywhere including interrupt handlers.
+ * The oldest event is overwritten once the buffer is full.
+ */
+static inline void Trace_event(TraceEvent event, uint16_t payload) {
+    HAL_ATOMIC_BLOCK {
+        if (!tracePaused) {
+            TraceRecord *record = &traceBuffer[traceNext++ & (TRACE_SIZE - 1)];
+            record -> event = event;
+            record -> millis = (uint16_t) clockMillis;
+            record -> count = HAL_timer0Count() | (HAL_timer0MatchPending() ? 0x80 : 0);
+            record -> payload = payload;
+        }
+    }
+}
+
+/*
+ * Sends the buffer over the UART, oldest record first: "TRC", a version
+ * byte, the number of records and the records, little endian. Records 
+ * that haven't been used yet are TRACE_NONE. Events are not recorded while
+ * it is sent.
+ */
+void Trace_dump(void);
+
+#define TRACE(event, payload) Trace_event((event), (payload))
+#else
+#define TRACE(event, payload) ((void) 0)
+#endif
+#endif
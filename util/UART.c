@@ -1,31 +1,128 @@
+#include <string.h>
+#include <HAL.h>
 #include <UART.h>
+#include <RingBuf.h>
+#include <Power.h>
+#include <Clock.h>
+#include <Trace.h>
+
+// Bytes recieved by the RX interrupt that haven't been read yet, with
+// when each arrived so queued keys don't take the time of the newest one
+typedef struct {
+    uint32_t time;
+    uint8_t byte;
+} Recieved;
+SPSC_RINGBUF_DEF_TYPED(uartRx, Recieved, 16);
+// Bytes waiting to be sent by the data register empty interrupt
+SPSC_RINGBUF_DEF(uartTx, 64);
+static uint8_t txActive = 0;
+// Arrival of the byte UART_recieveByte returned last
+static uint32_t rxTime = 0;
 
 void UART_setup(uint32_t baud) {
-    //Set the ubrr value to generate baud rate 
-    uint16_t ubrr = (F_CPU)/((uint32_t)16 * baud) - 1;         
-    UBRR0H = ubrr >> 8;                                        
-    UBRR0L = ubrr;                                             
-        
-    //Enable receiver and transmitter                          
-    UCSR0B = (1<<RXEN0)|(1<<TXEN0);
-    //Set 8 data bits, 1 stop bit, no parity                   
-    UCSR0C = (3<<UCSZ00);                                      
+    HAL_uartSetup(baud);
 }  
 
+/**
+ * Interrupt handler for recieved bytes, these are buffered so that 
+ * the CPU can sleep while waiting for input. Bytes are dropped if 
+ * the buffer is full.
+ */
+HAL_ISR (UART_RX) {
+    Recieved recieved = {Clock_now(), HAL_uartRead()};
+    spscRingBufWrite(&uartRx, &recieved, 1);
+    TRACE(TRACE_UART_RX, recieved.byte);
+}
+
+/**
+ * Interrupt handler that feeds the serial port from the transmit buffer,
+ * it turns itself off once the buffer is empty.
+ */
+HAL_ISR (UART_UDRE) {
+    uint8_t byte;
+    if (spscRingBufPop(&uartTx, &byte) == 0) {
+        HAL_uartWrite(byte);
+    } else {
+        HAL_uartDisableTxInterrupt();
+        TRACE(TRACE_UART_TX_END, 0);
+    }
+}
+
 void UART_sendByte(uint8_t byte) {
-    // wait until port is ready to be written to
-    while( ( UCSR0A & ( 1 << UDRE0 ) ) == 0 ){}
+    // sleep until there is space in the buffer
+    HAL_disableInterrupts();
+    while (spscRingBufPush(&uartTx, byte) != 0) {
+        Power_idle();
+        HAL_disableInterrupts();
+    }
+    txActive = 1;
+    if (!HAL_uartTxInterruptEnabled())
+        TRACE(TRACE_UART_TX_BEGIN, byte);
+    HAL_uartEnableTxInterrupt();
+    HAL_enableInterrupts();
+}
 
-    // write the byte to the serial port
-    UDR0 = byte;
+void UART_send(const uint8_t *bytes, uint16_t length) {
+    void *span;
+    while (length) {
+        // copy as much as fits straight into the buffer
+        HAL_disableInterrupts();
+        uint8_t n;
+        while ((n = spscRingBufPeekWrite(&uartTx, &span)) == 0) {
+            Power_idle();
+            HAL_disableInterrupts();
+        }
+        HAL_enableInterrupts();
+        if (n > length)
+            n = length;
+        memcpy(span, bytes, n);
+        spscRingBufCommitWrite(&uartTx, n);
+        txActive = 1;
+        HAL_ATOMIC_BLOCK {
+            if (!HAL_uartTxInterruptEnabled())
+                TRACE(TRACE_UART_TX_BEGIN, *bytes);
+            HAL_uartEnableTxInterrupt();
+        }
+        bytes += n;
+        length -= n;
+    }
 }
 
 uint8_t UART_recieveByte(void) {
-    // wait until a byte is in the buffer  
-    while( ( UCSR0A & ( 1 << RXC0 ) ) == 0 ){}
+    Recieved recieved;
+    // sleep until a byte is in the buffer, interrupts are disabled while
+    // checking so the recieve interrupt can't arrive just before sleeping
+    HAL_disableInterrupts();
+    while (spscRingBufCount(&uartRx) == 0) {
+        Power_wait();
+        HAL_disableInterrupts();
+    }
+    HAL_enableInterrupts();
+    // the buffer is only popped here so this can't fail
+    spscRingBufRead(&uartRx, &recieved, 1);
+    rxTime = recieved.time;
+    return recieved.byte;
+}
+
+uint8_t UART_available(void) {
+    return spscRingBufCount(&uartRx);
+}
+
+uint32_t UART_recievedAt(void) {
+    return rxTime;
+}
 
-    // grab the byte from the serial port
-    return UDR0;
+void UART_flush(void) {
+    // sleep until the buffer has been handed to the serial port
+    HAL_disableInterrupts();
+    while (HAL_uartTxInterruptEnabled()) {
+        Power_idle();
+        HAL_disableInterrupts();
+    }
+    HAL_enableInterrupts();
+    // then wait for the last byte to be shifted out
+    if (txActive)
+        while (!HAL_uartTxComplete()) {}
 }
 
 void UART_sendByteSTD(uint8_t byte, FILE *stream) {
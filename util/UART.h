@@ -1,6 +1,6 @@
 #ifndef UART_H
 #define UART_H
-#include <avr/io.h>
+#include <stdint.h>
 #include <stdio.h>
 /*
  * Implementation of APIs that allow users to interact with 
@@ -15,18 +15,47 @@ void UART_setup(uint32_t baud);
 /*
  * Sends a character over the UART module
  * takes the byte to be sent as input.
+ * The byte is buffered and sent by an interrupt, 
+ * this only blocks (asleep) when the buffer is full.
  */
 void UART_sendByte(uint8_t byte);
 
+/*
+ * Sends length bytes over the UART module, copying
+ * them into the transmit buffer in bulk. Like 
+ * UART_sendByte, this only blocks when the buffer 
+ * is full.
+ */
+void UART_send(const uint8_t *bytes, uint16_t length);
+
 /*
  * Recieves a character over the UART module
  * note that this method is blocking and will
- * not return until a character is recieved.
+ * not return until a character is recieved,
+ * the CPU sleeps while it waits.
  * Returns the byte that has been recieved
  * in the UART module.
  */
 uint8_t UART_recieveByte(void); 
 
+/*
+ * Number of recieved bytes waiting to be read,
+ * UART_recieveByte won't block if this isn't 0
+ */
+uint8_t UART_available(void);
+
+/*
+ * Clock_now timestamp of when the byte last
+ * returned by UART_recieveByte was recieved
+ */
+uint32_t UART_recievedAt(void);
+
+/*
+ * Blocks until every byte that has been sent
+ * has left the transmitter
+ */
+void UART_flush(void);
+
 /*
  * Sends a byte from a file stream to the 
  * UART module 